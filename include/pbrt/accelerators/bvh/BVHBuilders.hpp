@@ -9,6 +9,23 @@
 #include <span>
 
 namespace idragnev::pbrt::accelerators::bvh {
+    // A part of a primitive, e.g. a triangle of a mesh primitive.
+    // The BVH is built over the parts, so a mesh does not need
+    // a separate primitive object per triangle.
+    struct PrimitiveRef
+    {
+        Bounds3f worldBound() const { return primitive->partWorldBound(part); }
+
+        const Primitive* primitive = nullptr;
+        std::uint32_t part = 0;
+    };
+
+    using PrimsVec = std::vector<PrimitiveRef>;
+
+    // Interleaves the bits of the integer parts of the coordinates,
+    // which must be in [0, 1024]
+    std::uint32_t encodeMorton3(const Vector3f& v);
+
     struct PrimitiveInfo
     {
         PrimitiveInfo(const std::size_t index, const Bounds3f& bounds)
@@ -61,7 +78,7 @@ namespace idragnev::pbrt::accelerators::bvh {
     struct BuildResult
     {
         BuildTree tree;
-        std::vector<std::shared_ptr<const Primitive>> orderedPrimitives;
+        PrimsVec orderedPrimitives;
     };
 
     enum class SplitMethod
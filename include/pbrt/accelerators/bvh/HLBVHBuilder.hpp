@@ -14,8 +14,6 @@ namespace idragnev::pbrt::accelerators::bvh {
     class HLBVHBuilder
     {
     private:
-        using PrimsVec = std::vector<std::shared_ptr<const Primitive>>;
-
         struct LowerLevels
         {
             std::vector<BuildNode*> roots;
@@ -45,8 +43,8 @@ namespace idragnev::pbrt::accelerators::bvh {
             const std::span<PrimitiveInfo> treeletRootsInfosRange,
             const std::vector<BuildNode*>& treeletRoots) const;
         LowerLevels buildLowerLevels(
-            std::vector<LBVHTreelet>&& treelets,
-            const std::vector<MortonPrimitive>& mortonPrimInfos) const;
+            std::pmr::vector<LBVHTreelet>&& treelets,
+            const std::pmr::vector<MortonPrimitive>& mortonPrimInfos) const;
         BuildTree emitLBVH(BuildNode*& buildNodes,
                            const std::span<const MortonPrimitive> primsSubrange,
                            PrimsVec& orderedPrims,
@@ -60,6 +58,6 @@ namespace idragnev::pbrt::accelerators::bvh {
     private:
         std::size_t maxPrimitivesInNode = 1;
         const PrimsVec* prims = nullptr;
-        std::vector<PrimitiveInfo> primitivesInfo;
+        std::span<const PrimitiveInfo> primitivesInfo;
     };
 } // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
@@ -7,9 +7,6 @@
 namespace idragnev::pbrt::accelerators::bvh {
     class RecursiveBuilder
     {
-    private:
-        using PrimsVec = std::vector<std::shared_ptr<const Primitive>>;
-
     public:
         RecursiveBuilder() = default;
         RecursiveBuilder(const SplitMethod m, const std::size_t maxPrimsInNode)
@@ -20,19 +17,29 @@ namespace idragnev::pbrt::accelerators::bvh {
                                const PrimsVec& prims) const;
 
     private:
-        BuildTree buildSubtree(memory::MemoryArena& arena,
+        // Builds the subtree of the primitives in `primsInfoRange` into
+        // `nodes`, which has room for the 2n - 1 nodes of a tree over n
+        // primitives. Its leaves refer to the ordered primitives starting
+        // at `firstPrimIndex`, the offset of `primsInfoRange` in the
+        // primitives info of the whole build. Disjoint subtrees write
+        // to disjoint nodes and ordered primitives, so they can be
+        // built in parallel.
+        BuildTree buildSubtree(BuildNode* const nodes,
                                const std::span<PrimitiveInfo> primsInfoRange,
+                               const std::size_t firstPrimIndex,
                                const PrimsVec& primitives,
                                PrimsVec& orderedPrims) const;
         BuildNode buildLeafNode(const Bounds3f& bounds,
                                 const std::span<PrimitiveInfo> primsInfoRange,
+                                const std::size_t firstPrimIndex,
                                 const PrimsVec& primitives,
                                 PrimsVec& orderedPrims) const;
         Optional<std::pair<BuildTree, BuildTree>>
-        buildInternalNodeChildren(memory::MemoryArena& arena,
+        buildInternalNodeChildren(BuildNode* const childNodes,
                                   const Bounds3f& rangeBounds,
                                   const Bounds3f& rangeCentroidBounds,
                                   const std::span<PrimitiveInfo> primsInfoRange,
+                                  const std::size_t firstPrimIndex,
                                   const PrimsVec& primitives,
                                   PrimsVec& orderedPrims) const;
         Optional<std::size_t> partitionPrimitivesInfo(
@@ -4,6 +4,8 @@
 #include "SurfaceInteraction.hpp"
 #include "Optional.hpp"
 
+#include <span>
+
 namespace idragnev::pbrt {
     struct HitRecord
     {
@@ -30,6 +32,36 @@ namespace idragnev::pbrt {
 
         virtual Float area() const = 0;
 
+        // A shape made of several parts, e.g. the triangles of a mesh,
+        // lets aggregates address and intersect each part on its own,
+        // without a separate object per part. By default a shape is
+        // a single part.
+        virtual std::uint32_t partsCount() const { return 1; }
+        virtual Bounds3f partWorldBound(const std::uint32_t part) const;
+        virtual Optional<HitRecord>
+        intersectPart(const Ray& ray,
+                      const std::uint32_t part,
+                      const bool testAlphaTexture = true) const;
+        virtual bool intersectPartP(const Ray& ray,
+                                    const std::uint32_t part,
+                                    const bool testAlphaTexture = true) const;
+
+        // Intersect a packet of rays with a part. Only the rays whose bits
+        // are set in `activeMask` are tested. The first sets the hit of
+        // each of them in `hits`, the second returns a mask of the
+        // occluded ones. By default the rays are tested one by one.
+        virtual void
+        intersectPartPacket(const std::span<const Ray> rays,
+                            const std::uint32_t part,
+                            const std::uint32_t activeMask,
+                            const std::span<Optional<HitRecord>> hits,
+                            const bool testAlphaTexture = true) const;
+        virtual std::uint32_t
+        intersectPartPacketP(const std::span<const Ray> rays,
+                             const std::uint32_t part,
+                             const std::uint32_t activeMask,
+                             const bool testAlphaTexture = true) const;
+
     public:
         const Transformation* const objectToWorldTransform = nullptr;
         const Transformation* const worldToObjectTransform = nullptr;
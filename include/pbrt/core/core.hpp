@@ -21,6 +21,8 @@ namespace idragnev::pbrt {
         inline constexpr Float Infinity = std::numeric_limits<Float>::infinity();
         inline constexpr Float MachineEpsilon = std::numeric_limits<Float>::epsilon() * 0.5f;
         inline constexpr Float ShadowEpsilon = 0.0001f;
+        // the rays of a packet are selected by the bits of a 32-bit mask
+        inline constexpr std::size_t MaxRayPacketSize = 16;
         // clang-format on
     } // namespace constants
 
@@ -63,6 +65,7 @@ namespace idragnev::pbrt {
     class SurfaceInteraction;
 
     class Shape;
+    struct HitRecord;
     class Primitive;
     class GeometricPrimitive;
     class TransformedPrimitive;
@@ -163,4 +166,4 @@ namespace idragnev::pbrt {
 
     double nextFloatUp(double v, const int delta = 1) noexcept;
     double nextFloatDown(double v, const int delta = 1) noexcept;
-} // namespace idragnev::pbrt
+} // namespace idragnev::pbrt
\ No newline at end of file
@@ -68,36 +68,25 @@ namespace idragnev::pbrt {
         const auto& bounds = *this;
         constexpr auto k = 1.f + 2.f * gamma(3);
 
-        const Float txMin = (bounds[dirIsNeg[0]].x - ray.o.x) * invDir.x;
-        const Float txMax =
-            (bounds[1 - dirIsNeg[0]].x - ray.o.x) * invDir.x * k;
-        const Float tyMin = (bounds[dirIsNeg[1]].y - ray.o.y) * invDir.y;
-        const Float tyMax =
-            (bounds[1 - dirIsNeg[1]].y - ray.o.y) * invDir.y * k;
-
-        if (txMin > tyMax || tyMin > txMax) {
-            return false;
-        }
-
-        Float tMin = txMin > tyMin ? txMin : tyMin;
-        Float tMax = txMax < tyMax ? txMax : tyMax;
-
-        const Float tzMin = (bounds[dirIsNeg[2]].z - ray.o.z) * invDir.z;
-        const Float tzMax =
-            (bounds[1 - dirIsNeg[2]].z - ray.o.z) * invDir.z * k;
-
-        if (tMin > tzMax || tzMin > tMax) {
-            return false;
-        }
-
-        if (tzMin > tMin) {
-            tMin = tzMin;
-        }
-        if (tzMax < tMax) {
-            tMax = tzMax;
+        Float tMin = -constants::Infinity;
+        Float tMax = constants::Infinity;
+        for (std::size_t i = 0; i < 3; ++i) {
+            const Float tNear = (bounds[dirIsNeg[i]][i] - ray.o[i]) * invDir[i];
+            const Float tFar =
+                (bounds[1 - dirIsNeg[i]][i] - ray.o[i]) * invDir[i] * k;
+
+            // An axis parallel ray with its origin on a slab gets NaN
+            // distances for that axis. The comparisons are false for
+            // them, so the other axes decide.
+            if (tNear > tMin) {
+                tMin = tNear;
+            }
+            if (tFar < tMax) {
+                tMax = tFar;
+            }
         }
 
-        return (tMin < ray.tMax) && (tMax > 0.f);
+        return (tMin <= tMax) && (tMin < ray.tMax) && (tMax > 0.f);
     }
 
     template <typename T>
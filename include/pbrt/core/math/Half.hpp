@@ -0,0 +1,32 @@
+#pragma once
+
+#include "pbrt/core/core.hpp"
+
+namespace idragnev::pbrt::math {
+    // An IEEE 754 half precision (binary16) value, used for compact
+    // storage. Conversions from float round to the nearest even value.
+    class Half
+    {
+    public:
+        Half() = default;
+        explicit Half(const float f) noexcept : _bits(fromFloat(f)) {}
+        explicit Half(const double d) noexcept
+            : Half(static_cast<float>(d)) {}
+
+        explicit operator float() const noexcept { return toFloat(_bits); }
+        explicit operator double() const noexcept {
+            return static_cast<double>(toFloat(_bits));
+        }
+
+        std::uint16_t bits() const noexcept { return _bits; }
+
+        bool operator==(const Half& rhs) const noexcept = default;
+
+    private:
+        static std::uint16_t fromFloat(const float f) noexcept;
+        static float toFloat(const std::uint16_t h) noexcept;
+
+    private:
+        std::uint16_t _bits = 0;
+    };
+} // namespace idragnev::pbrt::math
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "pbrt/core/core.hpp"
+
+namespace idragnev::pbrt::math {
+    // A unit vector in 4 bytes: the direction is projected onto an
+    // octahedron, which is unfolded to a square and quantized to
+    // 16 bits per coordinate. The decoding error is below 0.01 degrees.
+    // Only the direction is kept - decoded vectors have unit length,
+    // and the zero vector decodes to (0, 0, 1).
+    class OctahedralVector
+    {
+    public:
+        OctahedralVector() = default;
+        explicit OctahedralVector(const Vector3<Float>& v) noexcept;
+        explicit OctahedralVector(const Normal3<Float>& n) noexcept;
+
+        explicit operator Vector3<Float>() const noexcept;
+        explicit operator Normal3<Float>() const noexcept;
+
+        bool operator==(const OctahedralVector& rhs) const noexcept = default;
+
+    private:
+        static std::uint16_t encode(const Float f) noexcept;
+        static Float decode(const std::uint16_t u) noexcept;
+
+    private:
+        std::uint16_t x = 0;
+        std::uint16_t y = 0;
+    };
+} // namespace idragnev::pbrt::math
\ No newline at end of file
@@ -21,6 +21,22 @@ namespace idragnev::pbrt {
         intersect(const Ray& ray) const override;
         bool intersectP(const Ray& ray) const override;
 
+        std::uint32_t partsCount() const override;
+        Bounds3f partWorldBound(const std::uint32_t part) const override;
+        Optional<SurfaceInteraction>
+        intersectPart(const Ray& ray, const std::uint32_t part) const override;
+        bool intersectPartP(const Ray& ray,
+                            const std::uint32_t part) const override;
+        void intersectPartPacket(
+            const std::span<const Ray> rays,
+            const std::uint32_t part,
+            const std::uint32_t activeMask,
+            const std::span<Optional<SurfaceInteraction>> hits) const override;
+        std::uint32_t
+        intersectPartPacketP(const std::span<const Ray> rays,
+                             const std::uint32_t part,
+                             const std::uint32_t activeMask) const override;
+
         const AreaLight* areaLight() const override;
         const Material* material() const override;
         void computeScatteringFunctions(
@@ -29,6 +45,10 @@ namespace idragnev::pbrt {
             const TransportMode mode,
             const bool allowMultipleLobes) const override;
 
+    private:
+        Optional<SurfaceInteraction>
+        toSurfaceInteraction(const Ray& ray, Optional<HitRecord>&& hit) const;
+
     private:
         std::shared_ptr<const Shape> _shape = nullptr;
         std::shared_ptr<const Material> _material = nullptr;
@@ -5,6 +5,8 @@
 
 #include "pbrt/memory/MemoryArena.hpp"
 
+#include <span>
+
 namespace idragnev::pbrt {
     class Primitive
     {
@@ -17,6 +19,29 @@ namespace idragnev::pbrt {
         intersect(const Ray& r) const = 0;
         virtual bool intersectP(const Ray& r) const = 0;
 
+        // The parts of the primitive, see Shape::partsCount.
+        // By default a primitive is a single part.
+        virtual std::uint32_t partsCount() const { return 1; }
+        virtual Bounds3f partWorldBound(const std::uint32_t part) const;
+        virtual Optional<SurfaceInteraction>
+        intersectPart(const Ray& r, const std::uint32_t part) const;
+        virtual bool intersectPartP(const Ray& r,
+                                    const std::uint32_t part) const;
+
+        // Packet versions of intersectPart, see Shape::intersectPartPacket.
+        // The hits of the active rays replace those in `hits`, and since
+        // the rays are shortened by each hit, they are always closer.
+        virtual void
+        intersectPartPacket(const std::span<const Ray> rays,
+                            const std::uint32_t part,
+                            const std::uint32_t activeMask,
+                            const std::span<Optional<SurfaceInteraction>> hits)
+            const;
+        virtual std::uint32_t
+        intersectPartPacketP(const std::span<const Ray> rays,
+                             const std::uint32_t part,
+                             const std::uint32_t activeMask) const;
+
         virtual const AreaLight* areaLight() const = 0;
         virtual const Material* material() const = 0;
         virtual void
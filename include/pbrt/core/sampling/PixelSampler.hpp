@@ -18,8 +18,8 @@ namespace idragnev::pbrt {
         bool setSampleNumber(const std::uint64_t sampleNum) override;
 
     protected:
-        std::vector<std::vector<Float>> precomputed1DSamplesArray;
-        std::vector<std::vector<Point2f>> precomputed2DSamplesArray;
+        std::vector<SamplesArray<Float>> precomputed1DSamplesArray;
+        std::vector<SamplesArray<Point2f>> precomputed2DSamplesArray;
         std::size_t current1DDimension = 0;
         std::size_t current2DDimension = 0;
 
@@ -3,6 +3,7 @@
 #include "pbrt/core/core.hpp"
 #include "pbrt/core/Optional.hpp"
 #include "pbrt/core/math/Point2.hpp"
+#include "pbrt/memory/MemoryAccounting.hpp"
 
 #include <vector>
 #include <memory>
@@ -50,14 +51,20 @@ namespace idragnev::pbrt {
         }
 
     protected:
+        // The sample arrays are accounted under MemoryTag::Samplers
+        template <typename T>
+        using SamplesArray = std::vector<
+            T,
+            memory::TaggedAllocator<T, memory::MemoryTag::Samplers>>;
+
         Point2i currentPixel;
         std::uint64_t currentPixelSampleIndex = 0;
         std::uint64_t samplesPerPixel = 1;
 
         std::vector<std::size_t> _1DSamplesArraysSizes;
         std::vector<std::size_t> _2DSamplesArraysSizes;
-        std::vector<std::vector<Float>> _1DSamplesArray;
-        std::vector<std::vector<Point2f>> _2DSamplesArray;
+        std::vector<SamplesArray<Float>> _1DSamplesArray;
+        std::vector<SamplesArray<Point2f>> _2DSamplesArray;
 
     private:
         std::size_t _1DSamplesArrayOffset = 0;
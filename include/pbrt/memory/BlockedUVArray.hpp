@@ -2,6 +2,8 @@
 
 #include "Memory.hpp"
 
+#include <type_traits>
+
 namespace idragnev::pbrt::memory {
     template <typename T, unsigned LogBlockSize>
     class BlockedUVArray
@@ -11,23 +13,56 @@ namespace idragnev::pbrt::memory {
 
     public:
         static inline constexpr std::size_t BLOCK_EXTENT = 1 << LogBlockSize;
+        static inline constexpr std::size_t BLOCK_SIZE =
+            BLOCK_EXTENT * BLOCK_EXTENT;
 
-        BlockedUVArray(const std::size_t uextent, const std::size_t vextent)
-            : BlockedUVArray(uextent, vextent, nullptr) {}
+        // The blocks are constructed and initialized in parallel, so each
+        // one is first touched by the thread which fills it.
+        // The data is accounted under `tag`.
+        BlockedUVArray(const std::size_t uextent,
+                       const std::size_t vextent,
+                       const PageSize pageSize = PageSize::Default,
+                       const MemoryTag tag = MemoryTag::Textures)
+            : BlockedUVArray(uextent, vextent, nullptr, pageSize, tag) {}
         BlockedUVArray(const std::size_t uextent,
                        const std::size_t vextent,
-                       const T* const init);
+                       const T* const init,
+                       const PageSize pageSize = PageSize::Default,
+                       const MemoryTag tag = MemoryTag::Textures);
+        BlockedUVArray(const BlockedUVArray&) = delete;
+        BlockedUVArray& operator=(const BlockedUVArray&) = delete;
+        // The moved-from array is empty
+        BlockedUVArray(BlockedUVArray&& other) noexcept;
+        BlockedUVArray& operator=(BlockedUVArray&& rhs) noexcept;
         ~BlockedUVArray();
 
+        void swap(BlockedUVArray& other) noexcept;
+
         std::size_t uExtent() const noexcept;
         std::size_t vExtent() const noexcept;
 
         T& at(const std::size_t u, const std::size_t v);
         const T& at(const std::size_t u, const std::size_t v) const;
 
+        // Copies the elements to `dest` in row-major order,
+        // converting the blocks in parallel.
         void asLinearArray(T* dest) const;
 
     private:
+        // Calls `func(blockU, blockV)` for each block, in parallel
+        template <typename F>
+        void forEachBlock(F&& func) const;
+        T* blockData(const std::size_t blockU,
+                     const std::size_t blockV) const noexcept;
+        // The number of elements of the block row
+        // which are in the [0, uextent) range
+        std::size_t rowLength(const std::size_t blockU) const noexcept;
+        std::size_t rowsCount(const std::size_t blockV) const noexcept;
+
+        static void copyRow(const T* const source,
+                            const std::size_t count,
+                            T* const dest);
+
         static std::size_t allocationSize(const std::size_t uextent,
                                           const std::size_t vextent) noexcept;
         static std::size_t
@@ -40,6 +75,9 @@ namespace idragnev::pbrt::memory {
         std::size_t uextent = 0;
         std::size_t vextent = 0;
         std::size_t uBlocksCount = 0;
+        std::size_t vBlocksCount = 0;
+        PageSize pageSize = PageSize::Default;
+        MemoryTag tag = MemoryTag::Textures;
     };
 } // namespace idragnev::pbrt::memory
 
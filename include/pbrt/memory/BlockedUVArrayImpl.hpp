@@ -1,27 +1,80 @@
 #include "BlockedUVArray.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
 namespace idragnev::pbrt::memory {
     template <typename T, unsigned LogBlockSize>
     BlockedUVArray<T, LogBlockSize>::BlockedUVArray(const std::size_t uextent,
                                                     const std::size_t vextent,
-                                                    const T* const init)
-        : data([size = allocationSize(uextent, vextent)] {
-            T* const result = allocCacheAligned<T>(size);
-            for (std::size_t i = 0; i < size; ++i) {
-                new (&result[i]) T{};
-            }
-            return result;
-        }())
+                                                    const T* const init,
+                                                    const PageSize pageSize,
+                                                    const MemoryTag tag)
+        : data(allocCacheAligned<T>(allocationSize(uextent, vextent),
+                                    pageSize,
+                                    tag))
         , uextent(uextent)
         , vextent(vextent)
-        , uBlocksCount(blockCoordinate(toMultipleOfBlockExtent(uextent))) {
-        if (init != nullptr) {
-            for (std::size_t v = 0; v < vextent; ++v) {
-                for (std::size_t u = 0; u < uextent; ++u) {
-                    this->at(u, v) = init[v * uextent + u];
+        , uBlocksCount(blockCoordinate(toMultipleOfBlockExtent(uextent)))
+        , vBlocksCount(blockCoordinate(toMultipleOfBlockExtent(vextent)))
+        , pageSize(pageSize)
+        , tag(tag) {
+        forEachBlock([this, init](const std::size_t blockU,
+                                  const std::size_t blockV) {
+            T* const block = blockData(blockU, blockV);
+            for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+                new (&block[i]) T{};
+            }
+
+            if (init != nullptr) {
+                const std::size_t u = blockU * BLOCK_EXTENT;
+                const std::size_t v = blockV * BLOCK_EXTENT;
+                const std::size_t length = rowLength(blockU);
+
+                for (std::size_t row = 0; row < rowsCount(blockV); ++row) {
+                    copyRow(&init[(v + row) * this->uextent + u],
+                            length,
+                            &block[row * BLOCK_EXTENT]);
                 }
             }
+        });
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    BlockedUVArray<T, LogBlockSize>::BlockedUVArray(
+        BlockedUVArray&& other) noexcept
+        : data(std::exchange(other.data, nullptr))
+        , uextent(std::exchange(other.uextent, 0))
+        , vextent(std::exchange(other.vextent, 0))
+        , uBlocksCount(std::exchange(other.uBlocksCount, 0))
+        , vBlocksCount(std::exchange(other.vBlocksCount, 0))
+        , pageSize(other.pageSize)
+        , tag(other.tag) {}
+
+    template <typename T, unsigned LogBlockSize>
+    BlockedUVArray<T, LogBlockSize>&
+    BlockedUVArray<T, LogBlockSize>::operator=(BlockedUVArray&& rhs) noexcept {
+        if (this != &rhs) {
+            BlockedUVArray temp(std::move(rhs));
+            swap(temp);
         }
+
+        return *this;
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    void BlockedUVArray<T, LogBlockSize>::swap(BlockedUVArray& other) noexcept {
+        using std::swap;
+
+        swap(data, other.data);
+        swap(uextent, other.uextent);
+        swap(vextent, other.vextent);
+        swap(uBlocksCount, other.uBlocksCount);
+        swap(vBlocksCount, other.vBlocksCount);
+        swap(pageSize, other.pageSize);
+        swap(tag, other.tag);
     }
 
     template <typename T, unsigned LogBlockSize>
@@ -40,11 +93,17 @@ namespace idragnev::pbrt::memory {
 
     template <typename T, unsigned LogBlockSize>
     BlockedUVArray<T, LogBlockSize>::~BlockedUVArray() {
+        if (data == nullptr) {
+            return;
+        }
+
         const auto size = allocationSize(uextent, vextent);
-        for (std::size_t i = 0; i < size; ++i) {
-            data[i].~T();
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (std::size_t i = 0; i < size; ++i) {
+                data[i].~T();
+            }
         }
-        freeAligned(data);
+        freeAligned(data, size, pageSize, tag);
     }
 
     template <typename T, unsigned LogBlockSize>
@@ -60,13 +119,20 @@ namespace idragnev::pbrt::memory {
     }
 
     template <typename T, unsigned LogBlockSize>
-    void BlockedUVArray<T, LogBlockSize>::asLinearArray(T* dest) const {
-        for (std::size_t v = 0; v < vextent; ++v) {
-            for (std::size_t u = 0; u < uextent; ++u) {
-                *dest = at(u, v);
-                ++dest;
+    void BlockedUVArray<T, LogBlockSize>::asLinearArray(T* const dest) const {
+        forEachBlock([this, dest](const std::size_t blockU,
+                                  const std::size_t blockV) {
+            const T* const block = blockData(blockU, blockV);
+            const std::size_t u = blockU * BLOCK_EXTENT;
+            const std::size_t v = blockV * BLOCK_EXTENT;
+            const std::size_t length = rowLength(blockU);
+
+            for (std::size_t row = 0; row < rowsCount(blockV); ++row) {
+                copyRow(&block[row * BLOCK_EXTENT],
+                        length,
+                        &dest[(v + row) * uextent + u]);
             }
-        }
+        });
     }
 
     template <typename T, unsigned LogBlockSize>
@@ -79,15 +145,63 @@ namespace idragnev::pbrt::memory {
     template <typename T, unsigned LogBlockSize>
     const T& BlockedUVArray<T, LogBlockSize>::at(const std::size_t u,
                                                  const std::size_t v) const {
-        constexpr std::size_t blockSize = BLOCK_EXTENT * BLOCK_EXTENT;
-        const std::size_t blockNumber =
-            (uBlocksCount * blockCoordinate(v) + blockCoordinate(u));
         const std::size_t blockOffset =
             BLOCK_EXTENT * blockElementCoordinate(v) +
             blockElementCoordinate(u);
-        const std::size_t index = blockNumber * blockSize + blockOffset;
 
-        return data[index];
+        return blockData(blockCoordinate(u), blockCoordinate(v))[blockOffset];
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    template <typename F>
+    void BlockedUVArray<T, LogBlockSize>::forEachBlock(F&& func) const {
+        // small blocks are grouped, so that a chunk is worth a task
+        constexpr std::int64_t blocksPerChunk = std::max<std::int64_t>(
+            1,
+            parallel::constants::ALGORITHMS_BLOCK_SIZE / BLOCK_SIZE);
+
+        const std::size_t blocksCount = uBlocksCount * vBlocksCount;
+        parallel::parallelFor(
+            [this, &func](const std::int64_t first, const std::int64_t last) {
+                for (auto i = static_cast<std::size_t>(first);
+                     i < static_cast<std::size_t>(last);
+                     ++i) {
+                    func(i % uBlocksCount, i / uBlocksCount);
+                }
+            },
+            static_cast<std::int64_t>(blocksCount),
+            blocksPerChunk);
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline T* BlockedUVArray<T, LogBlockSize>::blockData(
+        const std::size_t blockU,
+        const std::size_t blockV) const noexcept {
+        return data + (uBlocksCount * blockV + blockU) * BLOCK_SIZE;
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline std::size_t BlockedUVArray<T, LogBlockSize>::rowLength(
+        const std::size_t blockU) const noexcept {
+        return std::min(BLOCK_EXTENT, uextent - blockU * BLOCK_EXTENT);
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline std::size_t BlockedUVArray<T, LogBlockSize>::rowsCount(
+        const std::size_t blockV) const noexcept {
+        return std::min(BLOCK_EXTENT, vextent - blockV * BLOCK_EXTENT);
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline void BlockedUVArray<T, LogBlockSize>::copyRow(const T* const source,
+                                                         const std::size_t count,
+                                                         T* const dest) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            std::memcpy(dest, source, count * sizeof(T));
+        }
+        else {
+            std::copy(source, source + count, dest);
+        }
     }
 
     template <typename T, unsigned LogBlockSize>
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Memory.hpp"
+
+#include <memory>
+#include <type_traits>
+
+namespace idragnev::pbrt::memory {
+    // A 3D array stored in cubic bricks of BLOCK_EXTENT^3 elements,
+    // e.g. the density grid of a volumetric medium.
+    // Bricks are allocated only when they hold a value different from
+    // `emptyValue`, so the memory use scales with the occupied voxels.
+    template <typename T, unsigned LogBlockSize>
+    class BlockedUVWArray
+    {
+        static_assert(std::is_default_constructible_v<T>,
+                      "T must be default constructible");
+
+    public:
+        static inline constexpr std::size_t BLOCK_EXTENT = 1 << LogBlockSize;
+        static inline constexpr std::size_t BLOCK_SIZE =
+            BLOCK_EXTENT * BLOCK_EXTENT * BLOCK_EXTENT;
+
+        // All elements are `emptyValue` and no bricks are allocated.
+        // The data is accounted under `tag`.
+        BlockedUVWArray(const std::size_t uextent,
+                        const std::size_t vextent,
+                        const std::size_t wextent,
+                        const T& emptyValue = T{},
+                        const MemoryTag tag = MemoryTag::Volumes);
+        // `init` is a dense u-major array of uextent * vextent * wextent
+        // elements. Only the bricks holding a value different from
+        // `emptyValue` are allocated. The bricks are filled in parallel.
+        BlockedUVWArray(const std::size_t uextent,
+                        const std::size_t vextent,
+                        const std::size_t wextent,
+                        const T* const init,
+                        const T& emptyValue = T{},
+                        const MemoryTag tag = MemoryTag::Volumes);
+        BlockedUVWArray(const BlockedUVWArray&) = delete;
+        BlockedUVWArray& operator=(const BlockedUVWArray&) = delete;
+        // The moved-from array is empty
+        BlockedUVWArray(BlockedUVWArray&& other) noexcept;
+        BlockedUVWArray& operator=(BlockedUVWArray&& rhs) noexcept;
+        ~BlockedUVWArray();
+
+        void swap(BlockedUVWArray& other) noexcept;
+
+        std::size_t uExtent() const noexcept { return uextent; }
+        std::size_t vExtent() const noexcept { return vextent; }
+        std::size_t wExtent() const noexcept { return wextent; }
+        const T& emptyValue() const noexcept { return _emptyValue; }
+
+        // Allocates the brick of the element if it is empty,
+        // so it must not be called concurrently.
+        T& at(const std::size_t u, const std::size_t v, const std::size_t w);
+        const T& at(const std::size_t u,
+                    const std::size_t v,
+                    const std::size_t w) const;
+
+        // Trilinearly interpolates the elements around (u, v, w),
+        // with element (i, j, k) at the integer coordinates (i, j, k).
+        // Coordinates outside the array are clamped to its edges.
+        // The lookup reads a single brick when the eight elements are in it.
+        template <typename Real>
+        T lookup(const Real u, const Real v, const Real w) const;
+
+        std::size_t allocatedBricksCount() const noexcept;
+
+    private:
+        std::size_t brickIndex(const std::size_t u,
+                               const std::size_t v,
+                               const std::size_t w) const noexcept;
+        T* allocateBrick() const;
+        void freeBricks() noexcept;
+
+        static std::size_t bricksAlong(const std::size_t extent) noexcept;
+        static std::size_t brickCoordinate(const std::size_t n) noexcept;
+        static std::size_t brickElementCoordinate(const std::size_t n) noexcept;
+        static std::size_t brickElementOffset(const std::size_t u,
+                                              const std::size_t v,
+                                              const std::size_t w) noexcept;
+
+    private:
+        std::size_t uextent = 0;
+        std::size_t vextent = 0;
+        std::size_t wextent = 0;
+        std::size_t uBricksCount = 0;
+        std::size_t vBricksCount = 0;
+        std::size_t wBricksCount = 0;
+        // null for the bricks which are entirely `_emptyValue`
+        std::unique_ptr<T*[]> bricks;
+        T _emptyValue{};
+        MemoryTag tag = MemoryTag::Volumes;
+    };
+} // namespace idragnev::pbrt::memory
+
+#include "BlockedUVWArrayImpl.hpp"
\ No newline at end of file
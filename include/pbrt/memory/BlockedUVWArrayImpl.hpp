@@ -0,0 +1,301 @@
+#include "BlockedUVWArray.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <assert.h>
+
+namespace idragnev::pbrt::memory {
+    template <typename T, unsigned LogBlockSize>
+    BlockedUVWArray<T, LogBlockSize>::BlockedUVWArray(const std::size_t uextent,
+                                                      const std::size_t vextent,
+                                                      const std::size_t wextent,
+                                                      const T& emptyValue,
+                                                      const MemoryTag tag)
+        : uextent(uextent)
+        , vextent(vextent)
+        , wextent(wextent)
+        , uBricksCount(bricksAlong(uextent))
+        , vBricksCount(bricksAlong(vextent))
+        , wBricksCount(bricksAlong(wextent))
+        , bricks(std::make_unique<T*[]>(uBricksCount * vBricksCount *
+                                        wBricksCount))
+        , _emptyValue(emptyValue)
+        , tag(tag) {}
+
+    template <typename T, unsigned LogBlockSize>
+    BlockedUVWArray<T, LogBlockSize>::BlockedUVWArray(const std::size_t uextent,
+                                                      const std::size_t vextent,
+                                                      const std::size_t wextent,
+                                                      const T* const init,
+                                                      const T& emptyValue,
+                                                      const MemoryTag tag)
+        : BlockedUVWArray(uextent, vextent, wextent, emptyValue, tag) {
+        if (init == nullptr) {
+            return;
+        }
+
+        const std::size_t bricksCount =
+            uBricksCount * vBricksCount * wBricksCount;
+        const auto fillBrick = [this, init](const std::size_t brick) {
+            const std::size_t u0 = (brick % uBricksCount) * BLOCK_EXTENT;
+            const std::size_t v0 =
+                (brick / uBricksCount % vBricksCount) * BLOCK_EXTENT;
+            const std::size_t w0 =
+                (brick / (uBricksCount * vBricksCount)) * BLOCK_EXTENT;
+            const std::size_t uEnd = std::min(u0 + BLOCK_EXTENT, this->uextent);
+            const std::size_t vEnd = std::min(v0 + BLOCK_EXTENT, this->vextent);
+            const std::size_t wEnd = std::min(w0 + BLOCK_EXTENT, this->wextent);
+
+            const auto initAt = [&](const std::size_t u,
+                                    const std::size_t v,
+                                    const std::size_t w) -> const T& {
+                return init[(w * this->vextent + v) * this->uextent + u];
+            };
+
+            bool isEmpty = true;
+            for (std::size_t w = w0; w < wEnd && isEmpty; ++w) {
+                for (std::size_t v = v0; v < vEnd && isEmpty; ++v) {
+                    for (std::size_t u = u0; u < uEnd && isEmpty; ++u) {
+                        isEmpty = initAt(u, v, w) == _emptyValue;
+                    }
+                }
+            }
+            if (isEmpty) {
+                return;
+            }
+
+            T* const data = allocateBrick();
+            for (std::size_t w = w0; w < wEnd; ++w) {
+                for (std::size_t v = v0; v < vEnd; ++v) {
+                    for (std::size_t u = u0; u < uEnd; ++u) {
+                        data[brickElementOffset(u, v, w)] = initAt(u, v, w);
+                    }
+                }
+            }
+            bricks[brick] = data;
+        };
+
+        parallel::parallelFor(
+            [&fillBrick](const std::int64_t first, const std::int64_t last) {
+                for (auto i = first; i < last; ++i) {
+                    fillBrick(static_cast<std::size_t>(i));
+                }
+            },
+            static_cast<std::int64_t>(bricksCount));
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    BlockedUVWArray<T, LogBlockSize>::BlockedUVWArray(
+        BlockedUVWArray&& other) noexcept
+        : uextent(std::exchange(other.uextent, 0))
+        , vextent(std::exchange(other.vextent, 0))
+        , wextent(std::exchange(other.wextent, 0))
+        , uBricksCount(std::exchange(other.uBricksCount, 0))
+        , vBricksCount(std::exchange(other.vBricksCount, 0))
+        , wBricksCount(std::exchange(other.wBricksCount, 0))
+        , bricks(std::move(other.bricks))
+        , _emptyValue(other._emptyValue)
+        , tag(other.tag) {}
+
+    template <typename T, unsigned LogBlockSize>
+    BlockedUVWArray<T, LogBlockSize>&
+    BlockedUVWArray<T, LogBlockSize>::operator=(BlockedUVWArray&& rhs) noexcept {
+        if (this != &rhs) {
+            BlockedUVWArray temp(std::move(rhs));
+            swap(temp);
+        }
+
+        return *this;
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    BlockedUVWArray<T, LogBlockSize>::~BlockedUVWArray() {
+        freeBricks();
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    void
+    BlockedUVWArray<T, LogBlockSize>::swap(BlockedUVWArray& other) noexcept {
+        using std::swap;
+
+        swap(uextent, other.uextent);
+        swap(vextent, other.vextent);
+        swap(wextent, other.wextent);
+        swap(uBricksCount, other.uBricksCount);
+        swap(vBricksCount, other.vBricksCount);
+        swap(wBricksCount, other.wBricksCount);
+        swap(bricks, other.bricks);
+        swap(_emptyValue, other._emptyValue);
+        swap(tag, other.tag);
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    T& BlockedUVWArray<T, LogBlockSize>::at(const std::size_t u,
+                                            const std::size_t v,
+                                            const std::size_t w) {
+        assert(u < uextent && v < vextent && w < wextent);
+
+        T*& brick = bricks[brickIndex(u, v, w)];
+        if (brick == nullptr) {
+            brick = allocateBrick();
+        }
+
+        return brick[brickElementOffset(u, v, w)];
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    const T& BlockedUVWArray<T, LogBlockSize>::at(const std::size_t u,
+                                                  const std::size_t v,
+                                                  const std::size_t w) const {
+        assert(u < uextent && v < vextent && w < wextent);
+
+        const T* const brick = bricks[brickIndex(u, v, w)];
+        return brick != nullptr ? brick[brickElementOffset(u, v, w)]
+                                : _emptyValue;
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    template <typename Real>
+    T BlockedUVWArray<T, LogBlockSize>::lookup(const Real u,
+                                               const Real v,
+                                               const Real w) const {
+        static_assert(std::is_floating_point_v<Real>);
+        assert(uextent > 0 && vextent > 0 && wextent > 0);
+
+        const auto split = [](const Real x, const std::size_t extent) {
+            const Real max = static_cast<Real>(extent - 1);
+            const Real clamped = std::clamp(x, Real(0), max);
+            const Real floor = std::floor(clamped);
+
+            return std::make_pair(static_cast<std::size_t>(floor),
+                                  clamped - floor);
+        };
+        const auto [u0, du] = split(u, uextent);
+        const auto [v0, dv] = split(v, vextent);
+        const auto [w0, dw] = split(w, wextent);
+        // the upper neighbours, clamped at the edges
+        const std::size_t u1 = std::min(u0 + 1, uextent - 1);
+        const std::size_t v1 = std::min(v0 + 1, vextent - 1);
+        const std::size_t w1 = std::min(w0 + 1, wextent - 1);
+
+        const bool isInOneBrick = brickCoordinate(u0) == brickCoordinate(u1) &&
+                                  brickCoordinate(v0) == brickCoordinate(v1) &&
+                                  brickCoordinate(w0) == brickCoordinate(w1);
+        const T* const brick =
+            isInOneBrick ? bricks[brickIndex(u0, v0, w0)] : nullptr;
+        if (isInOneBrick && brick == nullptr) {
+            return _emptyValue;
+        }
+
+        const std::size_t us[] = {u0, u1};
+        const std::size_t vs[] = {v0, v1};
+        const std::size_t ws[] = {w0, w1};
+        T d[2][2][2];
+        for (int k = 0; k < 2; ++k) {
+            for (int j = 0; j < 2; ++j) {
+                for (int i = 0; i < 2; ++i) {
+                    d[k][j][i] =
+                        isInOneBrick
+                            ? brick[brickElementOffset(us[i], vs[j], ws[k])]
+                            : at(us[i], vs[j], ws[k]);
+                }
+            }
+        }
+
+        const auto lerp = [](const Real t, const T& a, const T& b) {
+            return a * (Real(1) - t) + b * t;
+        };
+        const T d00 = lerp(du, d[0][0][0], d[0][0][1]);
+        const T d10 = lerp(du, d[0][1][0], d[0][1][1]);
+        const T d01 = lerp(du, d[1][0][0], d[1][0][1]);
+        const T d11 = lerp(du, d[1][1][0], d[1][1][1]);
+
+        return lerp(dw, lerp(dv, d00, d10), lerp(dv, d01, d11));
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    std::size_t
+    BlockedUVWArray<T, LogBlockSize>::allocatedBricksCount() const noexcept {
+        const std::size_t bricksCount =
+            uBricksCount * vBricksCount * wBricksCount;
+
+        return static_cast<std::size_t>(
+            std::count_if(bricks.get(),
+                          bricks.get() + bricksCount,
+                          [](const T* const brick) { return brick != nullptr; }));
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline std::size_t BlockedUVWArray<T, LogBlockSize>::brickIndex(
+        const std::size_t u,
+        const std::size_t v,
+        const std::size_t w) const noexcept {
+        return (brickCoordinate(w) * vBricksCount + brickCoordinate(v)) *
+                   uBricksCount +
+               brickCoordinate(u);
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    T* BlockedUVWArray<T, LogBlockSize>::allocateBrick() const {
+        T* const brick = allocCacheAligned<T>(BLOCK_SIZE, PageSize::Default, tag);
+        for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+            new (&brick[i]) T(_emptyValue);
+        }
+
+        return brick;
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    void BlockedUVWArray<T, LogBlockSize>::freeBricks() noexcept {
+        if (bricks == nullptr) {
+            return;
+        }
+
+        const std::size_t bricksCount =
+            uBricksCount * vBricksCount * wBricksCount;
+        for (std::size_t i = 0; i < bricksCount; ++i) {
+            T* const brick = std::exchange(bricks[i], nullptr);
+            if (brick == nullptr) {
+                continue;
+            }
+
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                for (std::size_t j = 0; j < BLOCK_SIZE; ++j) {
+                    brick[j].~T();
+                }
+            }
+            freeAligned(brick, BLOCK_SIZE, PageSize::Default, tag);
+        }
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline std::size_t
+    BlockedUVWArray<T, LogBlockSize>::bricksAlong(const std::size_t extent) noexcept {
+        return brickCoordinate(alignUp(extent, BLOCK_EXTENT));
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline std::size_t BlockedUVWArray<T, LogBlockSize>::brickCoordinate(
+        const std::size_t n) noexcept {
+        return n >> LogBlockSize;
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline std::size_t BlockedUVWArray<T, LogBlockSize>::brickElementCoordinate(
+        const std::size_t n) noexcept {
+        return (n & (BLOCK_EXTENT - 1));
+    }
+
+    template <typename T, unsigned LogBlockSize>
+    inline std::size_t BlockedUVWArray<T, LogBlockSize>::brickElementOffset(
+        const std::size_t u,
+        const std::size_t v,
+        const std::size_t w) noexcept {
+        return (brickElementCoordinate(w) * BLOCK_EXTENT +
+                brickElementCoordinate(v)) *
+                   BLOCK_EXTENT +
+               brickElementCoordinate(u);
+    }
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
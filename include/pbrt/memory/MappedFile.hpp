@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace idragnev::pbrt::memory {
+    // A read-only view of a whole file. Where mmap is available the file is
+    // mapped, so its pages are loaded on first access and are shared with
+    // the other processes which map it. Elsewhere the file is read into
+    // cache aligned memory.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        // The file is not open if it is missing, empty or cannot be read
+        explicit MappedFile(const std::filesystem::path& path);
+        MappedFile(MappedFile&& other) noexcept;
+        ~MappedFile();
+
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        void swap(MappedFile& other) noexcept;
+
+        bool isOpen() const noexcept { return _data != nullptr; }
+        // The data is aligned at least to L1_CACHE_LINE_SIZE
+        const std::byte* data() const noexcept { return _data; }
+        std::size_t size() const noexcept { return _size; }
+
+    private:
+        void close() noexcept;
+
+    private:
+        const std::byte* _data = nullptr;
+        std::size_t _size = 0;
+        bool isMapped = false;
+    };
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "MemoryAccounting.hpp"
+
 #include <cstddef>
 #include <cstdint>
 #include <type_traits>
@@ -19,8 +21,18 @@ namespace idragnev::pbrt::memory {
         inline constexpr std::size_t L1_CACHE_LINE_SIZE =
             PBRT_L1_CACHE_LINE_SIZE;
 #endif
+        inline constexpr std::size_t HUGE_PAGE_SIZE = 2u * 1024u * 1024u;
     } // namespace constants
 
+    enum class PageSize
+    {
+        Default,
+        // 2 MB pages, which reduce the TLB misses when accessing big arrays
+        // at random. Used only on Linux and for allocations of at least
+        // HUGE_PAGE_SIZE bytes, falling back to the default pages otherwise.
+        Huge,
+    };
+
     template <typename T>
     [[nodiscard]] inline auto pbrtAlloca(const std::size_t count) {
         return static_cast<T*>(alloca(count * sizeof(T)));
@@ -30,12 +42,40 @@ namespace idragnev::pbrt::memory {
     [[nodiscard]] void* allocCacheAligned(const std::size_t size);
     void freeAligned(void* ptr);
 
+    // Allocates memory aligned to L1 Cache line boundary, backed by pages
+    // of the given size, and accounts it under `tag`.
+    // Must be freed with the same size, page size and tag.
+    [[nodiscard]] void* allocCacheAligned(const std::size_t size,
+                                          const PageSize pageSize,
+                                          const MemoryTag tag = MemoryTag::Other);
+    void freeAligned(void* ptr,
+                     const std::size_t size,
+                     const PageSize pageSize,
+                     const MemoryTag tag = MemoryTag::Other);
+
     // Allocates memory for `count` Ts aligned to L1 Cache line boundary
     template <typename T>
     [[nodiscard]] inline auto allocCacheAligned(const std::size_t count) {
         return static_cast<T*>(allocCacheAligned(count * sizeof(T)));
     }
 
+    template <typename T>
+    [[nodiscard]] inline auto
+    allocCacheAligned(const std::size_t count,
+                      const PageSize pageSize,
+                      const MemoryTag tag = MemoryTag::Other) {
+        return static_cast<T*>(
+            allocCacheAligned(count * sizeof(T), pageSize, tag));
+    }
+
+    template <typename T>
+    inline void freeAligned(T* const ptr,
+                            const std::size_t count,
+                            const PageSize pageSize,
+                            const MemoryTag tag = MemoryTag::Other) {
+        freeAligned(static_cast<void*>(ptr), count * sizeof(T), pageSize, tag);
+    }
+
     template <typename T>
     inline constexpr bool isPowerOfTwo(const T n) noexcept {
         static_assert(
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+
+namespace idragnev::pbrt::memory {
+    // The subsystems whose memory usage is accounted
+    enum class MemoryTag
+    {
+        BVHNodes,
+        MeshVertices,
+        MeshIndices,
+        Textures,
+        Volumes,
+        Arenas,
+        Samplers,
+        Other,
+        Count,
+    };
+
+    struct MemoryUsage
+    {
+        std::size_t liveBytes = 0;
+        std::size_t peakBytes = 0;
+    };
+
+    // Thread-safe. Called by the tagged allocation functions
+    // and by TaggedAllocator.
+    void recordAllocation(const MemoryTag tag, const std::size_t bytes) noexcept;
+    void recordDeallocation(const MemoryTag tag,
+                            const std::size_t bytes) noexcept;
+
+    MemoryUsage memoryUsage(const MemoryTag tag) noexcept;
+    const char* toString(const MemoryTag tag) noexcept;
+
+    // Prints the live and peak bytes of each tag,
+    // e.g. at the end of a render.
+    void printMemoryUsage(std::FILE* const out = stdout);
+
+    // A std::allocator which accounts its allocations under Tag,
+    // for the containers of the accounted subsystems.
+    template <typename T, MemoryTag Tag>
+    class TaggedAllocator
+    {
+    public:
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = TaggedAllocator<U, Tag>;
+        };
+
+        TaggedAllocator() = default;
+        template <typename U>
+        TaggedAllocator(const TaggedAllocator<U, Tag>&) noexcept {}
+
+        [[nodiscard]] T* allocate(const std::size_t count) {
+            T* const result = std::allocator<T>{}.allocate(count);
+            recordAllocation(Tag, count * sizeof(T));
+
+            return result;
+        }
+
+        void deallocate(T* const ptr, const std::size_t count) noexcept {
+            recordDeallocation(Tag, count * sizeof(T));
+            std::allocator<T>{}.deallocate(ptr, count);
+        }
+
+        template <typename U>
+        bool operator==(const TaggedAllocator<U, Tag>&) const noexcept {
+            return true;
+        }
+    };
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
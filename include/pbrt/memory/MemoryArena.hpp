@@ -1,8 +1,11 @@
 #pragma once
 
 #include "Memory.hpp"
+#include "MemoryBlockPool.hpp"
 
-#include <list>
+#include <memory>
+#include <memory_resource>
+#include <vector>
 
 namespace idragnev::pbrt::memory {
 
@@ -10,23 +13,37 @@ namespace idragnev::pbrt::memory {
     #pragma warning(push)
     #pragma warning(disable : 4324) // structure padding due to alignment specifier
 #endif
+    // Getting a new block and reset() take constant time.
+    // `blockSize` is the allocation size of the blocks. Blocks backed by huge
+    // pages should be a multiple of HUGE_PAGE_SIZE, to avoid wasting memory.
+    // The arena is also a memory resource for the std::pmr containers.
+    // Their deallocations are no-ops - the memory is reclaimed by reset().
     class alignas(constants::L1_CACHE_LINE_SIZE) MemoryArena
+        : public std::pmr::memory_resource
     {
-        struct Block
+    public:
+        // The state of the arena at a call to mark()
+        class Checkpoint
         {
-            std::size_t size = 0;
-            std::uint8_t* startAddress = nullptr;
-        };
+            friend class MemoryArena;
 
-        struct CurrentBlock : public Block
-        {
+            detail::MemoryBlock* block = nullptr;
             std::size_t usedBytes = 0;
+            detail::MemoryBlock* lastUsedBlock = nullptr;
         };
 
-    public:
         MemoryArena() = default;
-        MemoryArena(const std::size_t blockSize) : blockSize(blockSize) {}
-        ~MemoryArena();
+        MemoryArena(const std::size_t blockSize,
+                    const PageSize pageSize = PageSize::Default)
+            : blockSize(blockSize)
+            , pageSize(pageSize) {}
+        // Takes its blocks from `pool` and gives them back to it when
+        // destroyed. The pool must outlive the arena.
+        explicit MemoryArena(MemoryBlockPool& pool)
+            : blockSize(pool.blockSize())
+            , pageSize(pool.pageSize())
+            , pool(&pool) {}
+        ~MemoryArena() override;
 
         MemoryArena(const MemoryArena&) = delete;
         MemoryArena& operator=(const MemoryArena&) = delete;
@@ -38,18 +55,92 @@ namespace idragnev::pbrt::memory {
 
         void reset();
 
+        // Rolling back to a checkpoint releases all allocations made after
+        // it, keeping the ones made before. Checkpoints must be rolled back
+        // in the reverse order of their creation and are invalidated by
+        // reset() and by rolling back to an earlier checkpoint.
+        Checkpoint mark() const noexcept;
+        void rollback(const Checkpoint& checkpoint) noexcept;
+
         std::size_t totalAllocationSize() const noexcept;
 
+    private:
+        void* do_allocate(const std::size_t bytes,
+                          const std::size_t alignment) override;
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+        bool do_is_equal(
+            const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        detail::MemoryBlock* nextBlock(const std::size_t allocSize);
+
     private:
         std::size_t blockSize = 262144u; // 256 kB
-        CurrentBlock currentBlock{};
-        std::list<Block> usedBlocks;
-        std::list<Block> availableBlocks;
+        PageSize pageSize = PageSize::Default;
+        MemoryBlockPool* pool = nullptr;
+        detail::MemoryBlock* currentBlock = nullptr;
+        std::size_t currentBlockUsedBytes = 0;
+        detail::MemoryBlockList usedBlocks;
+        detail::MemoryBlockList availableBlocks;
+        std::size_t allocatedBytes = 0;
     };
 #ifdef _MSC_VER
     #pragma warning(pop)
 #endif
 
+    // Rolls back the arena to its state at the creation of the scope,
+    // e.g. to release the allocations of a path vertex before the next one.
+    class MemoryArenaScope
+    {
+    public:
+        explicit MemoryArenaScope(MemoryArena& arena) noexcept
+            : arena(arena)
+            , checkpoint(arena.mark()) {}
+        ~MemoryArenaScope() { arena.rollback(checkpoint); }
+
+        MemoryArenaScope(const MemoryArenaScope&) = delete;
+        MemoryArenaScope& operator=(const MemoryArenaScope&) = delete;
+
+    private:
+        MemoryArena& arena;
+        MemoryArena::Checkpoint checkpoint;
+    };
+
+    // A MemoryArena per thread, e.g. per worker of the parallel thread pool.
+    // The arenas share a MemoryBlockPool, so the blocks of a destroyed
+    // arena are recycled instead of being freed.
+    // Each arena allocates its first block when first used, so the memory
+    // is first-touched by the thread using it.
+    class MemoryArenaPool
+    {
+    public:
+        explicit MemoryArenaPool(const std::size_t arenasCount,
+                                 const std::size_t blockSize = 262144u,
+                                 const PageSize pageSize = PageSize::Default);
+
+        MemoryArenaPool(const MemoryArenaPool&) = delete;
+        MemoryArenaPool& operator=(const MemoryArenaPool&) = delete;
+
+        // The arena of the thread with the given index,
+        // e.g. parallel::thisThreadIndex().
+        MemoryArena& arena(const std::size_t threadIndex) noexcept {
+            return *arenas[threadIndex];
+        }
+        std::size_t arenasCount() const noexcept { return arenas.size(); }
+
+        // Resets all arenas.
+        // Must not be called while other threads are using them.
+        void resetAll();
+
+        MemoryBlockPool& blockPool() noexcept { return blocks; }
+
+    private:
+        // declared before the arenas since it must outlive them
+        MemoryBlockPool blocks;
+        std::vector<std::unique_ptr<MemoryArena>> arenas;
+    };
+
     template <typename T>
     T* MemoryArena::alloc(const std::size_t count, const bool zeroInitialize) {
         static_assert(std::is_default_constructible_v<T>,
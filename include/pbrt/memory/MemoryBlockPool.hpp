@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Memory.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace idragnev::pbrt::memory {
+    namespace detail {
+#ifdef _MSC_VER
+    #pragma warning(push)
+    #pragma warning(disable : 4324) // structure padding due to alignment specifier
+#endif
+        // The header of a memory block used by MemoryArena. It takes the
+        // first cache line of the block, the usable memory follows it.
+        struct alignas(constants::L1_CACHE_LINE_SIZE) MemoryBlock
+        {
+            // `allocationSize` includes the header
+            static MemoryBlock* allocate(const std::size_t allocationSize,
+                                         const PageSize pageSize);
+            static void free(MemoryBlock* const block);
+
+            std::uint8_t* memory() noexcept {
+                return reinterpret_cast<std::uint8_t*>(this) + sizeof(MemoryBlock);
+            }
+            std::size_t allocationSize() const noexcept {
+                return sizeof(MemoryBlock) + size;
+            }
+
+            // atomic, since a thread popping the block from a MemoryBlockPool
+            // may read it while another thread which has just popped it
+            // links it in a list
+            std::atomic<MemoryBlock*> next = nullptr;
+            // the number of usable bytes
+            std::size_t size = 0;
+            PageSize pageSize = PageSize::Default;
+        };
+#ifdef _MSC_VER
+    #pragma warning(pop)
+#endif
+
+        // An intrusive singly-linked list of blocks.
+        // Appending a whole list takes constant time.
+        class MemoryBlockList
+        {
+        public:
+            bool isEmpty() const noexcept { return head == nullptr; }
+            MemoryBlock* front() const noexcept { return head; }
+            MemoryBlock* back() const noexcept { return tail; }
+
+            void pushBack(MemoryBlock* const block) noexcept;
+            MemoryBlock* popFront() noexcept;
+            // Moves the blocks of `other` to the front of this list.
+            void prepend(MemoryBlockList& other) noexcept;
+            // Removes and returns the blocks following `block`,
+            // or all blocks if `block` is null.
+            MemoryBlockList splitAfter(MemoryBlock* const block) noexcept;
+
+            // Frees all blocks and empties the list.
+            void freeAll() noexcept;
+
+        private:
+            MemoryBlock* head = nullptr;
+            MemoryBlock* tail = nullptr;
+        };
+    } // namespace detail
+
+    // A thread-safe pool of free memory blocks of equal size, shared by
+    // the arenas of several threads. Blocks released by one arena are
+    // reused by the others instead of going back to the system allocator.
+    // The free blocks are kept in a lock-free stack.
+    class MemoryBlockPool
+    {
+    public:
+        // `blockSize` is the allocation size of each block
+        explicit MemoryBlockPool(const std::size_t blockSize = 262144u,
+                                 const PageSize pageSize = PageSize::Default)
+            : _blockSize(blockSize)
+            , _pageSize(pageSize) {}
+        ~MemoryBlockPool();
+
+        MemoryBlockPool(const MemoryBlockPool&) = delete;
+        MemoryBlockPool& operator=(const MemoryBlockPool&) = delete;
+
+        std::size_t blockSize() const noexcept { return _blockSize; }
+        PageSize pageSize() const noexcept { return _pageSize; }
+
+        // Pops a free block, allocating a new one if there are none.
+        detail::MemoryBlock* acquire();
+        // Pushes all blocks of `blocks`, which must have been allocated
+        // with blockSize() bytes and the page size of the pool.
+        void release(detail::MemoryBlockList& blocks);
+
+    private:
+        // The head of the stack is a pointer tagged with a version which is
+        // bumped by each change. A pop which read a head that was popped and
+        // pushed back in the meantime fails instead of corrupting the stack.
+        static constexpr unsigned TAG_SHIFT = sizeof(void*) == 8 ? 48 : 32;
+        static constexpr std::uint64_t POINTER_MASK =
+            (std::uint64_t(1) << TAG_SHIFT) - 1;
+
+        static std::uint64_t tagged(detail::MemoryBlock* const block,
+                                    const std::uint64_t previousHead) noexcept;
+        static detail::MemoryBlock* pointerOf(const std::uint64_t head) noexcept;
+
+    private:
+        std::size_t _blockSize = 0;
+        PageSize _pageSize = PageSize::Default;
+        std::atomic<std::uint64_t> head = 0;
+    };
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
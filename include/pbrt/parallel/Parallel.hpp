@@ -1,17 +1,28 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
+#include <type_traits>
+#include <memory>
+#include <vector>
+#include <numeric>
+#include <utility>
+#include <assert.h>
 
 namespace idragnev::pbrt::parallel {
     // Simple one-use barrier; ensures that multiple threads all reach a
     // particular point of execution before allowing any of them to proceed
-    // past it.
+    // past it. Waiting threads spin briefly before blocking, so threads
+    // which arrive close together are released with low latency.
     class Barrier
     {
     public:
         Barrier(const int threadsCount);
+        // Waits for the threads which are still returning from wait().
         ~Barrier();
 
         void wait();
@@ -19,16 +30,446 @@ namespace idragnev::pbrt::parallel {
     private:
         std::mutex mutex;
         std::condition_variable cv;
-        int threadsNotReached = 0;
+        std::atomic<int> threadsNotReached = 0;
+        // the threads which have not returned from wait() yet
+        std::atomic<int> threadsInside = 0;
     };
 
-    void init();
+    enum class Scheduler
+    {
+        // a single list of loops, guarded by a global mutex
+        WorkList,
+        // per-thread task deques with work stealing
+        WorkStealing,
+    };
+
+    namespace constants {
+        // the default number of elements processed serially
+        // by a single task of the parallel algorithms
+        inline constexpr std::int64_t ALGORITHMS_BLOCK_SIZE = 4096;
+    } // namespace constants
+
+    // How the threads of the pool are pinned to the cores of the system.
+    // Pinning is supported only on Linux and ignored elsewhere.
+    enum class ThreadAffinity
+    {
+        // no pinning, the OS may migrate the threads freely
+        None,
+        // fill the cores of one NUMA node before moving to the next one
+        Compact,
+        // spread the threads round-robin across the NUMA nodes,
+        // using distinct physical cores before their SMT siblings
+        Scatter,
+        // pin thread i to ThreadPoolOptions::cores[i % cores.size()]
+        ExplicitCores,
+    };
+
+    struct ThreadPoolOptions
+    {
+        Scheduler scheduler = Scheduler::WorkStealing;
+        // The number of threads executing parallel loops, including the
+        // thread which calls init(). 0 starts a worker per system core.
+        int threadsCount = 0;
+        ThreadAffinity affinity = ThreadAffinity::None;
+        // logical CPU ids, used by ThreadAffinity::ExplicitCores
+        std::vector<int> cores;
+    };
+
+    // The thread which calls init() takes part in the parallel loops
+    // and is pinned as thread 0. Its affinity is restored by cleanup().
+    // Before init() and after cleanup() the parallel loops, algorithms
+    // and tasks run serially on the calling thread.
+    void init(const ThreadPoolOptions& options);
+    void init(const Scheduler s = Scheduler::WorkStealing);
     void cleanup();
 
+    // The number of threads executing parallel loops,
+    // including the thread which called init().
+    int threadsCount() noexcept;
+
+    // Index of the calling thread in the pool, in [0, threadsCount()).
+    // The thread which called init() has index 0.
+    int thisThreadIndex() noexcept;
+
+    // The NUMA node of the core the calling thread is running on,
+    // or 0 if the system does not report one.
+    int thisThreadNumaNode() noexcept;
+
+    // How parallelFor divides its iterations into chunks.
+    // Converts implicitly from a fixed chunk size.
+    class Chunking
+    {
+    public:
+        Chunking(const std::int64_t fixedSize) noexcept
+            : _minSize(fixedSize) {
+            assert(fixedSize > 0);
+        }
+
+        // Like OpenMP's guided schedule, chunks start large and shrink as
+        // the remaining work drops: each chunk takes 1 / (2 * threadsCount)
+        // of the remaining iterations, but never less than `minSize`
+        // (unless fewer iterations are left).
+        // This keeps the per-chunk overhead low for cheap iterations
+        // without hurting the load balance at the end of the loop.
+        static Chunking guided(const std::int64_t minSize = 1) noexcept {
+            Chunking result(minSize);
+            result._isGuided = true;
+            return result;
+        }
+
+        std::int64_t minSize() const noexcept { return _minSize; }
+        bool isGuided() const noexcept { return _isGuided; }
+
+        // The size of the next chunk when
+        // `remainingIterations` iterations are left.
+        std::int64_t nextChunkSize(const std::int64_t remainingIterations,
+                                   const int threadsCount) const noexcept {
+            if (!_isGuided) {
+                return _minSize;
+            }
+
+            const auto share = remainingIterations / (2 * threadsCount);
+            const auto size = share > _minSize ? share : _minSize;
+
+            // do not leave a tail smaller than the minimum size
+            return remainingIterations - size < _minSize ? remainingIterations
+                                                         : size;
+        }
+
+    private:
+        std::int64_t _minSize = 1;
+        bool _isGuided = false;
+    };
+
+    // The order in which parallelFor2D hands out the tiles of its grid.
+    // Orders other than Scanline keep consecutive tiles spatially close,
+    // improving the cache locality of the data shared by neighbouring tiles.
+    enum class TileOrder
+    {
+        Scanline,
+        Morton,
+        Hilbert,
+        // outwards from the centre of the grid
+        Spiral,
+    };
+
+    struct TileScheduling
+    {
+        TileOrder order = TileOrder::Scanline;
+        // the number of consecutive (in `order`) tiles in a chunk
+        std::int64_t tilesPerChunk = 1;
+    };
+
+    namespace detail {
+        struct Tile
+        {
+            std::int64_t x = 0;
+            std::int64_t y = 0;
+        };
+
+        // Returns the tiles of the nX x nY grid, sorted in the given order.
+        std::vector<Tile> orderedTiles(const std::int64_t nX,
+                                       const std::int64_t nY,
+                                       const TileOrder order);
+
+        // A non-owning, type-erased reference to a callable
+        // which executes the loop iterations [first, last).
+        // Unlike std::function it never allocates.
+        class RangeFunctionRef
+        {
+        public:
+            template <typename F>
+                requires(!std::is_same_v<std::remove_cv_t<F>, RangeFunctionRef>)
+            RangeFunctionRef(F& f) noexcept
+                : callable(const_cast<void*>(
+                      static_cast<const void*>(std::addressof(f))))
+                , invokeFn([](void* c,
+                              const std::int64_t first,
+                              const std::int64_t last) {
+                    (*static_cast<F*>(c))(first, last);
+                }) {}
+
+            void operator()(const std::int64_t first,
+                            const std::int64_t last) const {
+                invokeFn(callable, first, last);
+            }
+
+        private:
+            void* callable = nullptr;
+            void (*invokeFn)(void*, std::int64_t, std::int64_t) = nullptr;
+        };
+
+        void parallelFor(const RangeFunctionRef func,
+                         const std::int64_t iterationsCount,
+                         const Chunking chunking);
+    } // namespace detail
+
+    // Calls `func(first, last)` for consecutive chunks [first, last)
+    // covering [0, iterationsCount), sized according to `chunking`.
+    template <typename F>
+        requires std::is_invocable_v<F&, std::int64_t, std::int64_t>
+    void parallelFor(F&& func,
+                     const std::int64_t iterationsCount,
+                     const Chunking chunking = 1) {
+        detail::parallelFor(func, iterationsCount, chunking);
+    }
+
+    // Calls `func(x, y)` for each x in [0, nX) and y in [0, nY),
+    // handing out the tiles (x, y) in the order set by `scheduling`.
+    template <typename F>
+        requires std::is_invocable_v<F&, std::int64_t, std::int64_t>
+    void parallelFor2D(F&& func,
+                       const std::int64_t nX,
+                       const std::int64_t nY,
+                       const TileScheduling& scheduling) {
+        const std::int64_t tilesCount = nX * nY;
+
+        if (scheduling.order == TileOrder::Scanline) {
+            auto rangeFunc = [&func, nX](const std::int64_t first,
+                                         const std::int64_t last) {
+                for (auto i = first; i < last; ++i) {
+                    func(i % nX, i / nX);
+                }
+            };
+
+            detail::parallelFor(rangeFunc,
+                                tilesCount,
+                                scheduling.tilesPerChunk);
+        }
+        else {
+            const std::vector<detail::Tile> tiles =
+                detail::orderedTiles(nX, nY, scheduling.order);
+
+            auto rangeFunc = [&func, &tiles](const std::int64_t first,
+                                             const std::int64_t last) {
+                for (auto i = first; i < last; ++i) {
+                    const detail::Tile& t = tiles[static_cast<std::size_t>(i)];
+                    func(t.x, t.y);
+                }
+            };
+
+            detail::parallelFor(rangeFunc,
+                                tilesCount,
+                                scheduling.tilesPerChunk);
+        }
+    }
+
+    template <typename F>
+        requires std::is_invocable_v<F&, std::int64_t, std::int64_t>
+    void parallelFor2D(F&& func, const std::int64_t nX, const std::int64_t nY) {
+        parallelFor2D(func, nX, nY, TileScheduling{});
+    }
+
     void parallelFor(std::function<void(std::int64_t)> func,
                      const std::int64_t iterationsCount,
-                     const std::int64_t chunkSize = 1);
+                     const Chunking chunking = 1);
     void parallelFor2D(std::function<void(std::int64_t, std::int64_t)> func,
                        const std::int64_t nX,
-                       const std::int64_t nY);
-} // namespace idragnev::pbrt::parallel
\ No newline at end of file
+                       const std::int64_t nY,
+                       const TileScheduling& scheduling = {});
+
+    // Requests cooperative cancellation of the loops it is passed to.
+    // Chunks which have already started run to completion,
+    // the ones which have not started yet are skipped.
+    class CancellationToken
+    {
+    public:
+        void cancel() noexcept { cancelled.store(true, std::memory_order_relaxed); }
+        bool isCancelled() const noexcept {
+            return cancelled.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<bool> cancelled = false;
+    };
+
+    struct LoopProgress
+    {
+        std::int64_t completedIterations = 0;
+        std::int64_t totalIterations = 0;
+        std::chrono::duration<double> elapsed{};
+        // extrapolated from the elapsed time, assuming a constant rate
+        std::chrono::duration<double> estimatedTimeLeft{};
+    };
+
+    // Optional cancellation and progress reporting for a loop.
+    // The loops which are not given a LoopControl pay nothing for them.
+    struct LoopControl
+    {
+        const CancellationToken* cancellation = nullptr;
+        // Called at most once per `progressInterval` while the loop runs and
+        // once more after it ends. The calls may come from any of the threads
+        // executing the loop, but never overlap.
+        std::function<void(const LoopProgress&)> onProgress;
+        std::chrono::milliseconds progressInterval{250};
+    };
+
+    namespace detail {
+        // Counts the completed iterations of a loop and
+        // calls LoopControl::onProgress.
+        class ProgressReporter
+        {
+        public:
+            ProgressReporter(const LoopControl& control,
+                             const std::int64_t totalIterations);
+
+            void add(const std::int64_t iterations);
+            void finish();
+
+        private:
+            void report();
+
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            const std::function<void(const LoopProgress&)>& onProgress;
+            const std::int64_t totalIterations = 0;
+            const Clock::duration interval;
+            const Clock::time_point start;
+
+            std::atomic<std::int64_t> completedIterations = 0;
+            std::atomic<Clock::rep> nextReportTicks = 0;
+            std::mutex reportMutex;
+        };
+    } // namespace detail
+
+    // Versions of parallelFor and parallelFor2D which check the cancellation
+    // token before each chunk (tile) and report the completed iterations.
+    template <typename F>
+        requires std::is_invocable_v<F&, std::int64_t, std::int64_t>
+    void parallelFor(F&& func,
+                     const std::int64_t iterationsCount,
+                     const Chunking chunking,
+                     const LoopControl& control);
+    template <typename F>
+        requires std::is_invocable_v<F&, std::int64_t, std::int64_t>
+    void parallelFor2D(F&& func,
+                       const std::int64_t nX,
+                       const std::int64_t nY,
+                       const TileScheduling& scheduling,
+                       const LoopControl& control);
+
+    void parallelFor(std::function<void(std::int64_t)> func,
+                     const std::int64_t iterationsCount,
+                     const Chunking chunking,
+                     const LoopControl& control);
+    void parallelFor2D(std::function<void(std::int64_t, std::int64_t)> func,
+                       const std::int64_t nX,
+                       const std::int64_t nY,
+                       const TileScheduling& scheduling,
+                       const LoopControl& control);
+
+    namespace detail {
+        // A heap-allocated task spawned in a TaskGroup.
+        class SpawnedTask
+        {
+        public:
+            explicit SpawnedTask(std::atomic<std::int64_t>& pendingTasks) noexcept
+                : pendingTasks(&pendingTasks) {}
+            virtual ~SpawnedTask() = default;
+
+            // Runs the task, destroys it and then notifies its group.
+            void execute();
+
+        private:
+            virtual void run() = 0;
+
+        private:
+            std::atomic<std::int64_t>* pendingTasks = nullptr;
+        };
+
+        template <typename F>
+        class SpawnedTaskImpl final : public SpawnedTask
+        {
+        public:
+            template <typename G>
+            SpawnedTaskImpl(std::atomic<std::int64_t>& pendingTasks, G&& g)
+                : SpawnedTask(pendingTasks)
+                , func(std::forward<G>(g)) {}
+
+        private:
+            void run() override { func(); }
+
+        private:
+            F func;
+        };
+
+        // Queues the task for execution by the worker pool.
+        void submit(SpawnedTask* const task);
+    } // namespace detail
+
+    // Fork-join parallelism for recursive divide-and-conquer work.
+    // The spawned tasks may execute in parallel with the spawning thread
+    // until wait() is called. While waiting, the thread executes other
+    // queued tasks and loop iterations instead of blocking, so task groups
+    // may be nested in other tasks and in parallelFor bodies.
+    class TaskGroup
+    {
+    public:
+        TaskGroup() = default;
+        ~TaskGroup() { wait(); }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        template <typename F>
+            requires std::is_invocable_v<std::decay_t<F>&>
+        void spawn(F&& func);
+
+        // Returns after all tasks spawned in this group are done.
+        void wait();
+
+    private:
+        std::atomic<std::int64_t> pendingTasks = 0;
+    };
+
+    // Reduces the iterations [0, iterationsCount) to a single value.
+    // The iterations are split into blocks of `blockSize` iterations.
+    // Each block is reduced in parallel by calling `func(acc, i)`, which
+    // accumulates iteration i into `acc` (a T& initialized with `identity`),
+    // and the blocks' results are combined in order with `combine`.
+    // Since the blocks do not depend on the number of threads, the result
+    // is deterministic even for non-associative operations.
+    template <typename T, typename F, typename Combine>
+    T parallelReduce(const std::int64_t iterationsCount,
+                     const T& identity,
+                     F&& func,
+                     Combine&& combine,
+                     const std::int64_t blockSize =
+                         constants::ALGORITHMS_BLOCK_SIZE);
+
+    // Parallel versions of std::inclusive_scan and std::exclusive_scan.
+    // `op` must be associative. The scans may be done in place.
+    template <typename InputIt,
+              typename OutputIt,
+              typename BinaryOp = std::plus<>>
+    OutputIt parallelInclusiveScan(const InputIt first,
+                                   const InputIt last,
+                                   const OutputIt dFirst,
+                                   BinaryOp op = {},
+                                   const std::int64_t blockSize =
+                                       constants::ALGORITHMS_BLOCK_SIZE);
+    template <typename InputIt,
+              typename OutputIt,
+              typename T,
+              typename BinaryOp = std::plus<>>
+    OutputIt parallelExclusiveScan(const InputIt first,
+                                   const InputIt last,
+                                   const OutputIt dFirst,
+                                   T init,
+                                   BinaryOp op = {},
+                                   const std::int64_t blockSize =
+                                       constants::ALGORITHMS_BLOCK_SIZE);
+
+    // Parallel version of std::stable_partition.
+    // Evaluates `pred` exactly once for each element and uses
+    // a temporary buffer for the whole range.
+    template <typename RandomIt, typename Pred>
+    RandomIt parallelStablePartition(const RandomIt first,
+                                     const RandomIt last,
+                                     Pred pred,
+                                     const std::int64_t blockSize =
+                                         constants::ALGORITHMS_BLOCK_SIZE);
+} // namespace idragnev::pbrt::parallel
+
+#include "ParallelImpl.hpp"
\ No newline at end of file
@@ -0,0 +1,334 @@
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace idragnev::pbrt::parallel {
+    namespace detail {
+        inline std::int64_t blocksCount(const std::int64_t iterationsCount,
+                                        const std::int64_t blockSize) {
+            return (iterationsCount + blockSize - 1) / blockSize;
+        }
+
+        // Computes op(...op(op(x0, x1), x2)..., xn) for each block of
+        // `blockSize` elements in [first, last) in parallel.
+        template <typename InputIt, typename BinaryOp>
+        auto blockSums(const InputIt first,
+                       const std::int64_t count,
+                       const std::int64_t blockSize,
+                       BinaryOp& op) {
+            using T = std::iter_value_t<InputIt>;
+
+            std::vector<T> sums;
+            sums.reserve(static_cast<std::size_t>(blocksCount(count, blockSize)));
+            for (std::int64_t b = 0; b < count; b += blockSize) {
+                sums.push_back(first[b]);
+            }
+
+            parallel::parallelFor(
+                [&](const std::int64_t firstBlock, const std::int64_t lastBlock) {
+                    for (auto b = firstBlock; b < lastBlock; ++b) {
+                        const auto blockFirst = b * blockSize;
+                        const auto blockLast = std::min(blockFirst + blockSize, count);
+
+                        T& sum = sums[static_cast<std::size_t>(b)];
+                        for (auto i = blockFirst + 1; i < blockLast; ++i) {
+                            sum = op(std::move(sum), first[i]);
+                        }
+                    }
+                },
+                static_cast<std::int64_t>(sums.size()));
+
+            return sums;
+        }
+    } // namespace detail
+
+    template <typename F>
+        requires std::is_invocable_v<F&, std::int64_t, std::int64_t>
+    void parallelFor(F&& func,
+                     const std::int64_t iterationsCount,
+                     const Chunking chunking,
+                     const LoopControl& control) {
+        const CancellationToken* const token = control.cancellation;
+        std::optional<detail::ProgressReporter> progress;
+        if (control.onProgress) {
+            progress.emplace(control, iterationsCount);
+        }
+
+        auto rangeFunc = [&func, &progress, token](const std::int64_t first,
+                                                   const std::int64_t last) {
+            if (token != nullptr && token->isCancelled()) {
+                return;
+            }
+
+            func(first, last);
+
+            if (progress.has_value()) {
+                progress->add(last - first);
+            }
+        };
+
+        detail::parallelFor(rangeFunc, iterationsCount, chunking);
+
+        if (progress.has_value()) {
+            progress->finish();
+        }
+    }
+
+    template <typename F>
+        requires std::is_invocable_v<F&, std::int64_t, std::int64_t>
+    void parallelFor2D(F&& func,
+                       const std::int64_t nX,
+                       const std::int64_t nY,
+                       const TileScheduling& scheduling,
+                       const LoopControl& control) {
+        const CancellationToken* const token = control.cancellation;
+        std::optional<detail::ProgressReporter> progress;
+        if (control.onProgress) {
+            progress.emplace(control, nX * nY);
+        }
+
+        auto tileFunc = [&func, &progress, token](const std::int64_t x,
+                                                  const std::int64_t y) {
+            if (token != nullptr && token->isCancelled()) {
+                return;
+            }
+
+            func(x, y);
+
+            if (progress.has_value()) {
+                progress->add(1);
+            }
+        };
+
+        parallelFor2D(tileFunc, nX, nY, scheduling);
+
+        if (progress.has_value()) {
+            progress->finish();
+        }
+    }
+
+    template <typename F>
+        requires std::is_invocable_v<std::decay_t<F>&>
+    void TaskGroup::spawn(F&& func) {
+        pendingTasks.fetch_add(1, std::memory_order_relaxed);
+        detail::submit(new detail::SpawnedTaskImpl<std::decay_t<F>>(
+            pendingTasks,
+            std::forward<F>(func)));
+    }
+
+    template <typename T, typename F, typename Combine>
+    T parallelReduce(const std::int64_t iterationsCount,
+                     const T& identity,
+                     F&& func,
+                     Combine&& combine,
+                     const std::int64_t blockSize) {
+        assert(blockSize > 0);
+
+        const auto reduceBlock = [&identity, &func](const std::int64_t first,
+                                                    const std::int64_t last) {
+            T acc = identity;
+            for (auto i = first; i < last; ++i) {
+                func(acc, i);
+            }
+            return acc;
+        };
+
+        if (iterationsCount <= blockSize) {
+            return reduceBlock(0, iterationsCount);
+        }
+
+        std::vector<T> partials(
+            static_cast<std::size_t>(
+                detail::blocksCount(iterationsCount, blockSize)),
+            identity);
+
+        parallelFor(
+            [&](const std::int64_t firstBlock, const std::int64_t lastBlock) {
+                for (auto b = firstBlock; b < lastBlock; ++b) {
+                    partials[static_cast<std::size_t>(b)] = reduceBlock(
+                        b * blockSize,
+                        std::min((b + 1) * blockSize, iterationsCount));
+                }
+            },
+            static_cast<std::int64_t>(partials.size()));
+
+        T result = identity;
+        for (T& partial : partials) {
+            result = combine(std::move(result), std::move(partial));
+        }
+
+        return result;
+    }
+
+    template <typename InputIt, typename OutputIt, typename BinaryOp>
+    OutputIt parallelInclusiveScan(const InputIt first,
+                                   const InputIt last,
+                                   const OutputIt dFirst,
+                                   BinaryOp op,
+                                   const std::int64_t blockSize) {
+        assert(blockSize > 0);
+
+        const auto count = static_cast<std::int64_t>(std::distance(first, last));
+        if (count <= blockSize) {
+            return std::inclusive_scan(first, last, dFirst, op);
+        }
+
+        // the sum of all blocks before block b is stored in offsets[b - 1]
+        auto offsets = detail::blockSums(first, count, blockSize, op);
+        for (std::size_t b = 1; b < offsets.size(); ++b) {
+            offsets[b] = op(offsets[b - 1], offsets[b]);
+        }
+
+        parallelFor(
+            [&](const std::int64_t firstBlock, const std::int64_t lastBlock) {
+                for (auto b = firstBlock; b < lastBlock; ++b) {
+                    const auto blockFirst = b * blockSize;
+                    const auto blockLast = std::min(blockFirst + blockSize, count);
+
+                    auto acc = (b == 0)
+                                   ? first[0]
+                                   : op(offsets[static_cast<std::size_t>(b - 1)],
+                                        first[blockFirst]);
+                    dFirst[blockFirst] = acc;
+                    for (auto i = blockFirst + 1; i < blockLast; ++i) {
+                        acc = op(std::move(acc), first[i]);
+                        dFirst[i] = acc;
+                    }
+                }
+            },
+            static_cast<std::int64_t>(offsets.size()));
+
+        return dFirst + count;
+    }
+
+    template <typename InputIt, typename OutputIt, typename T, typename BinaryOp>
+    OutputIt parallelExclusiveScan(const InputIt first,
+                                   const InputIt last,
+                                   const OutputIt dFirst,
+                                   T init,
+                                   BinaryOp op,
+                                   const std::int64_t blockSize) {
+        assert(blockSize > 0);
+
+        const auto count = static_cast<std::int64_t>(std::distance(first, last));
+        if (count <= blockSize) {
+            return std::exclusive_scan(first, last, dFirst, std::move(init), op);
+        }
+
+        // the sum of init and all blocks before block b is stored in offsets[b]
+        auto sums = detail::blockSums(first, count, blockSize, op);
+        std::vector<T> offsets;
+        offsets.reserve(sums.size());
+        offsets.push_back(std::move(init));
+        for (std::size_t b = 1; b < sums.size(); ++b) {
+            offsets.push_back(op(offsets[b - 1], std::move(sums[b - 1])));
+        }
+
+        parallelFor(
+            [&](const std::int64_t firstBlock, const std::int64_t lastBlock) {
+                for (auto b = firstBlock; b < lastBlock; ++b) {
+                    const auto blockFirst = b * blockSize;
+                    const auto blockLast = std::min(blockFirst + blockSize, count);
+
+                    T acc = offsets[static_cast<std::size_t>(b)];
+                    for (auto i = blockFirst; i < blockLast; ++i) {
+                        // read before writing - the scan may be in place
+                        auto value = first[i];
+                        dFirst[i] = acc;
+                        acc = op(std::move(acc), std::move(value));
+                    }
+                }
+            },
+            static_cast<std::int64_t>(offsets.size()));
+
+        return dFirst + count;
+    }
+
+    template <typename RandomIt, typename Pred>
+    RandomIt parallelStablePartition(const RandomIt first,
+                                     const RandomIt last,
+                                     Pred pred,
+                                     const std::int64_t blockSize) {
+        using T = std::iter_value_t<RandomIt>;
+
+        assert(blockSize > 0);
+
+        const auto count = static_cast<std::int64_t>(last - first);
+        if (count <= blockSize) {
+            return std::stable_partition(first, last, pred);
+        }
+
+        const auto blocksCount = detail::blocksCount(count, blockSize);
+        const auto blockRange = [blockSize, count](const std::int64_t b) {
+            return std::make_pair(b * blockSize,
+                                  std::min((b + 1) * blockSize, count));
+        };
+
+        // 1. evaluate the predicate once for each element
+        //    and count the matching elements of each block
+        std::vector<std::uint8_t> matches(static_cast<std::size_t>(count));
+        std::vector<std::int64_t> matchesBefore(
+            static_cast<std::size_t>(blocksCount));
+        parallelFor(
+            [&](const std::int64_t firstBlock, const std::int64_t lastBlock) {
+                for (auto b = firstBlock; b < lastBlock; ++b) {
+                    const auto [blockFirst, blockLast] = blockRange(b);
+
+                    std::int64_t n = 0;
+                    for (auto i = blockFirst; i < blockLast; ++i) {
+                        const bool match = pred(first[i]);
+                        matches[static_cast<std::size_t>(i)] = match ? 1 : 0;
+                        n += match ? 1 : 0;
+                    }
+                    matchesBefore[static_cast<std::size_t>(b)] = n;
+                }
+            },
+            blocksCount);
+
+        // 2. compute where each block's elements go
+        std::int64_t matchesCount = 0;
+        for (std::int64_t& n : matchesBefore) {
+            matchesCount += std::exchange(n, matchesCount);
+        }
+
+        // 3. move the elements to their positions in a buffer
+        //    and then back to the original range
+        std::allocator<T> allocator;
+        T* const buffer = allocator.allocate(static_cast<std::size_t>(count));
+
+        parallelFor(
+            [&](const std::int64_t firstBlock, const std::int64_t lastBlock) {
+                for (auto b = firstBlock; b < lastBlock; ++b) {
+                    const auto [blockFirst, blockLast] = blockRange(b);
+
+                    auto matchPos = matchesBefore[static_cast<std::size_t>(b)];
+                    auto nonMatchPos = matchesCount + (blockFirst - matchPos);
+                    for (auto i = blockFirst; i < blockLast; ++i) {
+                        const auto pos =
+                            matches[static_cast<std::size_t>(i)] ? matchPos++
+                                                                 : nonMatchPos++;
+                        std::construct_at(buffer + pos, std::move(first[i]));
+                    }
+                }
+            },
+            blocksCount);
+
+        parallelFor(
+            [&](const std::int64_t from, const std::int64_t to) {
+                for (auto i = from; i < to; ++i) {
+                    first[i] = std::move(buffer[i]);
+                    std::destroy_at(buffer + i);
+                }
+            },
+            count,
+            blockSize);
+
+        allocator.deallocate(buffer, static_cast<std::size_t>(count));
+
+        return first + matchesCount;
+    }
+} // namespace idragnev::pbrt::parallel
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Parallel.hpp"
+#include "pbrt/memory/Memory.hpp"
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <assert.h>
+
+namespace idragnev::pbrt::parallel {
+    // Keeps a separate value of T for each thread of the worker pool,
+    // indexed by thisThreadIndex(). The values are stored in separate
+    // cache lines, so threads updating their own values do not slow each
+    // other down through false sharing.
+    // Each value is created the first time its thread calls get(), on that
+    // thread, so the memory the value allocates itself is first-touched on
+    // the thread's NUMA node. The slots holding the values are allocated
+    // and touched by the thread creating the ThreadLocal.
+    // Must be created after init(), since it keeps threadsCount() values.
+    template <typename T>
+    class ThreadLocal
+    {
+    private:
+#ifdef _MSC_VER
+    #pragma warning(push)
+    #pragma warning(disable : 4324) // structure padding due to alignment specifier
+#endif
+        struct alignas(memory::constants::L1_CACHE_LINE_SIZE) Slot
+        {
+            std::optional<T> value;
+        };
+#ifdef _MSC_VER
+    #pragma warning(pop)
+#endif
+
+    public:
+        ThreadLocal() : ThreadLocal([](int) { return T{}; }) {}
+        // `create(threadIndex)` creates the value of the given thread
+        explicit ThreadLocal(std::function<T(int)> create)
+            : create(std::move(create))
+            , slotsCount(static_cast<std::size_t>(threadsCount()))
+            , slots(std::make_unique<Slot[]>(slotsCount)) {}
+
+        ThreadLocal(const ThreadLocal&) = delete;
+        ThreadLocal& operator=(const ThreadLocal&) = delete;
+
+        // The value of the calling thread.
+        T& get();
+
+        // Calls `func(value)` for each created value, in thread index order.
+        // Must not be called while other threads are using their values,
+        // e.g. call it after the parallel loop that produced them.
+        template <typename F>
+        void forEach(F&& func);
+
+        // Folds the created values in thread index order:
+        // combine(...combine(combine(init, v0), v1)..., vn).
+        // The same restrictions as in forEach apply.
+        template <typename R, typename Combine>
+        R combine(R init, Combine&& combine) const;
+
+    private:
+        std::function<T(int)> create;
+        std::size_t slotsCount = 0;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    template <typename T>
+    T& ThreadLocal<T>::get() {
+        const auto index = static_cast<std::size_t>(thisThreadIndex());
+        assert(index < slotsCount);
+
+        Slot& slot = slots[index];
+        if (!slot.value.has_value()) {
+            slot.value.emplace(create(static_cast<int>(index)));
+        }
+
+        return *slot.value;
+    }
+
+    template <typename T>
+    template <typename F>
+    void ThreadLocal<T>::forEach(F&& func) {
+        for (std::size_t i = 0; i < slotsCount; ++i) {
+            if (slots[i].value.has_value()) {
+                func(*slots[i].value);
+            }
+        }
+    }
+
+    template <typename T>
+    template <typename R, typename Combine>
+    R ThreadLocal<T>::combine(R init, Combine&& combine) const {
+        for (std::size_t i = 0; i < slotsCount; ++i) {
+            if (slots[i].value.has_value()) {
+                init = combine(std::move(init), *slots[i].value);
+            }
+        }
+
+        return init;
+    }
+} // namespace idragnev::pbrt::parallel
\ No newline at end of file
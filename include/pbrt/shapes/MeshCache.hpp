@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <filesystem>
+#include <memory>
+
+namespace idragnev::pbrt::shapes {
+    namespace constants {
+        // Bumped on each change of the layout, the caches
+        // of the other versions are ignored
+        inline constexpr std::uint32_t MESH_CACHE_VERSION = 1;
+    } // namespace constants
+
+    // A binary mesh cache keeps the world space positions, the indices and
+    // the attributes of a TriangleMesh laid out exactly as the mesh keeps
+    // them in memory. Loading a cache maps it read-only and the mesh views
+    // the mapped data, so no parsing nor transforming is done, the pages
+    // are loaded on first access and are shared between the processes
+    // rendering the same scene.
+
+    // Writes to a temporary file which is then renamed, so concurrent
+    // loaders never see a partially written cache.
+    bool writeMeshCache(const TriangleMesh& mesh,
+                        const std::filesystem::path& path);
+
+    // Returns nullptr if the cache is missing, was written by another
+    // version or for another Float or byte order, or is malformed,
+    // e.g. truncated or indexing vertices it does not have. The indices
+    // are read once to check them.
+    // The alpha masks are textures and are not cached.
+    std::shared_ptr<const TriangleMesh> loadMeshCache(
+        const std::filesystem::path& path,
+        std::shared_ptr<const Texture<Float>> alphaMask = nullptr,
+        std::shared_ptr<const Texture<Float>> shadowAlphaMask = nullptr);
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
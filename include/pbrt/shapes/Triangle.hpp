@@ -2,14 +2,125 @@
 
 #include "pbrt/core/core.hpp"
 #include "pbrt/core/Shape.hpp"
+#include "pbrt/core/math/Half.hpp"
+#include "pbrt/core/math/OctahedralVector.hpp"
+#include "pbrt/memory/MemoryAccounting.hpp"
 
 #include <vector>
 #include <memory>
 #include <array>
+#include <span>
+
+namespace idragnev::pbrt::memory {
+    class MappedFile;
+} // namespace idragnev::pbrt::memory
 
 namespace idragnev::pbrt::shapes {
+    namespace detail {
+        struct MeshCacheIO;
+    } // namespace detail
+
+    // How a TriangleMesh stores its indices and vertex attributes.
+    // The vertex positions are always kept in full precision.
+    enum class MeshStorage
+    {
+        // 64-bit indices, full precision normals, tangents and UVs
+        Full,
+        // 16-bit indices for meshes with up to 65536 vertices and 32-bit
+        // ones otherwise, octahedral normals and tangents (4 bytes each)
+        // and half precision UVs
+        Compact,
+    };
+
+    // Mesh data which is either owned or a view of memory owned by
+    // someone else, e.g. a mapped mesh cache.
+    template <typename T, memory::MemoryTag Tag>
+    class MeshArray
+    {
+    public:
+        using Vector = std::vector<T, memory::TaggedAllocator<T, Tag>>;
+
+        MeshArray() = default;
+        MeshArray(Vector values) noexcept
+            : storage(std::move(values))
+            , view(storage) {}
+        MeshArray(const std::span<const T> view) noexcept : view(view) {}
+
+        // The view of a moved vector still refers to its elements,
+        // but the view of a copied one would not.
+        MeshArray(MeshArray&&) noexcept = default;
+        MeshArray& operator=(MeshArray&&) noexcept = default;
+        MeshArray(const MeshArray&) = delete;
+        MeshArray& operator=(const MeshArray&) = delete;
+
+        const T& operator[](const std::size_t i) const noexcept {
+            return view[i];
+        }
+
+        std::size_t size() const noexcept { return view.size(); }
+        bool empty() const noexcept { return view.empty(); }
+        const T* data() const noexcept { return view.data(); }
+        auto begin() const noexcept { return view.begin(); }
+        auto end() const noexcept { return view.end(); }
+
+    private:
+        Vector storage;
+        std::span<const T> view;
+    };
+
+    // Indices stored with 2, 4 or 8 bytes each.
+    class MeshIndexBuffer
+    {
+    private:
+        template <typename T>
+        using IndicesArray = MeshArray<T, memory::MemoryTag::MeshIndices>;
+
+    public:
+        MeshIndexBuffer() = default;
+        // Compact buffers use the narrowest width which fits the indices
+        MeshIndexBuffer(const std::vector<std::size_t>& indices,
+                        const MeshStorage storage);
+        // A view of `size` indices of `bytesPerIndex` bytes each
+        MeshIndexBuffer(const void* const indices,
+                        const std::size_t size,
+                        const unsigned bytesPerIndex);
+
+        std::size_t operator[](const std::size_t i) const noexcept {
+            switch (_bytesPerIndex) {
+                case 2: return indices16[i];
+                case 4: return indices32[i];
+                default: return indices64[i];
+            }
+        }
+
+        const void* data() const noexcept {
+            switch (_bytesPerIndex) {
+                case 2: return indices16.data();
+                case 4: return indices32.data();
+                default: return indices64.data();
+            }
+        }
+
+        std::size_t size() const noexcept { return _size; }
+        bool empty() const noexcept { return _size == 0; }
+        unsigned bytesPerIndex() const noexcept { return _bytesPerIndex; }
+
+    private:
+        IndicesArray<std::uint16_t> indices16;
+        IndicesArray<std::uint32_t> indices32;
+        IndicesArray<std::size_t> indices64;
+        std::size_t _size = 0;
+        unsigned _bytesPerIndex = 8;
+    };
+
     struct TriangleMesh
     {
+        // The mesh data is accounted under the mesh memory tags
+        template <typename T>
+        using VerticesArray = MeshArray<T, memory::MemoryTag::MeshVertices>;
+        template <typename T>
+        using VerticesVec = typename VerticesArray<T>::Vector;
+
         TriangleMesh(
             const Transformation& objectToWorld,
             const unsigned trianglesCount,
@@ -20,37 +131,51 @@ namespace idragnev::pbrt::shapes {
             const std::vector<Point2f>& vertexUVs,
             std::shared_ptr<const Texture<Float>> alphaMask,
             std::shared_ptr<const Texture<Float>> shadowAlphaMask,
-            const std::vector<std::size_t>& faceIndices);
+            const std::vector<std::size_t>& faceIndices,
+            const MeshStorage storage = MeshStorage::Full);
+
+        // The attributes of a vertex, decoded from the storage
+        bool hasNormals() const noexcept;
+        bool hasTangents() const noexcept;
+        bool hasUVs() const noexcept;
+        Normal3f normal(const std::size_t vertex) const noexcept;
+        Vector3f tangent(const std::size_t vertex) const noexcept;
+        Point2f uv(const std::size_t vertex) const noexcept;
+
+        std::size_t faceIndex(const std::size_t triangle) const noexcept {
+            return faceIndices.empty() ? 0 : faceIndices[triangle];
+        }
 
         unsigned trianglesCount = 0;
         unsigned verticesCount = 0;
-        std::vector<std::size_t> vertexIndices;
-        std::vector<Point3f> vertexWorldCoordinates;
-        std::vector<Normal3f> vertexNormalVectors;
-        std::vector<Vector3f> vertexTangentVectors;
-        std::vector<Point2f> vertexUVs;
+        MeshStorage storage = MeshStorage::Full;
+        MeshIndexBuffer vertexIndices;
+        VerticesArray<Point3f> vertexWorldCoordinates;
         std::shared_ptr<const Texture<Float>> alphaMask;
         std::shared_ptr<const Texture<Float>> shadowAlphaMask;
-        std::vector<std::size_t> faceIndices;
+        MeshIndexBuffer faceIndices;
+
+    private:
+        friend struct detail::MeshCacheIO;
+
+        TriangleMesh() = default;
+
+    private:
+        // only the arrays of the storage mode are filled
+        VerticesArray<Normal3f> vertexNormalVectors;
+        VerticesArray<Vector3f> vertexTangentVectors;
+        VerticesArray<Point2f> vertexUVs;
+        VerticesArray<math::OctahedralVector> compactNormalVectors;
+        VerticesArray<math::OctahedralVector> compactTangentVectors;
+        VerticesArray<math::Half> compactUVs;
+        // the mapped mesh cache which the arrays view, if any
+        std::shared_ptr<const memory::MappedFile> mappedFile;
     };
 
+    // A triangle of a mesh as a separate shape.
+    // TriangleMeshShape avoids the per-triangle objects.
     class Triangle : public Shape
     {
-    private:
-        struct PartialDerivatives
-        {
-            Vector3f dpdu;
-            Vector3f dpdv;
-        };
-
-        struct RayCoordinateSpaceVertices
-        {
-            Point3f p0;
-            Point3f p1;
-            Point3f p2;
-            Float sz;
-        };
-
     public:
         Triangle(const Transformation& objectToWorld,
                  const Transformation& worldToObject,
@@ -69,41 +194,20 @@ namespace idragnev::pbrt::shapes {
 
         Float area() const override;
 
-    private:
-        template <typename R, typename S, typename F>
-        R intersectImpl(const Ray& ray,
-                        const bool testAlphaTexture,
-                        F failure,
-                        S success) const;
-
-        Optional<PartialDerivatives> computePartialDerivatives() const;
-
-        HitRecord makeHitRecord(const Ray& ray,
-                                const Float t,
-                                const Point3f& hitPoint,
-                                const Vector3f& pError,
-                                const Point2f& hitPointUV,
-                                const PartialDerivatives& derivatives,
-                                const Float barycentric[3]) const;
-        void setShadingGeometry(SurfaceInteraction& interaction,
-                                const Float barycentric[3]) const;
-
-        std::tuple<const Point3f&, const Point3f&, const Point3f&>
-        verticesCoordinates() const;
-        std::array<Point2f, 3> verticesUVs() const;
-
-        // shears only the x and y dimensions
-        RayCoordinateSpaceVertices
-        verticesInRayCoordinateSpace(const Ray& ray) const;
-
-        static std::array<Float, 3> edgeFunctionValues(const Point3f& p0,
-                                                       const Point3f& p1,
-                                                       const Point3f& p2);
+        void intersectPartPacket(const std::span<const Ray> rays,
+                                 const std::uint32_t part,
+                                 const std::uint32_t activeMask,
+                                 const std::span<Optional<HitRecord>> hits,
+                                 const bool testAlphaTexture) const override;
+        std::uint32_t
+        intersectPartPacketP(const std::span<const Ray> rays,
+                             const std::uint32_t part,
+                             const std::uint32_t activeMask,
+                             const bool testAlphaTexture) const override;
 
     private:
         std::shared_ptr<const TriangleMesh> parentMesh = nullptr;
-        const std::size_t* firstVertexIndexAddress = nullptr;
-        std::size_t faceIndex = 0;
+        unsigned number = 0;
     };
 
     std::vector<std::shared_ptr<Shape>> createTriangleMesh(
@@ -118,5 +222,6 @@ namespace idragnev::pbrt::shapes {
         const std::vector<Point2f>& vertexUVs,
         std::shared_ptr<const Texture<Float>> alphaMask,
         std::shared_ptr<const Texture<Float>> shadowAlphaMask,
-        const std::vector<std::size_t>& faceIndices);
+        const std::vector<std::size_t>& faceIndices,
+        const MeshStorage storage = MeshStorage::Full);
 } // namespace idragnev::pbrt::shapes
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace idragnev::pbrt::shapes {
+    // A whole triangle mesh as a single shape. Its triangles are the
+    // parts of the shape, so an aggregate addresses them by
+    // (mesh, triangle index) instead of by a Triangle object per triangle.
+    class TriangleMeshShape : public Shape
+    {
+    public:
+        TriangleMeshShape(const Transformation& objectToWorld,
+                          const Transformation& worldToObject,
+                          const bool reverseOrientation,
+                          std::shared_ptr<const TriangleMesh> mesh);
+
+        const TriangleMesh& mesh() const noexcept { return *_mesh; }
+
+        Bounds3f objectBound() const override;
+        Bounds3f worldBound() const override;
+
+        // Test all triangles, the aggregates should intersect
+        // the triangles with intersectPart instead
+        Optional<HitRecord>
+        intersect(const Ray& ray, const bool testAlphaTexture) const override;
+        bool intersectP(const Ray& ray,
+                        const bool testAlphaTexture) const override;
+
+        Float area() const override;
+
+        std::uint32_t partsCount() const override;
+        Bounds3f partWorldBound(const std::uint32_t triangle) const override;
+        Optional<HitRecord>
+        intersectPart(const Ray& ray,
+                      const std::uint32_t triangle,
+                      const bool testAlphaTexture) const override;
+        bool intersectPartP(const Ray& ray,
+                            const std::uint32_t triangle,
+                            const bool testAlphaTexture) const override;
+        void intersectPartPacket(const std::span<const Ray> rays,
+                                 const std::uint32_t triangle,
+                                 const std::uint32_t activeMask,
+                                 const std::span<Optional<HitRecord>> hits,
+                                 const bool testAlphaTexture) const override;
+        std::uint32_t
+        intersectPartPacketP(const std::span<const Ray> rays,
+                             const std::uint32_t triangle,
+                             const std::uint32_t activeMask,
+                             const bool testAlphaTexture) const override;
+
+    private:
+        std::shared_ptr<const TriangleMesh> _mesh;
+    };
+
+    std::shared_ptr<TriangleMeshShape> createTriangleMeshShape(
+        const Transformation& objectToWorld,
+        const Transformation& worldToObject,
+        const bool reverseOrientation,
+        const unsigned trianglesCount,
+        const std::vector<std::size_t>& vertexIndices,
+        const std::vector<Point3f>& vertexCoordinates,
+        const std::vector<Vector3f>& vertexTangentVectors,
+        const std::vector<Normal3f>& vertexNormalVectors,
+        const std::vector<Point2f>& vertexUVs,
+        std::shared_ptr<const Texture<Float>> alphaMask,
+        std::shared_ptr<const Texture<Float>> shadowAlphaMask,
+        const std::vector<std::size_t>& faceIndices,
+        const MeshStorage storage = MeshStorage::Full);
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
@@ -1,9 +1,18 @@
 #include "pbrt/accelerators/bvh/BVH.hpp"
 #include "pbrt/accelerators/bvh/RecursiveBuilder.hpp"
 #include "pbrt/accelerators/bvh/HLBVHBuilder.hpp"
+#include "WideBVHNode.hpp"
+#include "QuantizedBVHNode.hpp"
+#include "RayPacket.hpp"
+#include "RayStream.hpp"
 #include "pbrt/core/SurfaceInteraction.hpp"
 #include "pbrt/memory/Memory.hpp"
 
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
 namespace idragnev::pbrt::accelerators {
     class NodeIndicesStack
     {
@@ -18,6 +27,24 @@ namespace idragnev::pbrt::accelerators {
         std::size_t data[64] = {};
     };
 
+    // A node to be visited by the rays of a packet set in `raysMask`
+    struct PacketNodeToVisit
+    {
+        std::size_t nodeIndex = 0;
+        std::uint32_t raysMask = 0;
+    };
+
+    // A node to be visited by the rays of a stream whose ids are
+    // ids[first, first + count). The ids before `idsEnd` are kept,
+    // since they may belong to the siblings of the node.
+    struct StreamNodeToVisit
+    {
+        std::size_t nodeIndex = 0;
+        std::size_t first = 0;
+        std::size_t count = 0;
+        std::size_t idsEnd = 0;
+    };
+
     struct BVH::FlattenResult
     {
         std::size_t rootIndex = 0;
@@ -28,10 +55,11 @@ namespace idragnev::pbrt::accelerators {
     #pragma warning(push)
     #pragma warning(disable : 4324) // structure padding due to alignment specifier
 #endif
-    // Ensure that nodes do not straddle cache lines
+    // Ensure that nodes do not straddle cache lines. The offsets are 32-bit
+    // so that a node takes exactly 32 bytes (64 with double bounds).
     struct alignas(32) BVH::LinearBVHNode
     {
-        static LinearBVHNode Leaf(const std::size_t firstPrimitiveIndex,
+        static LinearBVHNode Leaf(const std::uint32_t firstPrimitiveIndex,
                                   const std::uint16_t primitivesCount,
                                   const Bounds3f& bounds) {
             return LinearBVHNode{
@@ -41,7 +69,7 @@ namespace idragnev::pbrt::accelerators {
             };
         }
 
-        static LinearBVHNode Interior(const std::size_t secondChildIndex,
+        static LinearBVHNode Interior(const std::uint32_t secondChildIndex,
                                       const std::uint8_t splitAxis,
                                       const Bounds3f& bounds) {
             return LinearBVHNode{
@@ -56,33 +84,194 @@ namespace idragnev::pbrt::accelerators {
         Bounds3f bounds;
         union
         {
-            std::size_t firstPrimitiveIndex;
-            std::size_t secondChildIndex;
+            std::uint32_t firstPrimitiveIndex;
+            std::uint32_t secondChildIndex;
         };
         std::uint16_t primitivesCount = 0;
         std::uint8_t splitAxis = 0;
+        std::uint8_t pad[1] = {};
+
+    private:
+        // the type is complete only in the member function bodies,
+        // and it is private to BVH outside of them
+        static constexpr void checkSize() noexcept {
+#ifdef PBRT_FLOAT_AS_DOUBLE
+            static_assert(sizeof(LinearBVHNode) == 64,
+                          "A LinearBVHNode with double bounds must take 64 "
+                          "bytes");
+#else
+            static_assert(sizeof(LinearBVHNode) == 32,
+                          "A LinearBVHNode must take 32 bytes");
+#endif
+        }
     };
 #ifdef _MSC_VER
     #pragma warning(pop)
 #endif
 
+    namespace {
+        // All node layouts hold 32-bit node and primitive offsets. Bigger
+        // trees are rejected in release builds as well, rather than being
+        // built with truncated offsets.
+        void checkFitsInNodeOffsets(const std::size_t count,
+                                    const char* const what) {
+            if (count > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("BVH: " + std::to_string(count) +
+                                        " " + what +
+                                        " do not fit in 32-bit offsets");
+            }
+        }
+
+        // Writes the children set in `hitMask` to `order` sorted by their
+        // entry distances, the lower indices first among equal ones.
+        // Returns their count.
+        template <std::size_t N>
+        std::size_t sortHitChildren(std::uint32_t hitMask,
+                                    const Float (&childNear)[N],
+                                    std::uint32_t (&order)[N]) noexcept {
+            std::size_t hitsCount = 0;
+            while (hitMask != 0) {
+                const auto child =
+                    static_cast<std::uint32_t>(std::countr_zero(hitMask));
+                hitMask &= hitMask - 1;
+
+                // insertion sort, the nodes have a handful of children
+                std::size_t i = hitsCount++;
+                for (; i > 0 && childNear[order[i - 1]] > childNear[child];
+                     --i) {
+                    order[i] = order[i - 1];
+                }
+                order[i] = child;
+            }
+
+            return hitsCount;
+        }
+
+        std::vector<bvh::PrimitiveRef>
+        partsOf(const std::vector<std::shared_ptr<const Primitive>>& prims) {
+            std::vector<bvh::PrimitiveRef> result;
+            for (const auto& primitive : prims) {
+                const std::uint32_t partsCount = primitive->partsCount();
+                for (std::uint32_t part = 0; part < partsCount; ++part) {
+                    result.push_back(bvh::PrimitiveRef{primitive.get(), part});
+                }
+            }
+
+            return result;
+        }
+    } // namespace
+
     BVH::BVH(std::vector<std::shared_ptr<const Primitive>> prims,
              const bvh::SplitMethod splitMethod,
-             const std::uint32_t maxPrimitivesInNode)
+             const std::uint32_t maxPrimitivesInNode,
+             const memory::PageSize nodesPageSize,
+             const bvh::NodeLayout layout)
         : maxPrimitivesInNode(std::min(maxPrimitivesInNode, 255u))
-        , primitives(std::move(prims)) {
+        , ownedPrimitives(std::move(prims))
+        , primitives(partsOf(ownedPrimitives))
+        , layout(layout)
+        , nodesPageSize(nodesPageSize) {
         if (this->primitives.empty() == false) {
             memory::MemoryArena arena{1024 * 1024};
+            build(splitMethod, arena);
+        }
+    }
 
-            const bvh::BuildTree tree = buildBVHTree(splitMethod, arena);
-            this->nodes =
-                memory::allocCacheAligned<LinearBVHNode>(tree.nodesCount);
-            [[maybe_unused]] const auto result = flattenBVHTree(*tree.root, 0);
+    BVH::BVH(std::vector<std::shared_ptr<const Primitive>> prims,
+             memory::MemoryArena& buildArena,
+             const bvh::SplitMethod splitMethod,
+             const std::uint32_t maxPrimitivesInNode,
+             const memory::PageSize nodesPageSize,
+             const bvh::NodeLayout layout)
+        : maxPrimitivesInNode(std::min(maxPrimitivesInNode, 255u))
+        , ownedPrimitives(std::move(prims))
+        , primitives(partsOf(ownedPrimitives))
+        , layout(layout)
+        , nodesPageSize(nodesPageSize) {
+        if (this->primitives.empty() == false) {
+            build(splitMethod, buildArena);
+        }
+    }
+
+    void BVH::build(const bvh::SplitMethod splitMethod,
+                    memory::MemoryArena& arena) {
+        checkFitsInNodeOffsets(this->primitives.size(), "primitives");
 
-            assert(result.linearNodesWritten == tree.nodesCount);
+        const bvh::BuildTree tree = buildBVHTree(splitMethod, arena);
+        this->bounds = tree.root->bounds;
+
+        // the wide trees have fewer nodes than the binary one
+        checkFitsInNodeOffsets(tree.nodesCount, "nodes");
+
+        switch (layout) {
+            case bvh::NodeLayout::Wide4:
+                this->nodes4 = collapseBVHTree<4>(*tree.root);
+                break;
+            case bvh::NodeLayout::Wide8:
+                this->nodes8 = collapseBVHTree<8>(*tree.root);
+                break;
+            case bvh::NodeLayout::QuantizedWide4:
+                this->quantizedNodes4 = quantizeBVHTree<4>(*tree.root);
+                break;
+            case bvh::NodeLayout::QuantizedWide8:
+                this->quantizedNodes8 = quantizeBVHTree<8>(*tree.root);
+                break;
+            case bvh::NodeLayout::Binary: {
+                this->nodes = memory::allocCacheAligned<LinearBVHNode>(
+                    tree.nodesCount,
+                    nodesPageSize,
+                    memory::MemoryTag::BVHNodes);
+                this->nodesCount = tree.nodesCount;
+                [[maybe_unused]] const auto result =
+                    flattenBVHTree(*tree.root, 0);
+
+                assert(result.linearNodesWritten == tree.nodesCount);
+                break;
+            }
         }
     }
 
+    template <std::size_t N>
+    bvh::WideBVHNode<N>* BVH::collapseBVHTree(const bvh::BuildNode& root) {
+        using Collapser = bvh::WideBVHCollapser<N>;
+
+        this->nodesCount = Collapser::nodesCount(root);
+        auto* const wideNodes =
+            memory::allocCacheAligned<bvh::WideBVHNode<N>>(
+                this->nodesCount,
+                nodesPageSize,
+                memory::MemoryTag::BVHNodes);
+        [[maybe_unused]] const std::size_t written =
+            Collapser::collapse(root, wideNodes, 0);
+
+        assert(written == this->nodesCount);
+
+        return wideNodes;
+    }
+
+    template <std::size_t N>
+    bvh::QuantizedWideBVHNode<N>*
+    BVH::quantizeBVHTree(const bvh::BuildNode& root) {
+        bvh::WideBVHNode<N>* const wideNodes = collapseBVHTree<N>(root);
+
+        auto* const quantizedNodes =
+            memory::allocCacheAligned<bvh::QuantizedWideBVHNode<N>>(
+                this->nodesCount,
+                nodesPageSize,
+                memory::MemoryTag::BVHNodes);
+        for (std::size_t i = 0; i < this->nodesCount; ++i) {
+            bvh::WideBVHQuantizer<N>::quantize(wideNodes[i],
+                                                quantizedNodes[i]);
+        }
+
+        memory::freeAligned(wideNodes,
+                            this->nodesCount,
+                            nodesPageSize,
+                            memory::MemoryTag::BVHNodes);
+
+        return quantizedNodes;
+    }
+
     bvh::BuildTree BVH::buildBVHTree(const bvh::SplitMethod splitMethod,
                                      memory::MemoryArena& arena) {
         const auto recursiveBuilder =
@@ -107,7 +296,7 @@ namespace idragnev::pbrt::accelerators {
             assert(buildNode.primitivesCount <= 65536);
 
             node = LinearBVHNode::Leaf(
-                buildNode.firstPrimitiveIndex,
+                static_cast<std::uint32_t>(buildNode.firstPrimitiveIndex),
                 static_cast<std::uint16_t>(buildNode.primitivesCount),
                 buildNode.bounds);
 
@@ -124,7 +313,7 @@ namespace idragnev::pbrt::accelerators {
                                left.rootIndex + left.linearNodesWritten);
 
             node = LinearBVHNode::Interior(
-                right.rootIndex,
+                static_cast<std::uint32_t>(right.rootIndex),
                 static_cast<std::uint8_t>(buildNode.splitAxis),
                 buildNode.bounds);
 
@@ -136,19 +325,39 @@ namespace idragnev::pbrt::accelerators {
         }
     }
 
-    BVH::~BVH() { memory::freeAligned(nodes); }
-
-    Bounds3f BVH::worldBound() const {
-        return (this->nodes != nullptr) ? nodes[0].bounds : Bounds3f{};
+    BVH::~BVH() {
+        memory::freeAligned(nodes,
+                            nodesCount,
+                            nodesPageSize,
+                            memory::MemoryTag::BVHNodes);
+        memory::freeAligned(nodes4,
+                            nodesCount,
+                            nodesPageSize,
+                            memory::MemoryTag::BVHNodes);
+        memory::freeAligned(nodes8,
+                            nodesCount,
+                            nodesPageSize,
+                            memory::MemoryTag::BVHNodes);
+        memory::freeAligned(quantizedNodes4,
+                            nodesCount,
+                            nodesPageSize,
+                            memory::MemoryTag::BVHNodes);
+        memory::freeAligned(quantizedNodes8,
+                            nodesCount,
+                            nodesPageSize,
+                            memory::MemoryTag::BVHNodes);
     }
 
+    Bounds3f BVH::worldBound() const { return bounds; }
+
     Optional<SurfaceInteraction> BVH::intersect(const Ray& ray) const {
         Optional<SurfaceInteraction> result = pbrt::nullopt;
 
         traverseIntersect(
-            [this, &result](const LinearBVHNode& leafNode, const Ray& ray) {
-                result = intersectLeafNodePrims(leafNode, ray)
-                         .disjunction(std::move(result));
+            [this, &result](const std::span<const bvh::PrimitiveRef> prims,
+                            const Ray& ray) {
+                result =
+                    intersectPrims(prims, ray).disjunction(std::move(result));
                 return false;
             },
             ray);
@@ -160,8 +369,9 @@ namespace idragnev::pbrt::accelerators {
         bool result = false;
 
         traverseIntersect(
-            [this, &result](const LinearBVHNode& leafNode, const Ray& ray) {
-                result = intersectPLeafNodePrims(leafNode, ray);
+            [this, &result](const std::span<const bvh::PrimitiveRef> prims,
+                            const Ray& ray) {
+                result = intersectPPrims(prims, ray);
                 return result;
             },
             ray);
@@ -169,15 +379,112 @@ namespace idragnev::pbrt::accelerators {
         return result;
     }
 
+    void BVH::intersect4(const std::span<const Ray, 4> rays,
+                         const std::span<Optional<SurfaceInteraction>, 4> hits,
+                         const std::uint32_t activeMask) const {
+        intersectPacket(rays, hits, activeMask);
+    }
+
+    void BVH::intersect8(const std::span<const Ray, 8> rays,
+                         const std::span<Optional<SurfaceInteraction>, 8> hits,
+                         const std::uint32_t activeMask) const {
+        intersectPacket(rays, hits, activeMask);
+    }
+
+    void
+    BVH::intersect16(const std::span<const Ray, 16> rays,
+                     const std::span<Optional<SurfaceInteraction>, 16> hits,
+                     const std::uint32_t activeMask) const {
+        intersectPacket(rays, hits, activeMask);
+    }
+
+    std::uint32_t BVH::intersectP4(const std::span<const Ray, 4> rays,
+                                   const std::uint32_t activeMask) const {
+        return intersectPPacket(rays, activeMask);
+    }
+
+    std::uint32_t BVH::intersectP8(const std::span<const Ray, 8> rays,
+                                   const std::uint32_t activeMask) const {
+        return intersectPPacket(rays, activeMask);
+    }
+
+    std::uint32_t BVH::intersectP16(const std::span<const Ray, 16> rays,
+                                    const std::uint32_t activeMask) const {
+        return intersectPPacket(rays, activeMask);
+    }
+
+    void
+    BVH::intersect(const std::span<const Ray> rays,
+                   const std::span<Optional<SurfaceInteraction>> hits) const {
+        assert(hits.size() >= rays.size());
+        assert(rays.size() <= std::numeric_limits<std::uint32_t>::max());
+
+        for (std::size_t i = 0; i < rays.size(); ++i) {
+            hits[i] = pbrt::nullopt;
+        }
+        if (this->primitives.empty() || rays.empty()) {
+            return;
+        }
+
+        std::vector<bvh::StreamRay> stream =
+            bvh::sortRayStream(rays, this->bounds);
+
+        const auto intersectLeaf =
+            [&rays, &hits, &stream](
+                const std::span<const bvh::PrimitiveRef> prims,
+                const std::span<const std::uint32_t> leafRays) {
+                for (const bvh::PrimitiveRef& ref : prims) {
+                    for (const std::uint32_t id : leafRays) {
+                        bvh::StreamRay& streamRay = stream[id];
+                        const Ray& ray = rays[streamRay.index];
+                        auto hit = ref.primitive->intersectPart(ray, ref.part);
+                        if (hit.has_value()) {
+                            hits[streamRay.index] = std::move(hit);
+                            streamRay.tMax = ray.tMax;
+                        }
+                    }
+                }
+            };
+
+        constexpr std::size_t batchSize = bvh::constants::RAY_STREAM_BATCH_SIZE;
+        std::vector<std::uint32_t> ids;
+        for (std::size_t first = 0; first < stream.size(); first += batchSize) {
+            const std::size_t last = std::min(first + batchSize, stream.size());
+
+            ids.clear();
+            for (std::size_t id = first; id < last; ++id) {
+                ids.push_back(static_cast<std::uint32_t>(id));
+            }
+            traverseStream(intersectLeaf, stream, ids);
+        }
+    }
+
+    template <typename F>
+    void BVH::traverseIntersect(F intersectLeaf, const Ray& ray) const {
+        switch (layout) {
+            case bvh::NodeLayout::Binary:
+                traverseBinary(intersectLeaf, ray);
+                break;
+            case bvh::NodeLayout::Wide4:
+                traverseWide(nodes4, intersectLeaf, ray);
+                break;
+            case bvh::NodeLayout::Wide8:
+                traverseWide(nodes8, intersectLeaf, ray);
+                break;
+            case bvh::NodeLayout::QuantizedWide4:
+                traverseWide(quantizedNodes4, intersectLeaf, ray);
+                break;
+            case bvh::NodeLayout::QuantizedWide8:
+                traverseWide(quantizedNodes8, intersectLeaf, ray);
+                break;
+        }
+    }
+
     // Traverses the tree, ignoring subtrees which are not intersected by `ray`.
     // For intersected internal nodes, visits the two child trees in
     // a front-to-back order.
-    // Calls `intersectLeaf` with `ray` for each intersected leaf node.
-    // (!) Stops the traversal if `intersectLeaf` returns true -
-    // `intersectLeaf` indicates whether the traversal should stop. (!)
-    void BVH::traverseIntersect(
-        std::function<bool(const LinearBVHNode&, const Ray&)> intersectLeaf,
-        const Ray& ray) const {
+    template <typename F>
+    void BVH::traverseBinary(F intersectLeaf, const Ray& ray) const {
         if (this->nodes == nullptr) {
             return;
         }
@@ -196,7 +503,9 @@ namespace idragnev::pbrt::accelerators {
 
             if (node.bounds.intersectP(ray, invDir, dirIsNegative)) {
                 if (node.isLeaf()) {
-                    if (bool stop = intersectLeaf(node, ray); stop) {
+                    const auto prims = leafPrimitives(node.firstPrimitiveIndex,
+                                                      node.primitivesCount);
+                    if (bool stop = intersectLeaf(prims, ray); stop) {
                         return;
                     }
                 }
@@ -216,39 +525,509 @@ namespace idragnev::pbrt::accelerators {
         }
     }
 
-    Optional<SurfaceInteraction>
-    BVH::intersectLeafNodePrims(const LinearBVHNode& node,
-                                const Ray& ray) const {
-        Optional<SurfaceInteraction> result = pbrt::nullopt;
+    // Tests all children of a node at once and visits the intersected
+    // ones in the order of their entry distances. The leaf children are
+    // intersected right away, so the ray is shortened before the farther
+    // children are visited.
+    template <typename Node, typename F>
+    void BVH::traverseWide(const Node* const wideNodes,
+                           F intersectLeaf,
+                           const Ray& ray) const {
+        constexpr std::size_t N = Node::Width;
+
+        if (wideNodes == nullptr) {
+            return;
+        }
+
+        const bvh::WideRayQuery query{ray};
 
-        if (node.isLeaf()) {
-            const auto primsRange =
-                std::span<const std::shared_ptr<const Primitive>>{
-                    this->primitives.cbegin() + node.firstPrimitiveIndex,
-                    node.primitivesCount};
+        // each visited node pushes at most N - 1 nodes more than it pops
+        std::uint32_t nodesToVisit[64 * (N - 1) + 1];
+        std::size_t top = 0;
+        nodesToVisit[top++] = 0;
+
+        while (top > 0) {
+            const Node& node = wideNodes[nodesToVisit[--top]];
+
+            alignas(32) Float tNear[N];
+            const std::uint32_t hitMask =
+                bvh::intersectChildren(node, query, ray.tMax, tNear);
+
+            std::uint32_t order[N];
+            const std::size_t hitsCount =
+                sortHitChildren(hitMask, tNear, order);
 
-            for (const auto& primitive : primsRange) {
-                result = primitive->intersect(ray).disjunction(std::move(result));
+            std::uint32_t interiorChildren[N];
+            std::size_t interiorCount = 0;
+            for (std::size_t i = 0; i < hitsCount; ++i) {
+                const std::uint32_t child = order[i];
+                if (node.isLeaf(child)) {
+                    // the ray may have been shortened by a closer leaf
+                    if (tNear[child] > ray.tMax) {
+                        continue;
+                    }
+
+                    const auto prims =
+                        leafPrimitives(node.offsets[child],
+                                       node.primitivesCount[child]);
+                    if (bool stop = intersectLeaf(prims, ray); stop) {
+                        return;
+                    }
+                }
+                else {
+                    interiorChildren[interiorCount++] = node.offsets[child];
+                }
+            }
+
+            // the closest child is on top
+            while (interiorCount > 0) {
+                nodesToVisit[top++] = interiorChildren[--interiorCount];
             }
         }
+    }
+
+    template <std::size_t K>
+    void
+    BVH::intersectPacket(const std::span<const Ray, K> rays,
+                         const std::span<Optional<SurfaceInteraction>, K> hits,
+                         const std::uint32_t activeMask) const {
+        const std::uint32_t raysMask = activeMask & ((1u << K) - 1u);
+        for (std::uint32_t mask = raysMask; mask != 0; mask &= mask - 1) {
+            hits[std::countr_zero(mask)] = pbrt::nullopt;
+        }
+
+        bvh::RayPacket<K> packet{rays};
+        traversePacket(
+            [&packet, hits](const std::span<const bvh::PrimitiveRef> prims,
+                            const std::uint32_t leafRays) {
+                for (const bvh::PrimitiveRef& ref : prims) {
+                    ref.primitive->intersectPartPacket(packet.rays,
+                                                       ref.part,
+                                                       leafRays,
+                                                       hits);
+                }
+                packet.updateTMax(leafRays);
+                return 0u;
+            },
+            packet,
+            raysMask);
+    }
+
+    template <std::size_t K>
+    std::uint32_t
+    BVH::intersectPPacket(const std::span<const Ray, K> rays,
+                          const std::uint32_t activeMask) const {
+        std::uint32_t result = 0;
+
+        bvh::RayPacket<K> packet{rays};
+        traversePacket(
+            [&packet, &result](const std::span<const bvh::PrimitiveRef> prims,
+                               const std::uint32_t leafRays) {
+                std::uint32_t occluded = 0;
+                for (const bvh::PrimitiveRef& ref : prims) {
+                    occluded |= ref.primitive->intersectPartPacketP(
+                        packet.rays,
+                        ref.part,
+                        leafRays & ~occluded);
+                    if (occluded == leafRays) {
+                        break;
+                    }
+                }
+                result |= occluded;
+                return occluded;
+            },
+            packet,
+            activeMask & ((1u << K) - 1u));
 
         return result;
     }
 
-    bool BVH::intersectPLeafNodePrims(const LinearBVHNode& node,
-                                      const Ray& ray) const {
-        if (node.isLeaf() == false) {
-            return false;
+    template <std::size_t K, typename F>
+    void BVH::traversePacket(F intersectLeaf,
+                             bvh::RayPacket<K>& packet,
+                             const std::uint32_t activeMask) const {
+        switch (layout) {
+            case bvh::NodeLayout::Binary:
+                traversePacketBinary(intersectLeaf, packet, activeMask);
+                break;
+            case bvh::NodeLayout::Wide4:
+                traversePacketWide(nodes4, intersectLeaf, packet, activeMask);
+                break;
+            case bvh::NodeLayout::Wide8:
+                traversePacketWide(nodes8, intersectLeaf, packet, activeMask);
+                break;
+            case bvh::NodeLayout::QuantizedWide4:
+                traversePacketWide(quantizedNodes4,
+                                   intersectLeaf,
+                                   packet,
+                                   activeMask);
+                break;
+            case bvh::NodeLayout::QuantizedWide8:
+                traversePacketWide(quantizedNodes8,
+                                   intersectLeaf,
+                                   packet,
+                                   activeMask);
+                break;
+        }
+    }
+
+    // Visits each node with the rays of the packet which intersect its
+    // parent and are not done yet. The children of an interior node are
+    // visited in the front-to-back order of the first of its rays.
+    template <std::size_t K, typename F>
+    void BVH::traversePacketBinary(F intersectLeaf,
+                                   bvh::RayPacket<K>& packet,
+                                   std::uint32_t activeMask) const {
+        if (this->nodes == nullptr || activeMask == 0) {
+            return;
+        }
+
+        PacketNodeToVisit nodesToVisit[64];
+        std::size_t top = 0;
+        nodesToVisit[top++] = PacketNodeToVisit{0, activeMask};
+
+        while (top > 0) {
+            const PacketNodeToVisit current = nodesToVisit[--top];
+            const LinearBVHNode& node = this->nodes[current.nodeIndex];
+
+            alignas(16) Float tNear[K];
+            const std::uint32_t hitMask =
+                bvh::intersectBounds(node.bounds,
+                                     packet,
+                                     current.raysMask & activeMask,
+                                     tNear);
+            if (hitMask == 0) {
+                continue;
+            }
+
+            if (node.isLeaf()) {
+                const auto prims = leafPrimitives(node.firstPrimitiveIndex,
+                                                  node.primitivesCount);
+                activeMask &= ~intersectLeaf(prims, hitMask);
+                if (activeMask == 0) {
+                    return;
+                }
+            }
+            else {
+                const std::size_t leftChildIndex = current.nodeIndex + 1;
+                const PacketNodeToVisit left{leftChildIndex, hitMask};
+                const PacketNodeToVisit right{node.secondChildIndex, hitMask};
+
+                const auto firstRay =
+                    static_cast<std::size_t>(std::countr_zero(hitMask));
+                if (packet.isDirNegative(node.splitAxis, firstRay)) {
+                    nodesToVisit[top++] = left;
+                    nodesToVisit[top++] = right;
+                }
+                else {
+                    nodesToVisit[top++] = right;
+                    nodesToVisit[top++] = left;
+                }
+            }
+        }
+    }
+
+    // Tests all children of a node against the rays of the packet which
+    // intersect it. The children are visited in the order of the closest
+    // entry distance of their rays and the leaf children right away, as
+    // in traverseWide.
+    template <typename Node, std::size_t K, typename F>
+    void BVH::traversePacketWide(const Node* const wideNodes,
+                                 F intersectLeaf,
+                                 bvh::RayPacket<K>& packet,
+                                 std::uint32_t activeMask) const {
+        constexpr std::size_t N = Node::Width;
+
+        if (wideNodes == nullptr || activeMask == 0) {
+            return;
+        }
+
+        PacketNodeToVisit nodesToVisit[64 * (N - 1) + 1];
+        std::size_t top = 0;
+        nodesToVisit[top++] = PacketNodeToVisit{0, activeMask};
+
+        while (top > 0) {
+            const PacketNodeToVisit current = nodesToVisit[--top];
+            const std::uint32_t nodeRays = current.raysMask & activeMask;
+            if (nodeRays == 0) {
+                continue;
+            }
+
+            const Node& node = wideNodes[current.nodeIndex];
+
+            alignas(16) Float tNear[N][K];
+            std::uint32_t childRays[N];
+            Float childNear[N];
+            std::uint32_t hitMask = 0;
+            for (std::uint32_t child = 0; child < node.childrenCount; ++child) {
+                childRays[child] = bvh::intersectBounds(node.childBounds(child),
+                                                        packet,
+                                                        nodeRays,
+                                                        tNear[child]);
+                if (childRays[child] == 0) {
+                    continue;
+                }
+
+                childNear[child] = pbrt::constants::Infinity;
+                for (std::uint32_t mask = childRays[child]; mask != 0;
+                     mask &= mask - 1) {
+                    childNear[child] = std::min(
+                        childNear[child],
+                        tNear[child][std::countr_zero(mask)]);
+                }
+                hitMask |= 1u << child;
+            }
+
+            std::uint32_t order[N];
+            const std::size_t hitsCount =
+                sortHitChildren(hitMask, childNear, order);
+
+            PacketNodeToVisit interiorChildren[N];
+            std::size_t interiorCount = 0;
+            for (std::size_t i = 0; i < hitsCount; ++i) {
+                const std::uint32_t child = order[i];
+                if (node.isLeaf(child)) {
+                    // the rays may have been shortened by a closer leaf
+                    std::uint32_t leafRays = 0;
+                    for (std::uint32_t mask = childRays[child] & activeMask;
+                         mask != 0;
+                         mask &= mask - 1) {
+                        const auto ray = std::countr_zero(mask);
+                        if (tNear[child][ray] <= packet.tMax[ray]) {
+                            leafRays |= 1u << ray;
+                        }
+                    }
+                    if (leafRays == 0) {
+                        continue;
+                    }
+
+                    const auto prims =
+                        leafPrimitives(node.offsets[child],
+                                       node.primitivesCount[child]);
+                    activeMask &= ~intersectLeaf(prims, leafRays);
+                    if (activeMask == 0) {
+                        return;
+                    }
+                }
+                else {
+                    interiorChildren[interiorCount++] = PacketNodeToVisit{
+                        node.offsets[child],
+                        childRays[child],
+                    };
+                }
+            }
+
+            // the closest child is on top
+            while (interiorCount > 0) {
+                nodesToVisit[top++] = interiorChildren[--interiorCount];
+            }
+        }
+    }
+
+    template <typename F>
+    void BVH::traverseStream(F intersectLeaf,
+                             const std::span<const bvh::StreamRay> stream,
+                             std::vector<std::uint32_t>& ids) const {
+        switch (layout) {
+            case bvh::NodeLayout::Binary:
+                traverseStreamBinary(intersectLeaf, stream, ids);
+                break;
+            case bvh::NodeLayout::Wide4:
+                traverseStreamWide(nodes4, intersectLeaf, stream, ids);
+                break;
+            case bvh::NodeLayout::Wide8:
+                traverseStreamWide(nodes8, intersectLeaf, stream, ids);
+                break;
+            case bvh::NodeLayout::QuantizedWide4:
+                traverseStreamWide(quantizedNodes4, intersectLeaf, stream, ids);
+                break;
+            case bvh::NodeLayout::QuantizedWide8:
+                traverseStreamWide(quantizedNodes8, intersectLeaf, stream, ids);
+                break;
+        }
+    }
+
+    // Visits each node once with all rays of the stream which intersect
+    // its parent. The ids of the rays which intersect a node are appended
+    // to `ids` and shared by its children. The children of an interior
+    // node are visited in the front-to-back order of its first ray.
+    template <typename F>
+    void
+    BVH::traverseStreamBinary(F intersectLeaf,
+                              const std::span<const bvh::StreamRay> stream,
+                              std::vector<std::uint32_t>& ids) const {
+        if (this->nodes == nullptr) {
+            return;
+        }
+
+        StreamNodeToVisit nodesToVisit[64];
+        std::size_t top = 0;
+        nodesToVisit[top++] =
+            StreamNodeToVisit{0, 0, ids.size(), ids.size()};
+
+        while (top > 0) {
+            const StreamNodeToVisit current = nodesToVisit[--top];
+            const LinearBVHNode& node = this->nodes[current.nodeIndex];
+
+            // drop the ids of the subtrees visited since the push
+            ids.resize(current.idsEnd);
+
+            const std::size_t first = ids.size();
+            bvh::filterRayStream(node.bounds,
+                                 stream,
+                                 ids,
+                                 current.first,
+                                 current.count);
+            const std::size_t count = ids.size() - first;
+            if (count == 0) {
+                continue;
+            }
+
+            if (node.isLeaf()) {
+                const auto prims = leafPrimitives(node.firstPrimitiveIndex,
+                                                  node.primitivesCount);
+                intersectLeaf(prims,
+                              std::span<const std::uint32_t>{ids}.subspan(
+                                  first,
+                                  count));
+            }
+            else {
+                const StreamNodeToVisit left{
+                    current.nodeIndex + 1, first, count, ids.size()};
+                const StreamNodeToVisit right{
+                    node.secondChildIndex, first, count, ids.size()};
+
+                const bvh::WideRayQuery& firstRay = stream[ids[first]].query;
+                if (firstRay.nearSide[node.splitAxis] == 1) {
+                    nodesToVisit[top++] = left;
+                    nodesToVisit[top++] = right;
+                }
+                else {
+                    nodesToVisit[top++] = right;
+                    nodesToVisit[top++] = left;
+                }
+            }
+        }
+    }
+
+    // Filters the rays of the stream which reach a node by the bounds of
+    // each of its children. The children are visited in the order of
+    // the closest entry distance of their rays and the leaf children
+    // right away, as in traverseWide.
+    template <typename Node, typename F>
+    void BVH::traverseStreamWide(const Node* const wideNodes,
+                                 F intersectLeaf,
+                                 const std::span<const bvh::StreamRay> stream,
+                                 std::vector<std::uint32_t>& ids) const {
+        constexpr std::size_t N = Node::Width;
+
+        if (wideNodes == nullptr) {
+            return;
+        }
+
+        StreamNodeToVisit nodesToVisit[64 * (N - 1) + 1];
+        std::size_t top = 0;
+        nodesToVisit[top++] =
+            StreamNodeToVisit{0, 0, ids.size(), ids.size()};
+
+        while (top > 0) {
+            const StreamNodeToVisit current = nodesToVisit[--top];
+            const Node& node = wideNodes[current.nodeIndex];
+
+            // drop the ids of the subtrees visited since the push
+            ids.resize(current.idsEnd);
+
+            std::size_t childFirst[N];
+            std::size_t childCount[N];
+            Float childNear[N];
+            std::uint32_t hitMask = 0;
+            for (std::uint32_t child = 0; child < node.childrenCount; ++child) {
+                childFirst[child] = ids.size();
+                childNear[child] = bvh::filterRayStream(node.childBounds(child),
+                                                        stream,
+                                                        ids,
+                                                        current.first,
+                                                        current.count);
+                childCount[child] = ids.size() - childFirst[child];
+                if (childCount[child] != 0) {
+                    hitMask |= 1u << child;
+                }
+            }
+
+            std::uint32_t order[N];
+            const std::size_t hitsCount =
+                sortHitChildren(hitMask, childNear, order);
+
+            const std::size_t idsEnd = ids.size();
+            StreamNodeToVisit interiorChildren[N];
+            std::size_t interiorCount = 0;
+            bool raysShortened = false;
+            for (std::size_t i = 0; i < hitsCount; ++i) {
+                const std::uint32_t child = order[i];
+                std::size_t count = childCount[child];
+                const auto childIds = std::span<std::uint32_t>{ids}.subspan(
+                    childFirst[child],
+                    count);
+
+                if (node.isLeaf(child)) {
+                    // the rays may have been shortened by a closer leaf
+                    if (raysShortened) {
+                        count = bvh::compactRayStream(node.childBounds(child),
+                                                      stream,
+                                                      childIds);
+                        if (count == 0) {
+                            continue;
+                        }
+                    }
+
+                    const auto prims =
+                        leafPrimitives(node.offsets[child],
+                                       node.primitivesCount[child]);
+                    intersectLeaf(prims, childIds.first(count));
+                    raysShortened = true;
+                }
+                else {
+                    interiorChildren[interiorCount++] = StreamNodeToVisit{
+                        node.offsets[child],
+                        childFirst[child],
+                        count,
+                        idsEnd,
+                    };
+                }
+            }
+
+            // the closest child is on top
+            while (interiorCount > 0) {
+                nodesToVisit[top++] = interiorChildren[--interiorCount];
+            }
+        }
+    }
+
+    std::span<const bvh::PrimitiveRef>
+    BVH::leafPrimitives(const std::size_t first,
+                        const std::size_t count) const noexcept {
+        return {this->primitives.data() + first, count};
+    }
+
+    Optional<SurfaceInteraction>
+    BVH::intersectPrims(const std::span<const bvh::PrimitiveRef> prims,
+                        const Ray& ray) const {
+        Optional<SurfaceInteraction> result = pbrt::nullopt;
+        for (const bvh::PrimitiveRef& ref : prims) {
+            result = ref.primitive->intersectPart(ray, ref.part)
+                         .disjunction(std::move(result));
         }
 
-        const auto primsRange =
-            std::span<const std::shared_ptr<const Primitive>>{
-                this->primitives.cbegin() + node.firstPrimitiveIndex,
-                node.primitivesCount};
+        return result;
+    }
 
-        return std::any_of(
-            primsRange.begin(),
-            primsRange.end(),
-            [&ray](const auto& p) { return p->intersectP(ray); });
+    bool BVH::intersectPPrims(const std::span<const bvh::PrimitiveRef> prims,
+                              const Ray& ray) const {
+        return std::any_of(prims.begin(),
+                           prims.end(),
+                           [&ray](const bvh::PrimitiveRef& ref) {
+                               return ref.primitive->intersectPartP(ray,
+                                                                    ref.part);
+                           });
     }
 } // namespace idragnev::pbrt::accelerators
\ No newline at end of file
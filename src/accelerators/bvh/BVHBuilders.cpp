@@ -1,25 +1,24 @@
 #include "pbrt/accelerators/bvh/BVHBuilders.hpp"
-
-#include <numeric>
+#include "pbrt/parallel/Parallel.hpp"
 
 namespace idragnev::pbrt::accelerators::bvh {
     Bounds3f bounds(const std::span<const PrimitiveInfo> range) {
-        return std::accumulate(
-            range.begin(),
-            range.end(),
+        return parallel::parallelReduce(
+            static_cast<std::int64_t>(range.size()),
             Bounds3f{},
-            [](const Bounds3f& acc, const PrimitiveInfo& info) {
-                return unionOf(acc, info.bounds);
-            });
+            [range](Bounds3f& acc, const std::int64_t i) {
+                acc = unionOf(acc, range[static_cast<std::size_t>(i)].bounds);
+            },
+            [](const Bounds3f& a, const Bounds3f& b) { return unionOf(a, b); });
     }
 
     Bounds3f centroidBounds(const std::span<const PrimitiveInfo> range) {
-        return std::accumulate(
-            range.begin(),
-            range.end(),
+        return parallel::parallelReduce(
+            static_cast<std::int64_t>(range.size()),
             Bounds3f{},
-            [](const Bounds3f& acc, const PrimitiveInfo& info) {
-                return unionOf(acc, info.centroid);
-            });
+            [range](Bounds3f& acc, const std::int64_t i) {
+                acc = unionOf(acc, range[static_cast<std::size_t>(i)].centroid);
+            },
+            [](const Bounds3f& a, const Bounds3f& b) { return unionOf(a, b); });
     }
 } // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
@@ -19,13 +19,13 @@ namespace idragnev::pbrt::accelerators::bvh {
         std::uint32_t mortonCode = 0;
     };
 
-    std::vector<MortonPrimitive>
-    toMortonPrimitives(const std::vector<PrimitiveInfo>& primsInfo);
-    std::uint32_t encodeMorton3(const Vector3f& v);
+    std::pmr::vector<MortonPrimitive>
+    toMortonPrimitives(const std::span<const PrimitiveInfo> primsInfo,
+                       memory::MemoryArena& arena);
     std::uint32_t leftShift3(std::uint32_t x);
 
-    [[nodiscard]] std::vector<MortonPrimitive>
-    radixSort(std::vector<MortonPrimitive> vec);
+    [[nodiscard]] std::pmr::vector<MortonPrimitive>
+    radixSort(std::pmr::vector<MortonPrimitive> vec);
 
     Optional<std::size_t>
     findSplitPosition(const std::span<const MortonPrimitive> prims,
@@ -46,8 +46,8 @@ namespace idragnev::pbrt::accelerators::bvh {
         BuildNode* nodes = nullptr;
     };
 
-    std::vector<LBVHTreelet>
-    splitToTreelets(const std::vector<MortonPrimitive>& prims,
+    std::pmr::vector<LBVHTreelet>
+    splitToTreelets(const std::pmr::vector<MortonPrimitive>& prims,
                     memory::MemoryArena& arena,
                     const bool zeroInitializeAllocatedNodes);
 
@@ -62,16 +62,19 @@ namespace idragnev::pbrt::accelerators::bvh {
                 b = {};
             }};
         
+        // The temporary build data is allocated in `arena`
+        std::pmr::vector<PrimitiveInfo> primsInfo(&arena);
+        primsInfo.reserve(primitives.size());
+        for (std::size_t i = 0; i < primitives.size(); ++i) {
+            primsInfo.emplace_back(i, primitives[i].worldBound());
+        }
+
         this->prims = &primitives;
-        this->primitivesInfo = functional::fmapIndexed(
-            primitives,
-            [](const auto& primitive, const std::size_t i) {
-                return PrimitiveInfo{i, primitive->worldBound()};
-            });
-
-        const std::vector<MortonPrimitive> mortonPrimInfos =
-            radixSort(toMortonPrimitives(this->primitivesInfo));
-        std::vector<LBVHTreelet> treelets =
+        this->primitivesInfo = primsInfo;
+
+        const std::pmr::vector<MortonPrimitive> mortonPrimInfos =
+            radixSort(toMortonPrimitives(this->primitivesInfo, arena));
+        std::pmr::vector<LBVHTreelet> treelets =
             splitToTreelets(mortonPrimInfos, arena, false);
         LowerLevels lls =
             buildLowerLevels(std::move(treelets), mortonPrimInfos);
@@ -79,28 +82,34 @@ namespace idragnev::pbrt::accelerators::bvh {
         return buildBVH(arena, std::move(lls));
     }
 
-    std::vector<MortonPrimitive>
-    toMortonPrimitives(const std::vector<PrimitiveInfo>& primsInfo) {
-        std::vector<MortonPrimitive> result{primsInfo.size()};
+    std::pmr::vector<MortonPrimitive>
+    toMortonPrimitives(const std::span<const PrimitiveInfo> primsInfo,
+                       memory::MemoryArena& arena) {
+        std::pmr::vector<MortonPrimitive> result(primsInfo.size(), &arena);
 
-        const Bounds3f primsCentroidBounds =
-            centroidBounds(std::span{primsInfo.cbegin(), primsInfo.size()});
+        const Bounds3f primsCentroidBounds = centroidBounds(primsInfo);
 
         constexpr std::int64_t CHUNK_SIZE = 512;
         const auto iterationsCount =
             static_cast<std::int64_t>(primsInfo.size());
 
         parallel::parallelFor(
-            [&result, &primsInfo, &primsCentroidBounds](const std::int64_t i) {
-                const auto& info = primsInfo[static_cast<std::size_t>(i)];
-                auto& primitive = result[static_cast<std::size_t>(i)];
-
-                const Vector3f centroidOffset =
-                    primsCentroidBounds.offset(info.centroid);
-
-                primitive.index = info.index;
-                primitive.mortonCode = encodeMorton3(
-                    constants::MORTON_DIMENSION_MAX * centroidOffset);
+            [&result, &primsInfo, &primsCentroidBounds](
+                const std::int64_t first,
+                const std::int64_t last) {
+                for (auto i = static_cast<std::size_t>(first);
+                     i < static_cast<std::size_t>(last);
+                     ++i) {
+                    const auto& info = primsInfo[i];
+                    auto& primitive = result[i];
+
+                    const Vector3f centroidOffset =
+                        primsCentroidBounds.offset(info.centroid);
+
+                    primitive.index = info.index;
+                    primitive.mortonCode = encodeMorton3(
+                        constants::MORTON_DIMENSION_MAX * centroidOffset);
+                }
             },
             iterationsCount,
             CHUNK_SIZE);
@@ -145,7 +154,8 @@ namespace idragnev::pbrt::accelerators::bvh {
         return x;
     }
 
-    std::vector<MortonPrimitive> radixSort(std::vector<MortonPrimitive> input) {
+    std::pmr::vector<MortonPrimitive>
+    radixSort(std::pmr::vector<MortonPrimitive> input) {
         using constants::MORTON_CODE_BITS;
 
         constexpr std::size_t BITS_PER_PASS = 6;
@@ -165,31 +175,69 @@ namespace idragnev::pbrt::accelerators::bvh {
             return result;
         };
 
-        std::vector<MortonPrimitive> temp{input.size()};
+        // The input is split into blocks which are counted and scattered
+        // in parallel. The bucket sizes of all blocks are stored
+        // bucket-major, so their exclusive prefix sum gives the output
+        // position of each (bucket, block) pair and the sort stays stable.
+        constexpr std::int64_t BLOCK_SIZE = parallel::constants::ALGORITHMS_BLOCK_SIZE;
+        const auto count = static_cast<std::int64_t>(input.size());
+        const auto blocksCount = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const auto blocks = static_cast<std::size_t>(blocksCount);
+
+        const auto allocator = input.get_allocator();
+        std::pmr::vector<std::size_t> outIndices(BUCKETS_COUNT * blocks,
+                                                 allocator);
+        std::pmr::vector<MortonPrimitive> temp(input.size(), allocator);
         for (std::size_t pass = 0; pass < PASSES_COUNT; ++pass) {
             const std::size_t lowBit = pass * BITS_PER_PASS;
 
-            const std::vector<MortonPrimitive>& in = (pass & 1) ? temp : input;
-            std::vector<MortonPrimitive>& out = (pass & 1) ? input : temp;
-
-            std::size_t bucketSizes[BUCKETS_COUNT] = {};
-            for (const MortonPrimitive& mp : in) {
-                const std::size_t index = bucketIndex(mp.mortonCode, lowBit);
-                ++bucketSizes[index];
-            }
-
-            std::size_t outIndices[BUCKETS_COUNT] = {};
-            for (std::size_t i = 1; i < BUCKETS_COUNT; ++i) {
-                outIndices[i] = outIndices[i - 1] + bucketSizes[i - 1];
-            }
-
-            for (const MortonPrimitive& mp : in) {
-                const std::size_t bucket = bucketIndex(mp.mortonCode, lowBit);
-                const std::size_t outIndex = outIndices[bucket];
-
-                out[outIndex] = mp;
-                ++outIndices[bucket];
-            }
+            const std::pmr::vector<MortonPrimitive>& in =
+                (pass & 1) ? temp : input;
+            std::pmr::vector<MortonPrimitive>& out = (pass & 1) ? input : temp;
+
+            std::fill(outIndices.begin(), outIndices.end(), 0u);
+            parallel::parallelFor(
+                [&](const std::int64_t firstBlock, const std::int64_t lastBlock) {
+                    for (auto b = firstBlock; b < lastBlock; ++b) {
+                        const auto block = static_cast<std::size_t>(b);
+                        const auto first = block * BLOCK_SIZE;
+                        const auto last =
+                            std::min(first + BLOCK_SIZE, input.size());
+
+                        for (auto i = first; i < last; ++i) {
+                            const std::size_t bucket =
+                                bucketIndex(in[i].mortonCode, lowBit);
+                            ++outIndices[bucket * blocks + block];
+                        }
+                    }
+                },
+                blocksCount);
+
+            parallel::parallelExclusiveScan(outIndices.begin(),
+                                            outIndices.end(),
+                                            outIndices.begin(),
+                                            std::size_t(0));
+
+            parallel::parallelFor(
+                [&](const std::int64_t firstBlock, const std::int64_t lastBlock) {
+                    for (auto b = firstBlock; b < lastBlock; ++b) {
+                        const auto block = static_cast<std::size_t>(b);
+                        const auto first = block * BLOCK_SIZE;
+                        const auto last =
+                            std::min(first + BLOCK_SIZE, input.size());
+
+                        for (auto i = first; i < last; ++i) {
+                            const std::size_t bucket =
+                                bucketIndex(in[i].mortonCode, lowBit);
+                            std::size_t& outIndex =
+                                outIndices[bucket * blocks + block];
+
+                            out[outIndex] = in[i];
+                            ++outIndex;
+                        }
+                    }
+                },
+                blocksCount);
         }
 
         if constexpr (PASSES_COUNT & 1) {
@@ -207,13 +255,13 @@ namespace idragnev::pbrt::accelerators::bvh {
     //
     // (!) Assumes  that `mortonPrims` are sorted by
     // MortonPrimitive::mortonCode. (!)
-    std::vector<LBVHTreelet>
-    splitToTreelets(const std::vector<MortonPrimitive>& mortonPrims,
+    std::pmr::vector<LBVHTreelet>
+    splitToTreelets(const std::pmr::vector<MortonPrimitive>& mortonPrims,
                     memory::MemoryArena& arena,
                     const bool initializeAllocatedNodes) {
         using constants::MORTON_CODE_CLUSTER_MASK;
 
-        std::vector<LBVHTreelet> result;
+        std::pmr::vector<LBVHTreelet> result(&arena);
 
         for (std::size_t first = 0, last = 1; last <= mortonPrims.size();
              ++last) {
@@ -242,8 +290,8 @@ namespace idragnev::pbrt::accelerators::bvh {
     }
 
     HLBVHBuilder::LowerLevels HLBVHBuilder::buildLowerLevels(
-        std::vector<LBVHTreelet>&& treelets,
-        const std::vector<MortonPrimitive>& mortonPrimInfos) const {
+        std::pmr::vector<LBVHTreelet>&& treelets,
+        const std::pmr::vector<MortonPrimitive>& mortonPrimInfos) const {
         // start with the highest morton code bit which is not guaranteed
         // to be the same for each primitive in the cluster
         constexpr std::size_t splitBit = (constants::MORTON_CODE_BITS - 1) -
@@ -251,7 +299,7 @@ namespace idragnev::pbrt::accelerators::bvh {
 
         std::atomic<std::size_t> nodesCount = 0;
         std::atomic<std::size_t> orderedPrimsFreePosition = 0;
-        PrimsVec orderedPrimitives = {this->prims->size(), nullptr};
+        PrimsVec orderedPrimitives(this->prims->size());
 
         parallel::parallelFor(
             [&treelets,
@@ -276,9 +324,14 @@ namespace idragnev::pbrt::accelerators::bvh {
             },
             static_cast<std::int64_t>(treelets.size()));
 
+        std::vector<BuildNode*> roots;
+        roots.reserve(treelets.size());
+        for (const LBVHTreelet& treelet : treelets) {
+            roots.push_back(treelet.nodes);
+        }
+
         return LowerLevels{
-            .roots =
-                functional::fmap(treelets, [](auto& t) { return t.nodes; }),
+            .roots = std::move(roots),
             .nodesCount = nodesCount,
             .orderedPrimitives = std::move(orderedPrimitives),
         };
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "WideBVHNode.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    namespace constants {
+        // The exponents of the quantization steps are kept in the range
+        // where 255 steps are a normal, finite Float
+        inline constexpr int QUANTIZED_MIN_EXPONENT = -126;
+        inline constexpr int QUANTIZED_MAX_EXPONENT = 119;
+        inline constexpr std::uint8_t QUANTIZED_MAX_STEP = 255;
+    } // namespace constants
+
+    inline Float powerOfTwo(const int exponent) noexcept {
+        assert(exponent >= constants::QUANTIZED_MIN_EXPONENT &&
+               exponent <= constants::QUANTIZED_MAX_EXPONENT);
+#ifdef PBRT_FLOAT_AS_DOUBLE
+        const auto bits = static_cast<std::uint64_t>(exponent + 1023) << 52;
+        return std::bit_cast<double>(bits);
+#else
+        const auto bits = static_cast<std::uint32_t>(exponent + 127) << 23;
+        return std::bit_cast<float>(bits);
+#endif
+    }
+
+    // The steps are powers of two, so the product is exact and the
+    // bounds are rounded just once, however the expression is compiled
+    inline Float dequantize(const Float origin,
+                            const std::uint8_t step,
+                            const Float stepSize) noexcept {
+        return origin + static_cast<Float>(step) * stepSize;
+    }
+
+#ifdef _MSC_VER
+    #pragma warning(push)
+    #pragma warning(disable : 4324) // structure padding due to alignment specifier
+#endif
+    // A WideBVHNode whose children bounds are stored as 8-bit steps from
+    // the minimum of the node bounds, rounded outwards, so the children
+    // may only be bigger. A 4 wide node takes a single cache line and an
+    // 8 wide one takes two, half of a WideBVHNode.
+    template <std::size_t N>
+    struct alignas(64) QuantizedWideBVHNode
+    {
+        static_assert(N == 4 || N == 8,
+                      "Only 4 and 8 wide nodes are supported");
+
+        static constexpr std::size_t Width = N;
+
+        bool isLeaf(const std::size_t child) const noexcept {
+            return primitivesCount[child] > 0;
+        }
+
+        Float stepSize(const std::size_t axis) const noexcept {
+            return powerOfTwo(exponents[axis]);
+        }
+
+        Bounds3f childBounds(const std::size_t child) const noexcept {
+            Point3f min;
+            Point3f max;
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                const Float size = stepSize(axis);
+                min[axis] =
+                    dequantize(origin[axis], steps[0][axis][child], size);
+                max[axis] =
+                    dequantize(origin[axis], steps[1][axis][child], size);
+            }
+
+            return Bounds3f{min, max};
+        }
+
+        // Writes the bounds of all children as WideBVHNode::bounds
+        void dequantizeBounds(Float (&bounds)[2][3][N]) const noexcept {
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                const Float size = stepSize(axis);
+                for (std::size_t side = 0; side < 2; ++side) {
+                    for (std::size_t child = 0; child < N; ++child) {
+                        bounds[side][axis][child] =
+                            dequantize(origin[axis],
+                                       steps[side][axis][child],
+                                       size);
+                    }
+                }
+            }
+        }
+
+        // the minimum of the node bounds
+        Float origin[3];
+        // as in WideBVHNode
+        std::uint32_t offsets[N];
+        std::uint16_t primitivesCount[N];
+        // steps[0] are the minimums and steps[1] the maximums
+        // of the children along each axis
+        std::uint8_t steps[2][3][N];
+        // of the power of two step size along each axis
+        std::int8_t exponents[3];
+        std::uint8_t childrenCount = 0;
+    };
+#ifdef _MSC_VER
+    #pragma warning(pop)
+#endif
+#ifndef PBRT_FLOAT_AS_DOUBLE
+    static_assert(sizeof(QuantizedWideBVHNode<4>) == 64,
+                  "A QuantizedWideBVHNode<4> must fit in a cache line");
+#endif
+
+    // Tests the ray against the bounds of all children of `node`
+    // as intersectChildBounds
+    template <std::size_t N>
+    std::uint32_t intersectChildren(const QuantizedWideBVHNode<N>& node,
+                                    const WideRayQuery& query,
+                                    const Float tMax,
+                                    Float tNear[N]) noexcept {
+        alignas(32) Float bounds[2][3][N];
+        node.dequantizeBounds(bounds);
+
+        return intersectChildBounds<N>(bounds,
+                                       node.childrenCount,
+                                       query,
+                                       tMax,
+                                       tNear);
+    }
+
+    // Quantizes the children bounds of the nodes written by
+    // WideBVHCollapser. The node indices stay the same.
+    template <std::size_t N>
+    class WideBVHQuantizer
+    {
+    public:
+        static void quantize(const WideBVHNode<N>& node,
+                             QuantizedWideBVHNode<N>& result) noexcept {
+            Bounds3f bounds;
+            for (std::size_t child = 0; child < node.childrenCount; ++child) {
+                bounds = unionOf(bounds, node.childBounds(child));
+            }
+
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                result.origin[axis] = bounds.min[axis];
+                result.exponents[axis] =
+                    exponentOf(bounds.min[axis], bounds.max[axis]);
+            }
+
+            for (std::size_t child = 0; child < N; ++child) {
+                result.offsets[child] = node.offsets[child];
+                result.primitivesCount[child] = node.primitivesCount[child];
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    // the empty slots are inverted as in WideBVHNode
+                    result.steps[0][axis][child] =
+                        constants::QUANTIZED_MAX_STEP;
+                    result.steps[1][axis][child] = 0;
+                }
+            }
+            for (std::size_t child = 0; child < node.childrenCount; ++child) {
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    quantizeChild(node, child, axis, result);
+                }
+            }
+            result.childrenCount = node.childrenCount;
+        }
+
+    private:
+        // The smallest exponent whose 255 steps from `min` reach `max`
+        static std::int8_t exponentOf(const Float min, const Float max) {
+            assert(std::isfinite(min) && std::isfinite(max));
+
+            int exponent = constants::QUANTIZED_MIN_EXPONENT;
+            if (const Float extent = max - min; extent > 0.f) {
+                std::frexp(extent / constants::QUANTIZED_MAX_STEP, &exponent);
+                exponent =
+                    std::max(exponent, constants::QUANTIZED_MIN_EXPONENT);
+            }
+            // the sum may be rounded below `max`
+            while (dequantize(min,
+                              constants::QUANTIZED_MAX_STEP,
+                              powerOfTwo(exponent)) < max) {
+                ++exponent;
+            }
+
+            return static_cast<std::int8_t>(exponent);
+        }
+
+        static void quantizeChild(const WideBVHNode<N>& node,
+                                  const std::size_t child,
+                                  const std::size_t axis,
+                                  QuantizedWideBVHNode<N>& result) noexcept {
+            const Float origin = result.origin[axis];
+            const Float size = result.stepSize(axis);
+            const Float min = node.bounds[0][axis][child];
+            const Float max = node.bounds[1][axis][child];
+
+            // step 0 is the origin and step 255 is past the node bounds,
+            // so moving outwards always ends up covering the child
+            auto low = static_cast<std::uint8_t>(
+                std::clamp(std::floor((min - origin) / size),
+                           Float(0),
+                           Float(constants::QUANTIZED_MAX_STEP)));
+            while (low > 0 && dequantize(origin, low, size) > min) {
+                --low;
+            }
+
+            auto high = static_cast<std::uint8_t>(
+                std::clamp(std::ceil((max - origin) / size),
+                           Float(0),
+                           Float(constants::QUANTIZED_MAX_STEP)));
+            while (high < constants::QUANTIZED_MAX_STEP &&
+                   dequantize(origin, high, size) < max) {
+                ++high;
+            }
+
+            assert(dequantize(origin, low, size) <= min);
+            assert(dequantize(origin, high, size) >= max);
+
+            result.steps[0][axis][child] = low;
+            result.steps[1][axis][child] = high;
+        }
+    };
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
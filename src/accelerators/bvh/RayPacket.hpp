@@ -0,0 +1,144 @@
+#pragma once
+
+#include "WideBVHNode.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+
+#include <bit>
+#include <span>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    // The rays of a packet laid out SoA, so a box is tested against
+    // several of them at once
+    template <std::size_t K>
+    struct RayPacket
+    {
+        static_assert(K == 4 || K == 8 || K == 16,
+                      "Only packets of 4, 8 and 16 rays are supported");
+
+        explicit RayPacket(const std::span<const Ray, K> rays) noexcept
+            : rays(rays) {
+            for (std::size_t i = 0; i < K; ++i) {
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    origin[axis][i] = rays[i].o[axis];
+                    invDir[axis][i] = 1.f / rays[i].d[axis];
+                }
+                tMax[i] = rays[i].tMax;
+            }
+        }
+
+        // Picks up the rays shortened by the hits found so far
+        void updateTMax(const std::uint32_t mask) noexcept {
+            for (std::uint32_t m = mask; m != 0; m &= m - 1) {
+                const auto i = std::countr_zero(m);
+                tMax[i] = rays[i].tMax;
+            }
+        }
+
+        bool isDirNegative(const std::size_t axis,
+                           const std::size_t ray) const noexcept {
+            return invDir[axis][ray] < 0.f;
+        }
+
+        std::span<const Ray, K> rays;
+        alignas(16) Float origin[3][K];
+        alignas(16) Float invDir[3][K];
+        alignas(16) Float tMax[K];
+    };
+
+#if defined(PBRT_HAS_SSE_BVH)
+    // Tests four rays laid out SoA against `bounds` as intersectChildren
+    // tests each child. Writes their entry distances to `tNear` and
+    // returns a mask of the rays which hit the bounds.
+    inline std::uint32_t intersectBounds4(const Bounds3f& bounds,
+                                          const __m128 (&origin)[3],
+                                          const __m128 (&invDir)[3],
+                                          const __m128 rayTMax,
+                                          Float tNear[4]) noexcept {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 farScale = _mm_set1_ps(constants::SLAB_FAR_SCALE);
+        __m128 t0 = zero;
+        __m128 t1 = rayTMax;
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            const __m128 tMin = _mm_mul_ps(
+                _mm_sub_ps(_mm_set1_ps(bounds.min[axis]), origin[axis]),
+                invDir[axis]);
+            const __m128 tMax = _mm_mul_ps(
+                _mm_sub_ps(_mm_set1_ps(bounds.max[axis]), origin[axis]),
+                invDir[axis]);
+            // the rays with negative directions enter through max
+            const __m128 isNegative = _mm_cmplt_ps(invDir[axis], zero);
+            const __m128 tEnter = _mm_or_ps(_mm_and_ps(isNegative, tMax),
+                                            _mm_andnot_ps(isNegative, tMin));
+            const __m128 tExit =
+                _mm_mul_ps(_mm_or_ps(_mm_and_ps(isNegative, tMin),
+                                     _mm_andnot_ps(isNegative, tMax)),
+                           farScale);
+            // max and min return the second operand for NaNs
+            t0 = _mm_max_ps(tEnter, t0);
+            t1 = _mm_min_ps(tExit, t1);
+        }
+        _mm_storeu_ps(tNear, t0);
+
+        return static_cast<std::uint32_t>(
+            _mm_movemask_ps(_mm_cmple_ps(t0, t1)));
+    }
+#endif
+
+    // Tests the rays of `packet` set in `activeMask` against `bounds`.
+    // Writes their entry distances to `tNear` and returns a mask of the
+    // rays which hit the bounds. Each ray is tested exactly as by
+    // intersectChildren, SSE tests four of them at once.
+    template <std::size_t K>
+    std::uint32_t intersectBounds(const Bounds3f& bounds,
+                                  const RayPacket<K>& packet,
+                                  const std::uint32_t activeMask,
+                                  Float tNear[K]) noexcept {
+        std::uint32_t hitMask = 0;
+
+        for (std::size_t first = 0; first < K; first += 4) {
+            if (((activeMask >> first) & 0xFu) == 0) {
+                continue;
+            }
+
+#if defined(PBRT_HAS_SSE_BVH)
+            const __m128 origin[3] = {_mm_load_ps(&packet.origin[0][first]),
+                                      _mm_load_ps(&packet.origin[1][first]),
+                                      _mm_load_ps(&packet.origin[2][first])};
+            const __m128 invDir[3] = {_mm_load_ps(&packet.invDir[0][first]),
+                                      _mm_load_ps(&packet.invDir[1][first]),
+                                      _mm_load_ps(&packet.invDir[2][first])};
+            hitMask |= intersectBounds4(bounds,
+                                        origin,
+                                        invDir,
+                                        _mm_load_ps(&packet.tMax[first]),
+                                        tNear + first)
+                       << first;
+#else
+            for (std::size_t ray = first; ray < first + 4; ++ray) {
+                Float near[3];
+                Float far[3];
+                Float origin[3];
+                Float invDir[3];
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    const bool isNegative = packet.isDirNegative(axis, ray);
+                    near[axis] =
+                        isNegative ? bounds.max[axis] : bounds.min[axis];
+                    far[axis] =
+                        isNegative ? bounds.min[axis] : bounds.max[axis];
+                    origin[axis] = packet.origin[axis][ray];
+                    invDir[axis] = packet.invDir[axis][ray];
+                }
+                const bool hit = intersectSlabs(near,
+                                                far,
+                                                origin,
+                                                invDir,
+                                                packet.tMax[ray],
+                                                tNear[ray]);
+                hitMask |= (hit ? 1u : 0u) << ray;
+            }
+#endif
+        }
+
+        return hitMask & activeMask;
+    }
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "RayStream.hpp"
+#include "RayPacket.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/core/math/Point3.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    namespace {
+        std::uint32_t octantOf(const Vector3f& d) noexcept {
+            return (d.x < 0.f ? 1u : 0u) | (d.y < 0.f ? 2u : 0u) |
+                   (d.z < 0.f ? 4u : 0u);
+        }
+
+        std::uint32_t cellOf(const Point3f& p, const Bounds3f& bounds) {
+            constexpr Float lastCell =
+                constants::RAY_STREAM_GRID_RESOLUTION - 1.f;
+
+            Vector3f cell = constants::RAY_STREAM_GRID_RESOLUTION *
+                            bounds.offset(p);
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                // the origins outside the bounds go to the border cells
+                // and NaNs go to the first one
+                cell[axis] = cell[axis] >= 0.f ? cell[axis] : 0.f;
+                cell[axis] = cell[axis] < lastCell ? cell[axis] : lastCell;
+            }
+
+            return encodeMorton3(cell);
+        }
+
+#if defined(PBRT_HAS_SSE_BVH)
+        // Tests the rays of four ids at once, as intersectBounds tests each
+        // of them. Returns a mask of the rays which hit `bounds`.
+        std::uint32_t intersectBounds(const Bounds3f& bounds,
+                                      const std::span<const StreamRay> rays,
+                                      const std::uint32_t (&ids)[4],
+                                      Float tNear[4]) noexcept {
+            const StreamRay& a = rays[ids[0]];
+            const StreamRay& b = rays[ids[1]];
+            const StreamRay& c = rays[ids[2]];
+            const StreamRay& d = rays[ids[3]];
+
+            __m128 origin[3];
+            __m128 invDir[3];
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                origin[axis] = _mm_setr_ps(a.query.origin[axis],
+                                           b.query.origin[axis],
+                                           c.query.origin[axis],
+                                           d.query.origin[axis]);
+                invDir[axis] = _mm_setr_ps(a.query.invDir[axis],
+                                           b.query.invDir[axis],
+                                           c.query.invDir[axis],
+                                           d.query.invDir[axis]);
+            }
+
+            return intersectBounds4(bounds,
+                                    origin,
+                                    invDir,
+                                    _mm_setr_ps(a.tMax, b.tMax, c.tMax, d.tMax),
+                                    tNear);
+        }
+#endif
+    } // namespace
+
+    std::vector<StreamRay> sortRayStream(const std::span<const Ray> rays,
+                                         const Bounds3f& bounds) {
+        struct SortKey
+        {
+            std::uint32_t key = 0;
+            std::uint32_t index = 0;
+        };
+
+        std::vector<SortKey> keys(rays.size());
+        for (std::size_t i = 0; i < rays.size(); ++i) {
+            const Ray& ray = rays[i];
+            // the cells of the 16x16x16 grid take 12 bits
+            keys[i].key = (octantOf(ray.d) << 12) | cellOf(ray.o, bounds);
+            keys[i].index = static_cast<std::uint32_t>(i);
+        }
+
+        std::sort(keys.begin(),
+                  keys.end(),
+                  [](const SortKey& a, const SortKey& b) {
+                      return a.key < b.key ||
+                             (a.key == b.key && a.index < b.index);
+                  });
+
+        std::vector<StreamRay> result;
+        result.reserve(rays.size());
+        for (const SortKey& key : keys) {
+            const Ray& ray = rays[key.index];
+            result.push_back(StreamRay{
+                .query = WideRayQuery{ray},
+                .tMax = ray.tMax,
+                .index = key.index,
+            });
+        }
+
+        return result;
+    }
+
+    Float filterRayStream(const Bounds3f& bounds,
+                          const std::span<const StreamRay> rays,
+                          std::vector<std::uint32_t>& ids,
+                          const std::size_t first,
+                          const std::size_t count) {
+        ids.reserve(ids.size() + count);
+
+        Float closest = pbrt::constants::Infinity;
+        std::size_t i = first;
+#if defined(PBRT_HAS_SSE_BVH)
+        for (; i + 4 <= first + count; i += 4) {
+            const std::uint32_t group[4] = {ids[i],
+                                            ids[i + 1],
+                                            ids[i + 2],
+                                            ids[i + 3]};
+            Float tNear[4];
+            for (std::uint32_t m = intersectBounds(bounds, rays, group, tNear);
+                 m != 0;
+                 m &= m - 1) {
+                const auto k = std::countr_zero(m);
+                ids.push_back(group[k]);
+                closest = tNear[k] < closest ? tNear[k] : closest;
+            }
+        }
+#endif
+        for (; i < first + count; ++i) {
+            const std::uint32_t id = ids[i];
+            Float tNear = 0.f;
+            if (intersectBounds(bounds, rays[id], tNear)) {
+                ids.push_back(id);
+                closest = tNear < closest ? tNear : closest;
+            }
+        }
+
+        return closest;
+    }
+
+    std::size_t compactRayStream(const Bounds3f& bounds,
+                                 const std::span<const StreamRay> rays,
+                                 const std::span<std::uint32_t> ids) {
+        std::size_t count = 0;
+        std::size_t i = 0;
+#if defined(PBRT_HAS_SSE_BVH)
+        for (; i + 4 <= ids.size(); i += 4) {
+            const std::uint32_t group[4] = {ids[i],
+                                            ids[i + 1],
+                                            ids[i + 2],
+                                            ids[i + 3]};
+            Float tNear[4];
+            for (std::uint32_t m = intersectBounds(bounds, rays, group, tNear);
+                 m != 0;
+                 m &= m - 1) {
+                ids[count++] = group[std::countr_zero(m)];
+            }
+        }
+#endif
+        for (; i < ids.size(); ++i) {
+            const std::uint32_t id = ids[i];
+            Float tNear = 0.f;
+            if (intersectBounds(bounds, rays[id], tNear)) {
+                ids[count++] = id;
+            }
+        }
+
+        return count;
+    }
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
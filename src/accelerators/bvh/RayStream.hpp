@@ -0,0 +1,71 @@
+#pragma once
+
+#include "WideBVHNode.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+
+#include <span>
+#include <vector>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    namespace constants {
+        // The rays of a stream are traversed in batches of this many,
+        // which bounds the memory of the traversal
+        inline constexpr std::size_t RAY_STREAM_BATCH_SIZE = 4096;
+        // The origins of the rays are binned in a grid with this many
+        // cells along each axis of the scene bounds, keep it in sync with
+        // the sort keys of sortRayStream
+        inline constexpr Float RAY_STREAM_GRID_RESOLUTION = 16.f;
+    } // namespace constants
+
+    // A ray of a stream with the data of its node tests
+    struct StreamRay
+    {
+        WideRayQuery query;
+        Float tMax = pbrt::constants::Infinity;
+        // the index of the ray in the traced span
+        std::uint32_t index = 0;
+    };
+
+    // Orders the rays by the octant of their direction and then by the
+    // cell of their origin in a grid over `bounds`, so the rays of a
+    // batch are likely to visit the same nodes.
+    std::vector<StreamRay> sortRayStream(const std::span<const Ray> rays,
+                                         const Bounds3f& bounds);
+
+    // Appends the ids among ids[first, first + count) of the rays which
+    // intersect `bounds` to `ids`. Returns the closest entry distance
+    // of these rays. SSE tests the rays of four ids at once.
+    Float filterRayStream(const Bounds3f& bounds,
+                          const std::span<const StreamRay> rays,
+                          std::vector<std::uint32_t>& ids,
+                          const std::size_t first,
+                          const std::size_t count);
+
+    // Keeps only the ids of the rays which still intersect `bounds`
+    // at the front of `ids` and returns their count
+    std::size_t compactRayStream(const Bounds3f& bounds,
+                                 const std::span<const StreamRay> rays,
+                                 const std::span<std::uint32_t> ids);
+
+    // Tests the ray as intersectChildren tests each child
+    inline bool intersectBounds(const Bounds3f& bounds,
+                                const StreamRay& ray,
+                                Float& tNear) noexcept {
+        const WideRayQuery& query = ray.query;
+
+        Float near[3];
+        Float far[3];
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            const std::uint32_t side = query.nearSide[axis];
+            near[axis] = bounds[side][axis];
+            far[axis] = bounds[1 - side][axis];
+        }
+
+        return intersectSlabs(near,
+                              far,
+                              query.origin,
+                              query.invDir,
+                              ray.tMax,
+                              tNear);
+    }
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
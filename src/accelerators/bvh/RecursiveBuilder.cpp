@@ -1,7 +1,12 @@
 #include "pbrt/accelerators/bvh/RecursiveBuilder.hpp"
-#include "pbrt/functional/Functional.hpp"
+#include "pbrt/parallel/Parallel.hpp"
 
 namespace idragnev::pbrt::accelerators::bvh {
+    namespace constants {
+        // subtrees with fewer primitives are built by a single thread
+        constexpr std::size_t MIN_PRIMITIVES_FOR_PARALLEL_SUBTREES = 16384;
+    } // namespace constants
+
     std::size_t partitionPrimitivesInfoInEqualSubsets(
         const std::size_t splitAxis,
         const std::span<PrimitiveInfo> primsInfoRange);
@@ -21,16 +26,23 @@ namespace idragnev::pbrt::accelerators::bvh {
             return result;
         }
 
-        std::vector<PrimitiveInfo> primitivesInfo = functional::fmapIndexed(
-            primitives,
-            [](const auto& primitive, const std::size_t i) {
-                return PrimitiveInfo{i, primitive->worldBound()};
-            });
+        std::pmr::vector<PrimitiveInfo> primitivesInfo(&arena);
+        primitivesInfo.reserve(primitives.size());
+        for (std::size_t i = 0; i < primitives.size(); ++i) {
+            primitivesInfo.emplace_back(i, primitives[i].worldBound());
+        }
+
+        // A tree with one primitive per leaf has 2n - 1 nodes. Allocating
+        // them upfront lets subtrees be built in parallel without sharing
+        // the arena - each one owns a contiguous range of the nodes.
+        const std::size_t maxNodesCount = 2 * primitives.size() - 1;
+        BuildNode* const nodes = arena.alloc<BuildNode>(maxNodesCount, false);
 
-        result.orderedPrimitives.reserve(primitives.size());
+        result.orderedPrimitives.resize(primitives.size());
         result.tree = buildSubtree(
-            arena,
+            nodes,
             std::span{primitivesInfo.begin(), primitivesInfo.size()},
+            0,
             primitives,
             result.orderedPrimitives);
 
@@ -38,12 +50,13 @@ namespace idragnev::pbrt::accelerators::bvh {
     }
 
     BuildTree RecursiveBuilder::buildSubtree(
-        memory::MemoryArena& arena,
+        BuildNode* const nodes,
         const std::span<PrimitiveInfo> primsInfoRange,
+        const std::size_t firstPrimIndex,
         const PrimsVec& primitives,
         PrimsVec& orderedPrims) const {
         BuildTree result{
-            .root = arena.alloc<BuildNode>(),
+            .root = nodes,
         };
 
         const Bounds3f rangeBounds = bounds(primsInfoRange);
@@ -52,6 +65,7 @@ namespace idragnev::pbrt::accelerators::bvh {
             result.nodesCount = 1;
             *result.root = buildLeafNode(rangeBounds,
                                          primsInfoRange,
+                                         firstPrimIndex,
                                          primitives,
                                          orderedPrims);
         }
@@ -64,15 +78,17 @@ namespace idragnev::pbrt::accelerators::bvh {
                 result.nodesCount = 1;
                 *result.root = buildLeafNode(rangeBounds,
                                              primsInfoRange,
+                                             firstPrimIndex,
                                              primitives,
                                              orderedPrims);
             }
             else {
                 const auto subtrees =
-                    buildInternalNodeChildren(arena,
+                    buildInternalNodeChildren(nodes + 1,
                                               rangeBounds,
                                               rangeCentroidBounds,
                                               primsInfoRange,
+                                              firstPrimIndex,
                                               primitives,
                                               orderedPrims);
                 if (subtrees.has_value()) {
@@ -86,6 +102,7 @@ namespace idragnev::pbrt::accelerators::bvh {
                     result.nodesCount = 1;
                     *result.root = buildLeafNode(rangeBounds,
                                                  primsInfoRange,
+                                                 firstPrimIndex,
                                                  primitives,
                                                  orderedPrims);
                 }
@@ -98,13 +115,14 @@ namespace idragnev::pbrt::accelerators::bvh {
     BuildNode RecursiveBuilder::buildLeafNode(
         const Bounds3f& bounds,
         const std::span<PrimitiveInfo> primsInfoRange,
+        const std::size_t firstPrimIndex,
         const PrimsVec& primitives,
         PrimsVec& orderedPrims) const {
-        const auto firstPrimIndex = orderedPrims.size();
         const auto primitivesCount = primsInfoRange.size();
 
-        for (const PrimitiveInfo& pi : primsInfoRange) {
-            orderedPrims.push_back(primitives[pi.index]);
+        for (std::size_t i = 0; i < primitivesCount; ++i) {
+            orderedPrims[firstPrimIndex + i] =
+                primitives[primsInfoRange[i].index];
         }
 
         return BuildNode::Leaf(firstPrimIndex, primitivesCount, bounds);
@@ -112,30 +130,46 @@ namespace idragnev::pbrt::accelerators::bvh {
 
     Optional<std::pair<BuildTree, BuildTree>>
     RecursiveBuilder::buildInternalNodeChildren(
-        memory::MemoryArena& arena,
+        BuildNode* const childNodes,
         const Bounds3f& rangeBounds,
         const Bounds3f& rangeCentroidBounds,
         const std::span<PrimitiveInfo> primsInfoRange,
+        const std::size_t firstPrimIndex,
         const PrimsVec& primitives,
         PrimsVec& orderedPrims) const {
         const auto splitPosition = partitionPrimitivesInfo(rangeBounds,
                                                            rangeCentroidBounds,
                                                            primsInfoRange);
-        return splitPosition.map([this,
-                                  &orderedPrims,
-                                  &primsInfoRange,
-                                  &primitives,
-                                  &arena](const std::size_t splitPos) {
-            const BuildTree left =
-                buildSubtree(arena,
-                             primsInfoRange.first(splitPos),
-                             primitives,
-                             orderedPrims);
-            const BuildTree right =
-                buildSubtree(arena,
-                             primsInfoRange.subspan(splitPos),
-                             primitives,
-                             orderedPrims);
+        return splitPosition.map([&](const std::size_t splitPos) {
+            const auto buildLeft = [&] {
+                return buildSubtree(childNodes,
+                                    primsInfoRange.first(splitPos),
+                                    firstPrimIndex,
+                                    primitives,
+                                    orderedPrims);
+            };
+            // the left subtree takes the first 2 * splitPos - 1 nodes
+            const auto buildRight = [&] {
+                return buildSubtree(childNodes + 2 * splitPos - 1,
+                                    primsInfoRange.subspan(splitPos),
+                                    firstPrimIndex + splitPos,
+                                    primitives,
+                                    orderedPrims);
+            };
+
+            if (primsInfoRange.size() <
+                constants::MIN_PRIMITIVES_FOR_PARALLEL_SUBTREES) {
+                const BuildTree left = buildLeft();
+                const BuildTree right = buildRight();
+
+                return std::make_pair(left, right);
+            }
+
+            BuildTree left;
+            parallel::TaskGroup subtrees;
+            subtrees.spawn([&left, &buildLeft] { left = buildLeft(); });
+            const BuildTree right = buildRight();
+            subtrees.wait();
 
             return std::make_pair(left, right);
         });
@@ -1,4 +1,5 @@
 #include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/parallel/Parallel.hpp"
 
 #include <array>
 
@@ -57,19 +58,29 @@ namespace idragnev::pbrt::accelerators::bvh {
                 .value_or(true);
 
         if (shouldPartition) {
-            const auto splitPos = std::partition(
-                primitives.begin(),
-                primitives.end(),
-                [&primitivesCentroidBounds, splitAxis, &buckets, &split](
-                    const PrimitiveInfo& info) {
-                    const std::size_t index =
-                        bucketIndex(info,
-                                    primitivesCentroidBounds,
-                                    buckets,
-                                    splitAxis);
-
-                    return index <= split.splitBucketIndex;
-                });
+            const auto isBeforeSplit = [&primitivesCentroidBounds,
+                                        splitAxis,
+                                        &buckets,
+                                        &split](const PrimitiveInfo& info) {
+                const std::size_t index = bucketIndex(info,
+                                                      primitivesCentroidBounds,
+                                                      buckets,
+                                                      splitAxis);
+
+                return index <= split.splitBucketIndex;
+            };
+
+            const auto isLargeRange =
+                primitives.size() >
+                static_cast<std::size_t>(parallel::constants::ALGORITHMS_BLOCK_SIZE);
+            const auto splitPos =
+                isLargeRange
+                    ? parallel::parallelStablePartition(primitives.begin(),
+                                                        primitives.end(),
+                                                        isBeforeSplit)
+                    : std::partition(primitives.begin(),
+                                     primitives.end(),
+                                     isBeforeSplit);
             const auto splitPosition = splitPos - primitives.begin();
 
             return pbrt::make_optional(static_cast<std::size_t>(splitPosition));
@@ -83,17 +94,27 @@ namespace idragnev::pbrt::accelerators::bvh {
     splitToBuckets(const std::size_t splitAxis,
                    const Bounds3f& centroidBounds,
                    const std::span<const PrimitiveInfo> primitives) {
-        BucketsArray buckets{};
-
-        for (const PrimitiveInfo& info : primitives) {
-            const std::size_t index =
-                bucketIndex(info, centroidBounds, buckets, splitAxis);
-
-            buckets[index].size += 1;
-            buckets[index].bounds = unionOf(buckets[index].bounds, info.bounds);
-        }
-
-        return buckets;
+        return parallel::parallelReduce(
+            static_cast<std::int64_t>(primitives.size()),
+            BucketsArray{},
+            [&](BucketsArray& buckets, const std::int64_t i) {
+                const PrimitiveInfo& info =
+                    primitives[static_cast<std::size_t>(i)];
+                const std::size_t index =
+                    bucketIndex(info, centroidBounds, buckets, splitAxis);
+
+                buckets[index].size += 1;
+                buckets[index].bounds =
+                    unionOf(buckets[index].bounds, info.bounds);
+            },
+            [](BucketsArray a, const BucketsArray& b) {
+                for (std::size_t i = 0; i < a.size(); ++i) {
+                    a[i].size += b[i].size;
+                    a[i].bounds = unionOf(a[i].bounds, b[i].bounds);
+                }
+
+                return a;
+            });
     }
 
     BestSplit findBestSplit(const Bounds3f& primitivesBounds,
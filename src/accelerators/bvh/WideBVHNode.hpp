@@ -0,0 +1,339 @@
+#pragma once
+
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/math/Vector3.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <assert.h>
+
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(PBRT_FLOAT_AS_DOUBLE)
+    #include <immintrin.h>
+    #define PBRT_HAS_SSE_BVH
+    #if defined(__AVX__)
+        #define PBRT_HAS_AVX_BVH
+    #endif
+#endif
+
+namespace idragnev::pbrt::accelerators::bvh {
+#ifdef _MSC_VER
+    #pragma warning(push)
+    #pragma warning(disable : 4324) // structure padding due to alignment specifier
+#endif
+    // A node with up to N children, collapsed from a binary BuildTree.
+    // The children bounds are stored SoA, so a ray is tested against
+    // all of them at once. The occupied slots come first.
+    template <std::size_t N>
+    struct alignas(64) WideBVHNode
+    {
+        static_assert(N == 4 || N == 8,
+                      "Only 4 and 8 wide nodes are supported");
+
+        static constexpr std::size_t Width = N;
+
+        bool isLeaf(const std::size_t child) const noexcept {
+            return primitivesCount[child] > 0;
+        }
+
+        Bounds3f childBounds(const std::size_t child) const noexcept {
+            return Bounds3f{Point3f{bounds[0][0][child],
+                                    bounds[0][1][child],
+                                    bounds[0][2][child]},
+                            Point3f{bounds[1][0][child],
+                                    bounds[1][1][child],
+                                    bounds[1][2][child]}};
+        }
+
+        // bounds[0] are the minimums and bounds[1] the maximums
+        // of the children along each axis
+        Float bounds[2][3][N];
+        // the index of the child node of interior children,
+        // the index of the first primitive of leaf children
+        std::uint32_t offsets[N];
+        // zero for interior children
+        std::uint16_t primitivesCount[N];
+        std::uint8_t childrenCount = 0;
+    };
+#ifdef _MSC_VER
+    #pragma warning(pop)
+#endif
+
+    // The per-ray data of the node tests
+    struct WideRayQuery
+    {
+        explicit WideRayQuery(const Ray& ray) noexcept {
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                origin[axis] = ray.o[axis];
+                invDir[axis] = 1.f / ray.d[axis];
+                nearSide[axis] = invDir[axis] < 0.f ? 1u : 0u;
+            }
+        }
+
+        Float origin[3];
+        Float invDir[3];
+        // the side of the bounds a ray enters through along each axis
+        std::uint32_t nearSide[3];
+    };
+
+    namespace constants {
+        // Makes the slab test conservative, as in Bounds3::intersectP
+        inline constexpr Float SLAB_FAR_SCALE = 1.f + 2.f * gamma(3);
+    } // namespace constants
+
+    // The scalar slab test of one ray against a box, which the ray enters
+    // through the planes `near` and leaves through `far`. Writes the entry
+    // distance to `tNear` and returns whether the ray hits the box.
+    // A NaN distance leaves the other axes to decide.
+    inline bool intersectSlabs(const Float (&near)[3],
+                               const Float (&far)[3],
+                               const Float (&origin)[3],
+                               const Float (&invDir)[3],
+                               const Float tMax,
+                               Float& tNear) noexcept {
+        Float t0 = 0.f;
+        Float t1 = tMax;
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            const Float tEnter = (near[axis] - origin[axis]) * invDir[axis];
+            const Float tExit = (far[axis] - origin[axis]) * invDir[axis] *
+                                constants::SLAB_FAR_SCALE;
+            // the comparisons are false for NaNs
+            t0 = tEnter > t0 ? tEnter : t0;
+            t1 = tExit < t1 ? tExit : t1;
+        }
+        tNear = t0;
+
+        return t0 <= t1;
+    }
+
+    // Tests the ray against the bounds of the first `childrenCount`
+    // children of a node, laid out and aligned as WideBVHNode::bounds.
+    // Writes the entry distances of the hit children to `tNear`
+    // and returns a mask with a bit set for each of them.
+    // A NaN distance, from an origin lying on a slab of an axis
+    // parallel ray, leaves the other axes to decide.
+    template <std::size_t N>
+    std::uint32_t intersectChildBounds(const Float (&bounds)[2][3][N],
+                                       const std::size_t childrenCount,
+                                       const WideRayQuery& query,
+                                       const Float tMax,
+                                       Float tNear[N]) noexcept {
+        std::uint32_t hitMask = 0;
+
+#if defined(PBRT_HAS_AVX_BVH)
+        if constexpr (N == 8) {
+            __m256 t0 = _mm256_setzero_ps();
+            __m256 t1 = _mm256_set1_ps(tMax);
+            const __m256 farScale = _mm256_set1_ps(constants::SLAB_FAR_SCALE);
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                const std::uint32_t near = query.nearSide[axis];
+                const __m256 origin = _mm256_set1_ps(query.origin[axis]);
+                const __m256 invDir = _mm256_set1_ps(query.invDir[axis]);
+                const __m256 nearBounds =
+                    _mm256_load_ps(bounds[near][axis]);
+                const __m256 farBounds =
+                    _mm256_load_ps(bounds[1 - near][axis]);
+                const __m256 tEnter =
+                    _mm256_mul_ps(_mm256_sub_ps(nearBounds, origin), invDir);
+                const __m256 tExit = _mm256_mul_ps(
+                    _mm256_mul_ps(_mm256_sub_ps(farBounds, origin), invDir),
+                    farScale);
+                // max and min return the second operand for NaNs
+                t0 = _mm256_max_ps(tEnter, t0);
+                t1 = _mm256_min_ps(tExit, t1);
+            }
+            _mm256_storeu_ps(tNear, t0);
+            hitMask = static_cast<std::uint32_t>(
+                _mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ)));
+        }
+        else
+#endif
+        {
+#if defined(PBRT_HAS_SSE_BVH)
+            const __m128 farScale = _mm_set1_ps(constants::SLAB_FAR_SCALE);
+            for (std::size_t first = 0; first < N; first += 4) {
+                __m128 t0 = _mm_setzero_ps();
+                __m128 t1 = _mm_set1_ps(tMax);
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    const std::uint32_t near = query.nearSide[axis];
+                    const __m128 origin = _mm_set1_ps(query.origin[axis]);
+                    const __m128 invDir = _mm_set1_ps(query.invDir[axis]);
+                    const __m128 nearBounds =
+                        _mm_load_ps(&bounds[near][axis][first]);
+                    const __m128 farBounds =
+                        _mm_load_ps(&bounds[1 - near][axis][first]);
+                    const __m128 tEnter =
+                        _mm_mul_ps(_mm_sub_ps(nearBounds, origin), invDir);
+                    const __m128 tExit = _mm_mul_ps(
+                        _mm_mul_ps(_mm_sub_ps(farBounds, origin), invDir),
+                        farScale);
+                    // max and min return the second operand for NaNs
+                    t0 = _mm_max_ps(tEnter, t0);
+                    t1 = _mm_min_ps(tExit, t1);
+                }
+                _mm_storeu_ps(tNear + first, t0);
+                hitMask |= static_cast<std::uint32_t>(
+                               _mm_movemask_ps(_mm_cmple_ps(t0, t1)))
+                           << first;
+            }
+#else
+            for (std::size_t child = 0; child < N; ++child) {
+                Float near[3];
+                Float far[3];
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    const std::uint32_t side = query.nearSide[axis];
+                    near[axis] = bounds[side][axis][child];
+                    far[axis] = bounds[1 - side][axis][child];
+                }
+                const bool hit = intersectSlabs(near,
+                                                far,
+                                                query.origin,
+                                                query.invDir,
+                                                tMax,
+                                                tNear[child]);
+                hitMask |= (hit ? 1u : 0u) << child;
+            }
+#endif
+        }
+
+        // the empty slots have inverted bounds and are never hit,
+        // masking them out guards against NaNs as well
+        return hitMask & ((1u << childrenCount) - 1u);
+    }
+
+    // Tests the ray against the bounds of all children of `node`
+    // as intersectChildBounds
+    template <std::size_t N>
+    std::uint32_t intersectChildren(const WideBVHNode<N>& node,
+                                    const WideRayQuery& query,
+                                    const Float tMax,
+                                    Float tNear[N]) noexcept {
+        return intersectChildBounds<N>(node.bounds,
+                                       node.childrenCount,
+                                       query,
+                                       tMax,
+                                       tNear);
+    }
+
+    // Collapses the binary BuildTree into wide nodes. Each wide node
+    // takes the children of a binary node and repeatedly opens the
+    // interior child with the largest surface area until there are N
+    // children, so the nodes are as full as the tree allows.
+    template <std::size_t N>
+    class WideBVHCollapser
+    {
+    public:
+        // The number of wide nodes the tree collapses into
+        static std::size_t nodesCount(const BuildNode& root) {
+            if (root.primitivesCount > 0) {
+                return 1;
+            }
+
+            const BuildNode* children[N];
+            const std::size_t childrenCount = collectChildren(root, children);
+
+            std::size_t result = 1;
+            for (std::size_t i = 0; i < childrenCount; ++i) {
+                if (children[i]->primitivesCount == 0) {
+                    result += nodesCount(*children[i]);
+                }
+            }
+
+            return result;
+        }
+
+        // Writes the wide nodes in depth-first order starting at
+        // `nodes[nodeIndex]` and returns the number of nodes written.
+        static std::size_t collapse(const BuildNode& root,
+                                    WideBVHNode<N>* const nodes,
+                                    const std::size_t nodeIndex) {
+            WideBVHNode<N>& node = nodes[nodeIndex];
+            resetChildren(node);
+
+            const BuildNode* children[N];
+            // A single leaf is kept as the only child of the root
+            const std::size_t childrenCount = root.primitivesCount > 0
+                                                  ? (children[0] = &root, 1)
+                                                  : collectChildren(root,
+                                                                    children);
+
+            node.childrenCount = static_cast<std::uint8_t>(childrenCount);
+            std::size_t written = 1;
+            for (std::size_t i = 0; i < childrenCount; ++i) {
+                const BuildNode& child = *children[i];
+                setChildBounds(node, i, child.bounds);
+
+                // BVH::build checks that the offsets fit in 32 bits
+                if (child.primitivesCount > 0) {
+                    assert(child.primitivesCount <= 65535);
+                    assert(child.firstPrimitiveIndex <=
+                           std::numeric_limits<std::uint32_t>::max());
+                    node.offsets[i] =
+                        static_cast<std::uint32_t>(child.firstPrimitiveIndex);
+                    node.primitivesCount[i] =
+                        static_cast<std::uint16_t>(child.primitivesCount);
+                }
+                else {
+                    const std::size_t childIndex = nodeIndex + written;
+                    assert(childIndex <=
+                           std::numeric_limits<std::uint32_t>::max());
+                    node.offsets[i] = static_cast<std::uint32_t>(childIndex);
+                    written += collapse(child, nodes, childIndex);
+                }
+            }
+
+            return written;
+        }
+
+    private:
+        static std::size_t collectChildren(const BuildNode& interior,
+                                           const BuildNode* children[N]) {
+            children[0] = interior.children[0];
+            children[1] = interior.children[1];
+            std::size_t count = 2;
+
+            while (count < N) {
+                std::size_t largest = N;
+                Float largestArea = -1.f;
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (children[i]->primitivesCount == 0 &&
+                        children[i]->bounds.surfaceArea() > largestArea) {
+                        largest = i;
+                        largestArea = children[i]->bounds.surfaceArea();
+                    }
+                }
+
+                if (largest == N) {
+                    break;
+                }
+
+                const BuildNode* const opened = children[largest];
+                children[largest] = opened->children[0];
+                children[count++] = opened->children[1];
+            }
+
+            return count;
+        }
+
+        static void resetChildren(WideBVHNode<N>& node) noexcept {
+            for (std::size_t i = 0; i < N; ++i) {
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    node.bounds[0][axis][i] = pbrt::constants::Infinity;
+                    node.bounds[1][axis][i] = -pbrt::constants::Infinity;
+                }
+                node.offsets[i] = 0;
+                node.primitivesCount[i] = 0;
+            }
+            node.childrenCount = 0;
+        }
+
+        static void setChildBounds(WideBVHNode<N>& node,
+                                   const std::size_t child,
+                                   const Bounds3f& bounds) noexcept {
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                node.bounds[0][axis][child] = bounds.min[axis];
+                node.bounds[1][axis][child] = bounds.max[axis];
+            }
+        }
+    };
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "pbrt/core/Shape.hpp"
 #include "pbrt/core/transformations/Transformation.hpp"
 #include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+
+#include <bit>
 
 namespace idragnev::pbrt {
     Shape::Shape(const Transformation& objectToWorld,
@@ -18,4 +21,48 @@ namespace idragnev::pbrt {
     bool Shape::intersectP(const Ray& ray, const bool testAlphaTexture) const {
         return intersect(ray, testAlphaTexture).has_value();
     }
+
+    Bounds3f Shape::partWorldBound(const std::uint32_t) const {
+        return worldBound();
+    }
+
+    Optional<HitRecord>
+    Shape::intersectPart(const Ray& ray,
+                         const std::uint32_t,
+                         const bool testAlphaTexture) const {
+        return intersect(ray, testAlphaTexture);
+    }
+
+    bool Shape::intersectPartP(const Ray& ray,
+                               const std::uint32_t,
+                               const bool testAlphaTexture) const {
+        return intersectP(ray, testAlphaTexture);
+    }
+
+    void Shape::intersectPartPacket(const std::span<const Ray> rays,
+                                    const std::uint32_t part,
+                                    const std::uint32_t activeMask,
+                                    const std::span<Optional<HitRecord>> hits,
+                                    const bool testAlphaTexture) const {
+        for (std::uint32_t mask = activeMask; mask != 0; mask &= mask - 1) {
+            const auto i = std::countr_zero(mask);
+            hits[i] = intersectPart(rays[i], part, testAlphaTexture);
+        }
+    }
+
+    std::uint32_t
+    Shape::intersectPartPacketP(const std::span<const Ray> rays,
+                                const std::uint32_t part,
+                                const std::uint32_t activeMask,
+                                const bool testAlphaTexture) const {
+        std::uint32_t result = 0;
+        for (std::uint32_t mask = activeMask; mask != 0; mask &= mask - 1) {
+            const auto i = std::countr_zero(mask);
+            if (intersectPartP(rays[i], part, testAlphaTexture)) {
+                result |= 1u << i;
+            }
+        }
+
+        return result;
+    }
 } // namespace idragnev::pbrt
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "pbrt/core/math/Half.hpp"
+
+namespace idragnev::pbrt::math {
+    std::uint16_t Half::fromFloat(const float f) noexcept {
+        constexpr std::uint32_t f32Infinity = 255u << 23;
+        // the smallest float which overflows a half
+        constexpr std::uint32_t f16Overflow = (127u + 16u) << 23;
+        // adding it shifts the mantissa of a denormal half into place
+        constexpr std::uint32_t denormMagic = ((127u - 15u) + (23u - 10u) + 1u)
+                                              << 23;
+        constexpr std::uint32_t signMask = 0x80000000u;
+
+        std::uint32_t bits = floatToBits(f);
+        const std::uint32_t sign = bits & signMask;
+        bits ^= sign;
+
+        std::uint16_t result = 0;
+        if (bits >= f16Overflow) {
+            // NaNs stay quiet NaNs, the rest become infinities
+            result = bits > f32Infinity ? 0x7e00 : 0x7c00;
+        }
+        else if (bits < (113u << 23)) {
+            // denormal half: let the float adder round the mantissa
+            const float sum = bitsToFloat(bits) + bitsToFloat(denormMagic);
+            result = static_cast<std::uint16_t>(floatToBits(sum) - denormMagic);
+        }
+        else {
+            const std::uint32_t mantissaOdd = (bits >> 13) & 1u;
+            // rebias the exponent and round to nearest even
+            bits += ((15u - 127u) << 23) + 0xfffu;
+            bits += mantissaOdd;
+            result = static_cast<std::uint16_t>(bits >> 13);
+        }
+
+        return static_cast<std::uint16_t>(result | (sign >> 16));
+    }
+
+    float Half::toFloat(const std::uint16_t h) noexcept {
+        constexpr std::uint32_t shiftedExponent = 0x7c00u << 13;
+        constexpr std::uint32_t magic = 113u << 23;
+
+        std::uint32_t bits = (h & 0x7fffu) << 13;
+        const std::uint32_t exponent = shiftedExponent & bits;
+        bits += (127u - 15u) << 23;
+
+        if (exponent == shiftedExponent) { // infinity or NaN
+            bits += (128u - 16u) << 23;
+        }
+        else if (exponent == 0) { // zero or denormal
+            bits += 1u << 23;
+            bits = floatToBits(bitsToFloat(bits) - bitsToFloat(magic));
+        }
+
+        bits |= static_cast<std::uint32_t>(h & 0x8000u) << 16;
+
+        return bitsToFloat(bits);
+    }
+} // namespace idragnev::pbrt::math
\ No newline at end of file
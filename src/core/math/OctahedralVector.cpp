@@ -0,0 +1,58 @@
+#include "pbrt/core/math/OctahedralVector.hpp"
+#include "pbrt/core/math/Vector3.hpp"
+#include "pbrt/core/math/Normal3.hpp"
+
+namespace idragnev::pbrt::math {
+    namespace {
+        Float sign(const Float f) noexcept { return std::copysign(Float(1), f); }
+    } // namespace
+
+    OctahedralVector::OctahedralVector(const Vector3<Float>& v) noexcept {
+        const Float l1Norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (l1Norm == 0) {
+            x = y = encode(0);
+            return;
+        }
+
+        const Vector3<Float> p = v / l1Norm;
+        if (p.z >= 0) {
+            x = encode(p.x);
+            y = encode(p.y);
+        }
+        else {
+            // fold the lower hemisphere over the diagonals
+            x = encode((1 - std::abs(p.y)) * sign(p.x));
+            y = encode((1 - std::abs(p.x)) * sign(p.y));
+        }
+    }
+
+    OctahedralVector::OctahedralVector(const Normal3<Float>& n) noexcept
+        : OctahedralVector(Vector3<Float>(n)) {}
+
+    OctahedralVector::operator Vector3<Float>() const noexcept {
+        Vector3<Float> v;
+        v.x = decode(x);
+        v.y = decode(y);
+        v.z = 1 - (std::abs(v.x) + std::abs(v.y));
+        if (v.z < 0) {
+            const Float xo = v.x;
+            v.x = (1 - std::abs(v.y)) * sign(xo);
+            v.y = (1 - std::abs(xo)) * sign(v.y);
+        }
+
+        return normalize(v);
+    }
+
+    OctahedralVector::operator Normal3<Float>() const noexcept {
+        return Normal3<Float>(static_cast<Vector3<Float>>(*this));
+    }
+
+    std::uint16_t OctahedralVector::encode(const Float f) noexcept {
+        return static_cast<std::uint16_t>(
+            std::round(clamp((f + 1) / 2, 0, 1) * 65535.f));
+    }
+
+    Float OctahedralVector::decode(const std::uint16_t u) noexcept {
+        return -1 + 2 * (static_cast<Float>(u) / 65535.f);
+    }
+} // namespace idragnev::pbrt::math
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "pbrt/core/Material.hpp"
 
 #include <assert.h>
+#include <bit>
 
 namespace idragnev::pbrt {
     GeometricPrimitive::GeometricPrimitive(
@@ -27,7 +28,62 @@ namespace idragnev::pbrt {
 
     Optional<SurfaceInteraction>
     GeometricPrimitive::intersect(const Ray& ray) const {
-        return _shape->intersect(ray).map(
+        return toSurfaceInteraction(ray, _shape->intersect(ray));
+    }
+
+    std::uint32_t GeometricPrimitive::partsCount() const {
+        return _shape->partsCount();
+    }
+
+    Bounds3f
+    GeometricPrimitive::partWorldBound(const std::uint32_t part) const {
+        return _shape->partWorldBound(part);
+    }
+
+    Optional<SurfaceInteraction>
+    GeometricPrimitive::intersectPart(const Ray& ray,
+                                      const std::uint32_t part) const {
+        return toSurfaceInteraction(ray, _shape->intersectPart(ray, part));
+    }
+
+    bool GeometricPrimitive::intersectPartP(const Ray& ray,
+                                            const std::uint32_t part) const {
+        return _shape->intersectPartP(ray, part);
+    }
+
+    void GeometricPrimitive::intersectPartPacket(
+        const std::span<const Ray> rays,
+        const std::uint32_t part,
+        const std::uint32_t activeMask,
+        const std::span<Optional<SurfaceInteraction>> hits) const {
+        assert(rays.size() <= constants::MaxRayPacketSize);
+
+        Optional<HitRecord> shapeHits[constants::MaxRayPacketSize];
+        _shape->intersectPartPacket(rays,
+                                    part,
+                                    activeMask,
+                                    std::span{shapeHits, rays.size()});
+
+        for (std::uint32_t mask = activeMask; mask != 0; mask &= mask - 1) {
+            const auto i = std::countr_zero(mask);
+            if (shapeHits[i].has_value()) {
+                hits[i] =
+                    toSurfaceInteraction(rays[i], std::move(shapeHits[i]));
+            }
+        }
+    }
+
+    std::uint32_t GeometricPrimitive::intersectPartPacketP(
+        const std::span<const Ray> rays,
+        const std::uint32_t part,
+        const std::uint32_t activeMask) const {
+        return _shape->intersectPartPacketP(rays, part, activeMask);
+    }
+
+    Optional<SurfaceInteraction>
+    GeometricPrimitive::toSurfaceInteraction(const Ray& ray,
+                                             Optional<HitRecord>&& hit) const {
+        return std::move(hit).map(
             [&ray, this](HitRecord&& hitRecord) -> SurfaceInteraction {
                 ray.tMax = hitRecord.t;
 
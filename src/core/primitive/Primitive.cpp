@@ -1,8 +1,53 @@
 #include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
 
 #include <assert.h>
+#include <bit>
 
 namespace idragnev::pbrt {
+    Bounds3f Primitive::partWorldBound(const std::uint32_t) const {
+        return worldBound();
+    }
+
+    Optional<SurfaceInteraction>
+    Primitive::intersectPart(const Ray& r, const std::uint32_t) const {
+        return intersect(r);
+    }
+
+    bool Primitive::intersectPartP(const Ray& r, const std::uint32_t) const {
+        return intersectP(r);
+    }
+
+    void Primitive::intersectPartPacket(
+        const std::span<const Ray> rays,
+        const std::uint32_t part,
+        const std::uint32_t activeMask,
+        const std::span<Optional<SurfaceInteraction>> hits) const {
+        for (std::uint32_t mask = activeMask; mask != 0; mask &= mask - 1) {
+            const auto i = std::countr_zero(mask);
+            if (auto hit = intersectPart(rays[i], part); hit.has_value()) {
+                hits[i] = std::move(hit);
+            }
+        }
+    }
+
+    std::uint32_t
+    Primitive::intersectPartPacketP(const std::span<const Ray> rays,
+                                    const std::uint32_t part,
+                                    const std::uint32_t activeMask) const {
+        std::uint32_t result = 0;
+        for (std::uint32_t mask = activeMask; mask != 0; mask &= mask - 1) {
+            const auto i = std::countr_zero(mask);
+            if (intersectPartP(rays[i], part)) {
+                result |= 1u << i;
+            }
+        }
+
+        return result;
+    }
+
     const AreaLight* Aggregate::areaLight() const {
         assert(false);
         return nullptr;
@@ -16,7 +16,7 @@ namespace idragnev::pbrt {
 
     void GlobalSampler::Generate1DSamplesArray() {
         for (std::size_t i = 0; i < _1DSamplesArray.size(); ++i) {
-            std::vector<Float>& samples = _1DSamplesArray[i];
+            SamplesArray<Float>& samples = _1DSamplesArray[i];
             const auto samplesCount = samples.size();
 
             for (std::size_t j = 0; j < samplesCount; ++j) {
@@ -32,7 +32,7 @@ namespace idragnev::pbrt {
         std::size_t dim = SAMPLES_ARRAY_START_DIM + _1DSamplesArraysSizes.size();
 
         for (std::size_t i = 0; i < _2DSamplesArray.size(); ++i) {
-            std::vector<Point2f>& samples = _2DSamplesArray[i];
+            SamplesArray<Point2f>& samples = _2DSamplesArray[i];
             const auto samplesCount = samples.size();
 
             for (std::size_t j = 0; j < samplesCount; ++j) {
@@ -5,9 +5,9 @@ namespace idragnev::pbrt {
                                const std::size_t precomputedDimsCount)
         : Sampler(samplesPerPixel)
         , precomputed1DSamplesArray(precomputedDimsCount,
-                                    std::vector<Float>(samplesPerPixel))
+                                    SamplesArray<Float>(samplesPerPixel))
         , precomputed2DSamplesArray(precomputedDimsCount,
-                                    std::vector<Point2f>(samplesPerPixel)) {}
+                                    SamplesArray<Point2f>(samplesPerPixel)) {}
 
     Float PixelSampler::generate1DSample() {
         assert(currentPixelSampleIndex < samplesPerPixel);
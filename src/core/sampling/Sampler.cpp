@@ -40,14 +40,15 @@ namespace idragnev::pbrt {
         assert(roundSamplesCount(size) == size);
 
         _1DSamplesArraysSizes.push_back(size);
-        _1DSamplesArray.push_back(std::vector<Float>(size * samplesPerPixel));
+        _1DSamplesArray.push_back(SamplesArray<Float>(size * samplesPerPixel));
     }
 
     void Sampler::request2DSamplesArray(const std::size_t size) {
         assert(roundSamplesCount(size) == size);
 
         _2DSamplesArraysSizes.push_back(size);
-        _2DSamplesArray.push_back(std::vector<Point2f>(size * samplesPerPixel));
+        _2DSamplesArray.push_back(
+            SamplesArray<Point2f>(size * samplesPerPixel));
     }
 
     Optional<std::span<const Float>>
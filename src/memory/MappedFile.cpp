@@ -0,0 +1,96 @@
+#include "pbrt/memory/MappedFile.hpp"
+#include "pbrt/memory/Memory.hpp"
+
+#include <fstream>
+#include <utility>
+
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>) && \
+    __has_include(<unistd.h>)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #define PBRT_HAS_MMAP_FILES
+#endif
+
+namespace idragnev::pbrt::memory {
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef PBRT_HAS_MMAP_FILES
+        if (const int fd = ::open(path.c_str(), O_RDONLY); fd != -1) {
+            struct stat info;
+            if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+                const auto size = static_cast<std::size_t>(info.st_size);
+                if (void* const ptr =
+                        mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                    ptr != MAP_FAILED) {
+                    _data = static_cast<const std::byte*>(ptr);
+                    _size = size;
+                    isMapped = true;
+                }
+            }
+            // the mapping keeps the file open
+            ::close(fd);
+        }
+
+        if (isMapped) {
+            return;
+        }
+#endif
+        std::error_code error;
+        const auto size = std::filesystem::file_size(path, error);
+        if (error || size == 0) {
+            return;
+        }
+
+        std::ifstream file{path, std::ios::binary};
+        auto* const buffer = static_cast<std::byte*>(allocCacheAligned(size));
+        if (buffer != nullptr &&
+            file.read(reinterpret_cast<char*>(buffer),
+                      static_cast<std::streamsize>(size))) {
+            _data = buffer;
+            _size = size;
+        }
+        else {
+            freeAligned(buffer);
+        }
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept { swap(other); }
+
+    MappedFile::~MappedFile() { close(); }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            MappedFile temp{std::move(other)};
+            swap(temp);
+        }
+
+        return *this;
+    }
+
+    void MappedFile::swap(MappedFile& other) noexcept {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(isMapped, other.isMapped);
+    }
+
+    void MappedFile::close() noexcept {
+        if (_data == nullptr) {
+            return;
+        }
+
+#ifdef PBRT_HAS_MMAP_FILES
+        if (isMapped) {
+            munmap(const_cast<std::byte*>(_data), _size);
+        }
+        else
+#endif
+        {
+            freeAligned(const_cast<std::byte*>(_data));
+        }
+
+        _data = nullptr;
+        _size = 0;
+        isMapped = false;
+    }
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
@@ -4,6 +4,11 @@
     #include <stdlib.h>
 #endif
 
+#if defined(__linux__) && __has_include(<sys/mman.h>)
+    #include <sys/mman.h>
+    #define PBRT_HAS_MMAP
+#endif
+
 namespace idragnev::pbrt::memory {
     static_assert(isPowerOfTwo(alignof(std::max_align_t)),
                   "Strictest machine alignment is not a power of two");
@@ -43,4 +48,103 @@ namespace idragnev::pbrt::memory {
         free(ptr);
 #endif
     }
+
+#ifdef PBRT_HAS_MMAP
+    namespace {
+        bool usesHugePages(const std::size_t size, const PageSize pageSize) {
+            return pageSize == PageSize::Huge &&
+                   size >= constants::HUGE_PAGE_SIZE;
+        }
+
+        // Tries the reserved huge pages first (MAP_HUGETLB). If there are
+        // none, maps regular pages at a 2 MB boundary and asks the kernel
+        // to back them with transparent huge pages. If that is not
+        // supported either, the memory stays backed by regular pages.
+        void* mapHugePages(const std::size_t size) {
+            using constants::HUGE_PAGE_SIZE;
+
+    #ifdef MAP_HUGETLB
+            if (void* const ptr = mmap(nullptr,
+                                       size,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                                       -1,
+                                       0);
+                ptr != MAP_FAILED) {
+                return ptr;
+            }
+    #endif
+
+            // over-allocate so the mapping can be trimmed to a 2 MB boundary
+            const std::size_t mappedSize = size + HUGE_PAGE_SIZE;
+            void* const mapped = mmap(nullptr,
+                                      mappedSize,
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS,
+                                      -1,
+                                      0);
+            if (mapped == MAP_FAILED) {
+                return nullptr;
+            }
+
+            auto* const begin = static_cast<std::uint8_t*>(mapped);
+            auto* const aligned = reinterpret_cast<std::uint8_t*>(
+                alignUp(reinterpret_cast<std::uintptr_t>(begin), HUGE_PAGE_SIZE));
+            if (const auto head = static_cast<std::size_t>(aligned - begin);
+                head > 0) {
+                munmap(begin, head);
+            }
+            if (const auto tail =
+                    static_cast<std::size_t>(begin + mappedSize - (aligned + size));
+                tail > 0) {
+                munmap(aligned + size, tail);
+            }
+
+    #ifdef MADV_HUGEPAGE
+            madvise(aligned, size, MADV_HUGEPAGE);
+    #endif
+
+            return aligned;
+        }
+    } // namespace
+#endif
+
+    void* allocCacheAligned(const std::size_t size,
+                            [[maybe_unused]] const PageSize pageSize,
+                            const MemoryTag tag) {
+        void* result = nullptr;
+#ifdef PBRT_HAS_MMAP
+        if (usesHugePages(size, pageSize)) {
+            result = mapHugePages(alignUp(size, constants::HUGE_PAGE_SIZE));
+        }
+        else
+#endif
+        {
+            result = allocCacheAligned(size);
+        }
+
+        if (result != nullptr) {
+            recordAllocation(tag, size);
+        }
+
+        return result;
+    }
+
+    void freeAligned(void* ptr,
+                     const std::size_t size,
+                     [[maybe_unused]] const PageSize pageSize,
+                     const MemoryTag tag) {
+        if (ptr == nullptr) {
+            return;
+        }
+
+        recordDeallocation(tag, size);
+#ifdef PBRT_HAS_MMAP
+        if (usesHugePages(size, pageSize)) {
+            munmap(ptr, alignUp(size, constants::HUGE_PAGE_SIZE));
+            return;
+        }
+#endif
+        freeAligned(ptr);
+    }
 } // namespace idragnev::pbrt::memory
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "pbrt/memory/MemoryAccounting.hpp"
+#include "pbrt/memory/Memory.hpp"
+
+#include <atomic>
+#include <assert.h>
+
+namespace idragnev::pbrt::memory {
+    namespace {
+#ifdef _MSC_VER
+    #pragma warning(push)
+    #pragma warning(disable : 4324) // structure padding due to alignment specifier
+#endif
+        // Each tag is in a separate cache line, so subsystems allocating
+        // from different threads do not slow each other down
+        struct alignas(constants::L1_CACHE_LINE_SIZE) TagCounters
+        {
+            std::atomic<std::size_t> liveBytes = 0;
+            std::atomic<std::size_t> peakBytes = 0;
+        };
+#ifdef _MSC_VER
+    #pragma warning(pop)
+#endif
+
+        constexpr auto TAGS_COUNT = static_cast<std::size_t>(MemoryTag::Count);
+
+        TagCounters counters[TAGS_COUNT];
+
+        TagCounters& countersOf(const MemoryTag tag) noexcept {
+            const auto index = static_cast<std::size_t>(tag);
+            assert(index < TAGS_COUNT);
+
+            return counters[index];
+        }
+    } // namespace
+
+    void recordAllocation(const MemoryTag tag, const std::size_t bytes) noexcept {
+        TagCounters& tagCounters = countersOf(tag);
+
+        const auto liveBytes =
+            tagCounters.liveBytes.fetch_add(bytes, std::memory_order_relaxed) +
+            bytes;
+
+        auto peakBytes = tagCounters.peakBytes.load(std::memory_order_relaxed);
+        while (peakBytes < liveBytes &&
+               !tagCounters.peakBytes.compare_exchange_weak(
+                   peakBytes,
+                   liveBytes,
+                   std::memory_order_relaxed)) {
+        }
+    }
+
+    void recordDeallocation(const MemoryTag tag,
+                            const std::size_t bytes) noexcept {
+        countersOf(tag).liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    MemoryUsage memoryUsage(const MemoryTag tag) noexcept {
+        const TagCounters& tagCounters = countersOf(tag);
+
+        MemoryUsage result;
+        result.liveBytes = tagCounters.liveBytes.load(std::memory_order_relaxed);
+        result.peakBytes = tagCounters.peakBytes.load(std::memory_order_relaxed);
+
+        return result;
+    }
+
+    const char* toString(const MemoryTag tag) noexcept {
+        switch (tag) {
+            case MemoryTag::BVHNodes: return "BVH nodes";
+            case MemoryTag::MeshVertices: return "Mesh vertices";
+            case MemoryTag::MeshIndices: return "Mesh indices";
+            case MemoryTag::Textures: return "Textures";
+            case MemoryTag::Volumes: return "Volumes";
+            case MemoryTag::Arenas: return "Arenas";
+            case MemoryTag::Samplers: return "Samplers";
+            case MemoryTag::Other: return "Other";
+            case MemoryTag::Count: break;
+        }
+
+        return "Unknown";
+    }
+
+    void printMemoryUsage(std::FILE* const out) {
+        constexpr double MB = 1024.0 * 1024.0;
+
+        std::fprintf(out, "%-16s %14s %14s\n", "Memory", "Live MB", "Peak MB");
+        for (std::size_t i = 0; i < TAGS_COUNT; ++i) {
+            const auto tag = static_cast<MemoryTag>(i);
+            const MemoryUsage usage = memoryUsage(tag);
+
+            std::fprintf(out,
+                         "%-16s %14.2f %14.2f\n",
+                         toString(tag),
+                         static_cast<double>(usage.liveBytes) / MB,
+                         static_cast<double>(usage.peakBytes) / MB);
+        }
+    }
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
@@ -1,16 +1,31 @@
 #include "pbrt/memory/MemoryArena.hpp"
 
 #include <algorithm>
+#include <assert.h>
 
 namespace idragnev::pbrt::memory {
     MemoryArena::~MemoryArena() {
-        freeAligned(currentBlock.startAddress);
-        for (auto& block : usedBlocks) {
-            freeAligned(block.startAddress);
+        if (currentBlock != nullptr) {
+            usedBlocks.pushBack(currentBlock);
         }
-        for (auto& block : availableBlocks) {
-            freeAligned(block.startAddress);
+        availableBlocks.prepend(usedBlocks);
+
+        if (pool == nullptr) {
+            availableBlocks.freeAll();
+            return;
+        }
+
+        // Oversized blocks do not fit the pool and are freed
+        detail::MemoryBlockList pooledBlocks;
+        while (detail::MemoryBlock* const block = availableBlocks.popFront()) {
+            if (block->allocationSize() == pool->blockSize()) {
+                pooledBlocks.pushBack(block);
+            }
+            else {
+                detail::MemoryBlock::free(block);
+            }
         }
+        pool->release(pooledBlocks);
     }
 
     // Guarantees that the allocated memory meets the strictest
@@ -22,52 +37,113 @@ namespace idragnev::pbrt::memory {
     void* MemoryArena::alloc(const std::size_t nBytes) {
         const auto allocSize = toMultipleOfStrictestAlign(nBytes);
 
-        if (currentBlock.usedBytes + allocSize > currentBlock.size) {
-            if (currentBlock.startAddress != nullptr) {
-                usedBlocks.push_back(currentBlock);
-                currentBlock = {};
+        if (currentBlock == nullptr ||
+            currentBlockUsedBytes + allocSize > currentBlock->size) {
+            if (currentBlock != nullptr) {
+                usedBlocks.pushBack(currentBlock);
             }
 
-            const auto it = std::find_if(
-                availableBlocks.cbegin(),
-                availableBlocks.cend(),
-                [allocSize](const Block& b) { return b.size >= allocSize; });
-            if (it != availableBlocks.cend()) {
-                currentBlock.startAddress = it->startAddress;
-                currentBlock.size = it->size;
-                availableBlocks.erase(it);
-            }
+            currentBlock = nextBlock(allocSize);
+            currentBlockUsedBytes = 0;
+        }
 
-            if (currentBlock.startAddress == nullptr) {
-                const auto size = std::max(allocSize, blockSize);
-                currentBlock.startAddress =
-                    allocCacheAligned<std::uint8_t>(size);
-                currentBlock.size = size;
-            }
+        void* memory = currentBlock->memory() + currentBlockUsedBytes;
+        currentBlockUsedBytes += allocSize;
 
-            currentBlock.usedBytes = 0;
+        return memory;
+    }
+
+    // alloc() aligns to alignof(std::max_align_t), so stricter
+    // alignments are met by over-allocating
+    void* MemoryArena::do_allocate(const std::size_t bytes,
+                                   const std::size_t alignment) {
+        constexpr std::size_t STRICTEST_ALIGN = alignof(std::max_align_t);
+        if (alignment <= STRICTEST_ALIGN) {
+            return alloc(bytes);
+        }
+
+        const auto address = reinterpret_cast<std::uintptr_t>(
+            alloc(bytes + alignment - STRICTEST_ALIGN));
+        return reinterpret_cast<void*>(alignUp(address, alignment));
+    }
+
+    // Only the first available block is checked, so an allocation bigger
+    // than the block size may allocate a new block even though a big
+    // enough block is available further in the list.
+    detail::MemoryBlock* MemoryArena::nextBlock(const std::size_t allocSize) {
+        if (const auto* const first = availableBlocks.front();
+            first != nullptr && first->size >= allocSize) {
+            return availableBlocks.popFront();
         }
 
-        void* memory = currentBlock.startAddress + currentBlock.usedBytes;
-        currentBlock.usedBytes += allocSize;
+        const auto allocationSize = allocSize + sizeof(detail::MemoryBlock);
+        detail::MemoryBlock* const block =
+            pool != nullptr && allocationSize <= blockSize
+                ? pool->acquire()
+                : detail::MemoryBlock::allocate(
+                      std::max(allocationSize, blockSize), pageSize);
+        allocatedBytes += block->allocationSize();
 
-        return memory;
+        return block;
     }
 
+    // The blocks are made available in the order they were used in,
+    // so repeating the same allocations reuses them without growing
     void MemoryArena::reset() {
-        currentBlock.usedBytes = 0;
-        availableBlocks.splice(availableBlocks.begin(), std::move(usedBlocks));
+        if (currentBlock != nullptr) {
+            usedBlocks.pushBack(currentBlock);
+            currentBlock = nullptr;
+        }
+        currentBlockUsedBytes = 0;
+        availableBlocks.prepend(usedBlocks);
     }
 
-    std::size_t MemoryArena::totalAllocationSize() const noexcept {
-        std::size_t total = currentBlock.size;
-        for (const auto& block : usedBlocks) {
-            total += block.size;
+    MemoryArena::Checkpoint MemoryArena::mark() const noexcept {
+        Checkpoint checkpoint;
+        checkpoint.block = currentBlock;
+        checkpoint.usedBytes = currentBlockUsedBytes;
+        checkpoint.lastUsedBlock = usedBlocks.back();
+
+        return checkpoint;
+    }
+
+    // The blocks used after the checkpoint follow its last used block,
+    // starting with the checkpoint's block which becomes current again
+    void MemoryArena::rollback(const Checkpoint& checkpoint) noexcept {
+        if (currentBlock != checkpoint.block) {
+            detail::MemoryBlockList blocksSinceCheckpoint =
+                usedBlocks.splitAfter(checkpoint.lastUsedBlock);
+            blocksSinceCheckpoint.pushBack(currentBlock);
+            if (checkpoint.block != nullptr) {
+                [[maybe_unused]] const auto* const block =
+                    blocksSinceCheckpoint.popFront();
+                assert(block == checkpoint.block);
+            }
+
+            availableBlocks.prepend(blocksSinceCheckpoint);
+            currentBlock = checkpoint.block;
         }
-        for (const auto& block : availableBlocks) {
-            total += block.size;
+
+        currentBlockUsedBytes = checkpoint.usedBytes;
+    }
+
+    std::size_t MemoryArena::totalAllocationSize() const noexcept {
+        return allocatedBytes;
+    }
+
+    MemoryArenaPool::MemoryArenaPool(const std::size_t arenasCount,
+                                     const std::size_t blockSize,
+                                     const PageSize pageSize)
+        : blocks(blockSize, pageSize) {
+        arenas.reserve(arenasCount);
+        for (std::size_t i = 0; i < arenasCount; ++i) {
+            arenas.push_back(std::make_unique<MemoryArena>(blocks));
         }
+    }
 
-        return total;
+    void MemoryArenaPool::resetAll() {
+        for (auto& arena : arenas) {
+            arena->reset();
+        }
     }
 } // namespace idragnev::pbrt::memory
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "pbrt/memory/MemoryBlockPool.hpp"
+
+#include <new>
+#include <utility>
+#include <assert.h>
+
+namespace idragnev::pbrt::memory {
+    namespace detail {
+        MemoryBlock* MemoryBlock::allocate(const std::size_t allocationSize,
+                                           const PageSize pageSize) {
+            assert(allocationSize >= sizeof(MemoryBlock));
+
+            void* const memory =
+                allocCacheAligned(allocationSize, pageSize, MemoryTag::Arenas);
+            auto* const block = new (memory) MemoryBlock{};
+            block->size = allocationSize - sizeof(MemoryBlock);
+            block->pageSize = pageSize;
+
+            return block;
+        }
+
+        void MemoryBlock::free(MemoryBlock* const block) {
+            const auto allocationSize = block->allocationSize();
+            const auto pageSize = block->pageSize;
+
+            block->~MemoryBlock();
+            freeAligned(static_cast<void*>(block),
+                        allocationSize,
+                        pageSize,
+                        MemoryTag::Arenas);
+        }
+
+        void MemoryBlockList::pushBack(MemoryBlock* const block) noexcept {
+            block->next.store(nullptr, std::memory_order_relaxed);
+            if (tail == nullptr) {
+                head = block;
+            }
+            else {
+                tail->next.store(block, std::memory_order_relaxed);
+            }
+            tail = block;
+        }
+
+        MemoryBlock* MemoryBlockList::popFront() noexcept {
+            MemoryBlock* const block = head;
+            if (block != nullptr) {
+                head = block->next.load(std::memory_order_relaxed);
+                if (head == nullptr) {
+                    tail = nullptr;
+                }
+                block->next.store(nullptr, std::memory_order_relaxed);
+            }
+
+            return block;
+        }
+
+        void MemoryBlockList::prepend(MemoryBlockList& other) noexcept {
+            if (other.isEmpty()) {
+                return;
+            }
+
+            other.tail->next.store(head, std::memory_order_relaxed);
+            if (tail == nullptr) {
+                tail = other.tail;
+            }
+            head = other.head;
+
+            other.head = other.tail = nullptr;
+        }
+
+        MemoryBlockList
+        MemoryBlockList::splitAfter(MemoryBlock* const block) noexcept {
+            MemoryBlockList result;
+            if (block == nullptr) {
+                std::swap(result, *this);
+                return result;
+            }
+
+            result.head = block->next.load(std::memory_order_relaxed);
+            if (result.head != nullptr) {
+                result.tail = tail;
+                block->next.store(nullptr, std::memory_order_relaxed);
+                tail = block;
+            }
+
+            return result;
+        }
+
+        void MemoryBlockList::freeAll() noexcept {
+            while (MemoryBlock* const block = popFront()) {
+                MemoryBlock::free(block);
+            }
+        }
+    } // namespace detail
+
+    MemoryBlockPool::~MemoryBlockPool() {
+        auto* block = pointerOf(head.load(std::memory_order_acquire));
+        while (block != nullptr) {
+            auto* const next = block->next.load(std::memory_order_relaxed);
+            detail::MemoryBlock::free(block);
+            block = next;
+        }
+    }
+
+    detail::MemoryBlock* MemoryBlockPool::acquire() {
+        auto top = head.load(std::memory_order_acquire);
+        while (true) {
+            detail::MemoryBlock* const block = pointerOf(top);
+            if (block == nullptr) {
+                return detail::MemoryBlock::allocate(_blockSize, _pageSize);
+            }
+
+            // The free blocks are never deallocated while the pool lives,
+            // so reading `next` is safe even if the block was popped by
+            // another thread - the tag makes the exchange fail then.
+            const auto next = tagged(block->next.load(std::memory_order_relaxed),
+                                     top);
+            if (head.compare_exchange_weak(top,
+                                           next,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+                block->next.store(nullptr, std::memory_order_relaxed);
+                return block;
+            }
+        }
+    }
+
+    void MemoryBlockPool::release(detail::MemoryBlockList& blocks) {
+        if (blocks.isEmpty()) {
+            return;
+        }
+
+        detail::MemoryBlock* const first = blocks.front();
+        detail::MemoryBlock* const last = blocks.back();
+
+        auto top = head.load(std::memory_order_relaxed);
+        do {
+            last->next.store(pointerOf(top), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(top,
+                                             tagged(first, top),
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+
+        blocks = {};
+    }
+
+    std::uint64_t
+    MemoryBlockPool::tagged(detail::MemoryBlock* const block,
+                            const std::uint64_t previousHead) noexcept {
+        const auto address = reinterpret_cast<std::uintptr_t>(block);
+        assert((address & ~POINTER_MASK) == 0);
+
+        const std::uint64_t tag = (previousHead >> TAG_SHIFT) + 1;
+        return (tag << TAG_SHIFT) | static_cast<std::uint64_t>(address);
+    }
+
+    detail::MemoryBlock*
+    MemoryBlockPool::pointerOf(const std::uint64_t head) noexcept {
+        return reinterpret_cast<detail::MemoryBlock*>(
+            static_cast<std::uintptr_t>(head & POINTER_MASK));
+    }
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
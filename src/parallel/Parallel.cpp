@@ -1,39 +1,62 @@
 #include "pbrt/parallel/Parallel.hpp"
 #include "pbrt/functional/Functional.hpp"
+#include "Schedulers.hpp"
+#include "ThreadAffinity.hpp"
+#include "SpinWait.hpp"
 
 #include <thread>
 #include <assert.h>
 
 namespace idragnev::pbrt::parallel {
-    Barrier::Barrier(const int threadsCount) : threadsNotReached(threadsCount) {
-        assert(threadsNotReached > 0);
+    Barrier::Barrier(const int threadsCount)
+        : threadsNotReached(threadsCount)
+        , threadsInside(threadsCount) {
+        assert(threadsCount > 0);
     }
 
-    Barrier::~Barrier() { assert(threadsNotReached == 0); }
+    Barrier::~Barrier() {
+        assert(threadsNotReached.load() == 0);
 
-    void Barrier::wait() {
-        auto lock = std::unique_lock{mutex};
-        assert(threadsNotReached > 0);
+        // the last thread to arrive may still be notifying the others
+        while (threadsInside.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+    }
 
-        threadsNotReached -= 1;
-        if (threadsNotReached == 0) {
+    void Barrier::wait() {
+        const auto isReleased = [this] {
+            return threadsNotReached.load(std::memory_order_acquire) == 0;
+        };
+
+        const int notReached =
+            threadsNotReached.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        assert(notReached >= 0);
+
+        if (notReached == 0) {
+            // Taking the mutex ensures that each blocked thread either saw
+            // the release before blocking or is already waiting for the
+            // notification.
+            {
+                const auto lock = std::lock_guard{mutex};
+            }
             cv.notify_all();
         }
-        else {
-            cv.wait(lock, [this] { return threadsNotReached == 0; });
+        else if (!spinUntil(isReleased)) {
+            auto lock = std::unique_lock{mutex};
+            cv.wait(lock, isReleased);
         }
-    }
 
-    class ParallelForLoop;
-    struct IterationsChunk;
+        // (!) This must be the last access to the barrier. (!)
+        threadsInside.fetch_sub(1, std::memory_order_release);
+    }
 
     namespace statics {
-        static ParallelForLoop* workListHead = nullptr;
-        static std::mutex workListMutex;
-        static std::condition_variable workListCondVar;
-
+        static std::unique_ptr<LoopScheduler> scheduler;
         static std::vector<std::thread> threads;
-        static bool shutdownThreads = false;
+        static int threadsCount = 1;
+        // the CPUs the thread which called init() was allowed
+        // to run on before it was pinned
+        static std::vector<int> initialCpus;
 
         thread_local int thisThreadIndex;
     } // namespace statics
@@ -41,216 +64,225 @@ namespace idragnev::pbrt::parallel {
     int numberOfSystemCores() noexcept;
     int maxThreadIndex() noexcept;
 
-    void workerThread(const int threadIndex);
-    void executeChunk(std::unique_lock<std::mutex>& lock,
-                      ParallelForLoop& loop,
-                      const IterationsChunk& chunk);
-
-    // an exclusive range of loop iterations: [first, last)
-    struct IterationsChunk
-    {
-        std::int64_t first = 0;
-        std::int64_t last = 0;
-    };
-
-    class ParallelForLoop
-    {
-    public:
-        ParallelForLoop(std::function<void(std::int64_t)> f,
-                        const std::int64_t lastIteration,
-                        const std::int64_t chunkSize)
-            : lastIteration(lastIteration)
-            , chunkSize(chunkSize)
-            , func1D(std::move(f)) {}
-
-        ParallelForLoop(std::function<void(std::int64_t, std::int64_t)> f,
-                        const std::int64_t nX,
-                        const std::int64_t nY)
-            : lastIteration(nX * nY)
-            , nX(nX)
-            , func2D(std::move(f)) {}
-
-        bool isFinished() const {
-            return hasNoIterationsLeft() && activeWorkers == 0;
-        }
-
-        bool hasNoIterationsLeft() const noexcept {
-            return nextIteration >= lastIteration;
-        }
+    std::unique_ptr<LoopScheduler> makeScheduler(const Scheduler s,
+                                                 const int threadsCount);
+    void workerThread(const int threadIndex, const int cpu);
 
-        IterationsChunk extractNextChunk() {
-            const auto first = nextIteration;
-            const auto last = std::min(first + chunkSize, lastIteration);
+    int threadsCount() noexcept { return statics::threadsCount; }
+    int thisThreadIndex() noexcept { return statics::thisThreadIndex; }
+    int thisThreadNumaNode() noexcept { return currentNumaNode(); }
 
-            nextIteration = last;
+    void init(const Scheduler s) {
+        ThreadPoolOptions options;
+        options.scheduler = s;
 
-            return {first, last};
-        }
+        init(options);
+    }
 
-    public:
-        ParallelForLoop* next = nullptr;
-        std::int64_t lastIteration = 0;
-        std::int64_t nextIteration = 0;
-        std::int64_t chunkSize = 1;
-        std::int64_t nX = -1;
-        int activeWorkers = 0;
-        std::function<void(std::int64_t)> func1D;
-        std::function<void(std::int64_t, std::int64_t)> func2D;
-    };
-
-    void init() {
+    void init(const ThreadPoolOptions& options) {
         assert(statics::threads.empty());
+        assert(options.threadsCount >= 0);
 
         using functional::IntegerRange;
 
+        const int threadsCount = options.threadsCount > 0
+                                     ? options.threadsCount
+                                     : maxThreadIndex() + 1;
+        const std::vector<int> cpus = cpusForThreads(options, threadsCount);
+
         statics::thisThreadIndex = 0;
-        const auto threadsCount = maxThreadIndex();
+        if (!cpus.empty()) {
+            statics::initialCpus = thisThreadAllowedCpus();
+            pinThisThread({cpus[0]});
+        }
 
+        statics::threadsCount = threadsCount;
+        statics::scheduler = makeScheduler(options.scheduler, threadsCount);
         statics::threads = functional::fmap<std::vector>(
-            IntegerRange{0, threadsCount},
-            [](const int i) {
-                return std::thread{workerThread, i + 1};
+            IntegerRange{1, threadsCount},
+            [&cpus](const int i) {
+                const int cpu = cpus.empty() ? -1 : cpus[static_cast<std::size_t>(i)];
+                return std::thread{workerThread, i, cpu};
             });
     }
 
+    std::unique_ptr<LoopScheduler> makeScheduler(const Scheduler s,
+                                                 const int threadsCount) {
+        switch (s) {
+            case Scheduler::WorkList:
+                return std::make_unique<WorkListScheduler>(threadsCount);
+            case Scheduler::WorkStealing:
+            default:
+                return std::make_unique<WorkStealingScheduler>(threadsCount);
+        }
+    }
+
     void cleanup() {
-        using statics::threads, statics::shutdownThreads;
-        using statics::workListCondVar, statics::workListMutex;
+        using statics::threads, statics::scheduler;
 
-        if (threads.empty()) {
+        if (!scheduler) {
             return;
         }
 
-        {
-            auto lock = std::lock_guard{workListMutex};
-            shutdownThreads = true;
-            workListCondVar.notify_all();
-        }
+        scheduler->requestStop();
 
         for (std::thread& t : threads) {
             t.join();
         }
 
         threads.clear();
-        shutdownThreads = false;
-    }
+        scheduler.reset();
+        statics::threadsCount = 1;
 
-    void parallelFor(ParallelForLoop& loop);
+        if (!statics::initialCpus.empty()) {
+            pinThisThread(statics::initialCpus);
+            statics::initialCpus.clear();
+        }
+    }
 
-    void parallelFor(std::function<void(std::int64_t)> func,
-                     const std::int64_t iterationsCount,
-                     const std::int64_t chunkSize) {
+    void detail::parallelFor(const RangeFunctionRef func,
+                             const std::int64_t iterationsCount,
+                             const Chunking chunking) {
         using statics::threads;
 
-        assert(threads.size() > 0 || maxThreadIndex() == 1);
-
-        if (iterationsCount > chunkSize && threads.size() > 0) {
-            ParallelForLoop loop(std::move(func), iterationsCount, chunkSize);
-            parallelFor(loop);
+        // without a pool, e.g. before init(), the loop runs serially
+        if (iterationsCount > chunking.minSize() && threads.size() > 0) {
+            ParallelForLoop loop(func, iterationsCount, chunking);
+            statics::scheduler->run(loop);
         }
         else {
-            for (std::int64_t i = 0; i < iterationsCount; ++i) {
-                func(i);
+            for (std::int64_t i = 0; i < iterationsCount;) {
+                const auto chunkSize = chunking.nextChunkSize(iterationsCount - i, 1);
+                const auto last = std::min(i + chunkSize, iterationsCount);
+                func(i, last);
+                i = last;
             }
         }
     }
 
-    void parallelFor2D(std::function<void(std::int64_t, std::int64_t)> func,
-                       const std::int64_t nX,
-                       const std::int64_t nY) {
-        using statics::threads;
-
-        assert(threads.size() > 0 || maxThreadIndex() == 1);
-
-        if (const auto tilesCount = nX * nY;
-            tilesCount > 1 && threads.size() > 0) {
-            ParallelForLoop loop(std::move(func), nX, nY);
-            parallelFor(loop);
-        }
-        else {
-            for (std::int64_t y = 0; y < nY; ++y) {
-                for (std::int64_t x = 0; x < nX; ++x) {
-                    func(x, y);
-                }
+    void parallelFor(std::function<void(std::int64_t)> func,
+                     const std::int64_t iterationsCount,
+                     const Chunking chunking) {
+        auto rangeFunc = [&func](const std::int64_t first,
+                                 const std::int64_t last) {
+            for (auto i = first; i < last; ++i) {
+                func(i);
             }
-        }
+        };
+
+        detail::parallelFor(rangeFunc, iterationsCount, chunking);
     }
 
-    void parallelFor(ParallelForLoop& loop) {
-        using statics::workListHead;
-        using statics::workListMutex, statics::workListCondVar;
+    void parallelFor2D(std::function<void(std::int64_t, std::int64_t)> func,
+                       const std::int64_t nX,
+                       const std::int64_t nY,
+                       const TileScheduling& scheduling) {
+        parallelFor2D<decltype(func)&>(func, nX, nY, scheduling);
+    }
 
-        {
-            const auto lock = std::lock_guard(workListMutex);
-            loop.next = workListHead;
-            workListHead = &loop;
-        }
+    void parallelFor(std::function<void(std::int64_t)> func,
+                     const std::int64_t iterationsCount,
+                     const Chunking chunking,
+                     const LoopControl& control) {
+        auto rangeFunc = [&func](const std::int64_t first,
+                                 const std::int64_t last) {
+            for (auto i = first; i < last; ++i) {
+                func(i);
+            }
+        };
 
-        auto lock = std::unique_lock(workListMutex);
-        workListCondVar.notify_all();
+        parallelFor(rangeFunc, iterationsCount, chunking, control);
+    }
 
-        while (!loop.isFinished()) {
-            const auto chunk = loop.extractNextChunk();
+    void parallelFor2D(std::function<void(std::int64_t, std::int64_t)> func,
+                       const std::int64_t nX,
+                       const std::int64_t nY,
+                       const TileScheduling& scheduling,
+                       const LoopControl& control) {
+        parallelFor2D<decltype(func)&>(func, nX, nY, scheduling, control);
+    }
 
-            if (loop.hasNoIterationsLeft()) {
-                workListHead = loop.next;
+    detail::ProgressReporter::ProgressReporter(
+        const LoopControl& control,
+        const std::int64_t totalIterations)
+        : onProgress(control.onProgress)
+        , totalIterations(totalIterations)
+        , interval(control.progressInterval)
+        , start(Clock::now())
+        , nextReportTicks((start + interval).time_since_epoch().count()) {}
+
+    void detail::ProgressReporter::add(const std::int64_t iterations) {
+        completedIterations.fetch_add(iterations, std::memory_order_relaxed);
+
+        const auto now = Clock::now().time_since_epoch().count();
+        if (now >= nextReportTicks.load(std::memory_order_relaxed)) {
+            // skip the report if another thread is reporting
+            const auto lock = std::unique_lock{reportMutex, std::try_to_lock};
+            if (lock.owns_lock()) {
+                nextReportTicks.store(now + interval.count(),
+                                      std::memory_order_relaxed);
+                report();
             }
-
-            executeChunk(lock, loop, chunk);
         }
     }
 
-    void workerThread(const int threadIndex) {
-        using statics::workListCondVar, statics::workListMutex;
-        using statics::workListHead, statics::shutdownThreads;
+    void detail::ProgressReporter::finish() {
+        const auto lock = std::lock_guard{reportMutex};
+        report();
+    }
 
-        statics::thisThreadIndex = threadIndex;
+    void detail::ProgressReporter::report() {
+        const std::int64_t completed =
+            completedIterations.load(std::memory_order_relaxed);
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        LoopProgress progress{
+            .completedIterations = completed,
+            .totalIterations = totalIterations,
+            .elapsed = elapsed,
+            .estimatedTimeLeft = {},
+        };
+        if (completed > 0) {
+            progress.estimatedTimeLeft =
+                elapsed * (static_cast<double>(totalIterations - completed) /
+                           static_cast<double>(completed));
+        }
 
-        auto lock = std::unique_lock{workListMutex};
-        while (!shutdownThreads) {
-            if (workListHead == nullptr) {
-                workListCondVar.wait(lock);
-            }
-            else {
-                ParallelForLoop& loop = *workListHead;
+        onProgress(progress);
+    }
+
+    void detail::SpawnedTask::execute() {
+        run();
 
-                const auto chunk = loop.extractNextChunk();
+        std::atomic<std::int64_t>* const counter = pendingTasks;
+        delete this;
 
-                if (loop.hasNoIterationsLeft()) {
-                    workListHead = loop.next;
-                }
+        // (!) The group may be destroyed as soon as this is done. (!)
+        counter->fetch_sub(1, std::memory_order_acq_rel);
+    }
 
-                executeChunk(lock, loop, chunk);
+    void detail::submit(SpawnedTask* const task) {
+        using statics::threads, statics::scheduler;
 
-                if (loop.isFinished()) {
-                    workListCondVar.notify_all();
-                }
-            }
+        if (threads.empty() || !scheduler->submit(task)) {
+            task->execute();
         }
     }
 
-    void executeChunk(std::unique_lock<std::mutex>& lock,
-                      ParallelForLoop& loop,
-                      const IterationsChunk& chunk) {
-        assert(lock.owns_lock());
-
-        loop.activeWorkers += 1;
+    void TaskGroup::wait() {
+        if (pendingTasks.load(std::memory_order_acquire) > 0) {
+            assert(statics::scheduler != nullptr);
+            statics::scheduler->waitFor(pendingTasks);
+        }
+    }
 
-        // let other threads access the worklist while
-        // executing iterations of the current loop
-        lock.unlock();
-        for (auto i = chunk.first; i < chunk.last; ++i) {
-            if (loop.func1D) {
-                loop.func1D(i);
-            }
-            else {
-                assert(loop.func2D);
-                loop.func2D(i % loop.nX, i / loop.nX);
-            }
+    void workerThread(const int threadIndex, const int cpu) {
+        if (cpu >= 0) {
+            pinThisThread({cpu});
         }
-        lock.lock();
 
-        loop.activeWorkers -= 1;
+        statics::thisThreadIndex = threadIndex;
+        statics::scheduler->workerLoop(threadIndex);
     }
 
     int maxThreadIndex() noexcept { return numberOfSystemCores(); }
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "pbrt/parallel/Parallel.hpp"
+#include "pbrt/memory/Memory.hpp"
+
+#include <atomic>
+#include <array>
+#include <deque>
+#include <memory>
+#include <assert.h>
+
+namespace idragnev::pbrt::parallel {
+    // an exclusive range of loop iterations: [first, last)
+    struct IterationsChunk
+    {
+        std::int64_t size() const noexcept { return last - first; }
+
+        std::int64_t first = 0;
+        std::int64_t last = 0;
+    };
+
+    class ParallelForLoop
+    {
+    public:
+        ParallelForLoop(const detail::RangeFunctionRef f,
+                        const std::int64_t lastIteration,
+                        const Chunking chunking)
+            : lastIteration(lastIteration)
+            , chunking(chunking)
+            , iterationsLeft(lastIteration)
+            , func(f) {}
+
+        void execute(const IterationsChunk& chunk) const {
+            func(chunk.first, chunk.last);
+        }
+
+    public:
+        std::int64_t lastIteration = 0;
+        Chunking chunking = 1;
+
+        // state used by WorkListScheduler,
+        // guarded by its work list mutex
+        ParallelForLoop* next = nullptr;
+        bool isInWorkList = false;
+        std::int64_t nextIteration = 0;
+        int activeWorkers = 0;
+
+        // state used by WorkStealingScheduler
+        std::atomic<std::int64_t> iterationsLeft = 0;
+
+    private:
+        detail::RangeFunctionRef func;
+    };
+
+    // Distributes the iterations of parallel loops and the spawned
+    // tasks among the threads of the worker pool.
+    class LoopScheduler
+    {
+    public:
+        virtual ~LoopScheduler() = default;
+
+        // Executes all iterations of `loop`, returning when they are done.
+        // The calling thread takes part in the execution.
+        virtual void run(ParallelForLoop& loop) = 0;
+
+        // Queues a spawned task. Returns false if the task
+        // was not queued and the caller must execute it.
+        virtual bool submit(detail::SpawnedTask* const task) = 0;
+        // Executes queued tasks and loop iterations
+        // until `pendingTasks` drops to zero.
+        virtual void waitFor(const std::atomic<std::int64_t>& pendingTasks) = 0;
+
+        // The body of each worker thread.
+        // Returns after requestStop() is called.
+        virtual void workerLoop(const int threadIndex) = 0;
+        virtual void requestStop() = 0;
+    };
+
+    // All loops are kept in a single list and each chunk
+    // of iterations is claimed while holding a global mutex.
+    class WorkListScheduler final : public LoopScheduler
+    {
+    public:
+        explicit WorkListScheduler(const int threadsCount);
+
+        void run(ParallelForLoop& loop) override;
+        bool submit(detail::SpawnedTask* const task) override;
+        void waitFor(const std::atomic<std::int64_t>& pendingTasks) override;
+        void workerLoop(const int threadIndex) override;
+        void requestStop() override;
+
+    private:
+        static bool isFinished(const ParallelForLoop& loop) noexcept;
+        static bool hasNoIterationsLeft(const ParallelForLoop& loop) noexcept;
+
+        bool executeNextWork(std::unique_lock<std::mutex>& lock);
+        void waitForWork(std::unique_lock<std::mutex>& lock);
+        void removeFromWorkList(ParallelForLoop& loop) noexcept;
+        IterationsChunk extractNextChunk(ParallelForLoop& loop);
+        void executeChunk(std::unique_lock<std::mutex>& lock,
+                          ParallelForLoop& loop,
+                          const IterationsChunk& chunk);
+
+    private:
+        int threadsCount = 0;
+        ParallelForLoop* workListHead = nullptr;
+        std::deque<detail::SpawnedTask*> spawnedTasks;
+        std::mutex workListMutex;
+        std::condition_variable workListCondVar;
+        // incremented (under the mutex) whenever work is added,
+        // read without it by the spinning workers
+        std::atomic<std::uint64_t> workEpoch = 0;
+        std::int64_t sleepingWorkers = 0;
+        bool stopRequested = false;
+    };
+
+    // Each thread owns a deque of tasks (ranges of loop iterations
+    // or spawned tasks).
+    // A thread executing a range splits off its upper half to the bottom
+    // of its deque whenever the deque is empty. Idle threads steal the
+    // oldest (and largest) tasks from the top of the other threads' deques.
+    // Chunks are claimed without taking a global lock.
+    class WorkStealingScheduler final : public LoopScheduler
+    {
+    private:
+        struct Task
+        {
+            static Task Iterations(ParallelForLoop* const loop,
+                                   const IterationsChunk& chunk) noexcept {
+                return Task{loop, chunk, nullptr};
+            }
+
+            static Task Spawned(detail::SpawnedTask* const task) noexcept {
+                return Task{nullptr, IterationsChunk{}, task};
+            }
+
+            ParallelForLoop* loop = nullptr;
+            IterationsChunk chunk;
+            // set instead of `loop` for spawned tasks
+            detail::SpawnedTask* spawned = nullptr;
+        };
+
+#ifdef _MSC_VER
+    #pragma warning(push)
+    #pragma warning(disable : 4324) // structure padding due to alignment specifier
+#endif
+        // A fixed-capacity deque guarded by its own mutex.
+        // The owner pushes and pops at the bottom, thieves steal from the top.
+        class alignas(memory::constants::L1_CACHE_LINE_SIZE) TaskDeque
+        {
+        public:
+            static inline constexpr std::size_t CAPACITY = 256;
+
+            bool pushBottom(const Task& task);
+            bool popBottom(Task& task);
+            bool stealTop(Task& task);
+
+            // Reads the size without locking, so the result may be stale.
+            bool looksEmpty() const noexcept;
+
+        private:
+            std::mutex mutex;
+            std::size_t top = 0;
+            std::size_t bottom = 0;
+            std::atomic<std::size_t> size = 0;
+            std::array<Task, CAPACITY> tasks;
+        };
+#ifdef _MSC_VER
+    #pragma warning(pop)
+#endif
+
+    public:
+        explicit WorkStealingScheduler(const int threadsCount);
+
+        void run(ParallelForLoop& loop) override;
+        bool submit(detail::SpawnedTask* const task) override;
+        void waitFor(const std::atomic<std::int64_t>& pendingTasks) override;
+        void workerLoop(const int threadIndex) override;
+        void requestStop() override;
+
+    private:
+        void helpWhilePositive(const std::atomic<std::int64_t>& counter,
+                               const int threadIndex);
+        void execute(Task task, const int threadIndex);
+        bool findTask(Task& task, const int threadIndex);
+        bool hasAnyTask();
+
+        void notifyWorkAvailable();
+        void waitForWork();
+
+    private:
+        int threadsCount = 0;
+        std::unique_ptr<TaskDeque[]> deques;
+
+        std::atomic<bool> stopRequested = false;
+        std::atomic<std::uint64_t> workEpoch = 0;
+        std::atomic<int> sleepingThreads = 0;
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondVar;
+    };
+} // namespace idragnev::pbrt::parallel
\ No newline at end of file
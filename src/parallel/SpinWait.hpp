@@ -0,0 +1,48 @@
+#pragma once
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #include <immintrin.h>
+#endif
+
+namespace idragnev::pbrt::parallel {
+    namespace constants {
+        // about a microsecond of busy waiting on current x86 cores
+        inline constexpr int SPIN_WAIT_PAUSES = 128;
+        inline constexpr int SPIN_WAIT_YIELDS = 16;
+    } // namespace constants
+
+    // Hints the CPU that the thread is busy waiting.
+    inline void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // The first phase of a spin-then-block wait: busy waits briefly and then
+    // yields a few times, checking `isDone()` in between.
+    // Returns false if the caller should block because the condition
+    // is still not met. Short waits, e.g. between back-to-back loops,
+    // are resolved without the latency of going to sleep and waking up.
+    template <typename Pred>
+    bool spinUntil(Pred&& isDone) {
+        for (int i = 0; i < constants::SPIN_WAIT_PAUSES; ++i) {
+            if (isDone()) {
+                return true;
+            }
+            cpuRelax();
+        }
+
+        for (int i = 0; i < constants::SPIN_WAIT_YIELDS; ++i) {
+            if (isDone()) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        return isDone();
+    }
+} // namespace idragnev::pbrt::parallel
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "ThreadAffinity.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <assert.h>
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace idragnev::pbrt::parallel {
+    struct CpuInfo
+    {
+        int cpu = 0;
+        int numaNode = 0;
+        int package = 0;
+        int core = 0;
+        // 0 for the first logical CPU of a physical core,
+        // 1 for its first SMT sibling and so on
+        int smtRank = 0;
+    };
+
+    std::vector<CpuInfo> cpusTopology(const std::vector<int>& cpus);
+    std::vector<int> compactOrder(std::vector<CpuInfo> topology);
+    std::vector<int> scatterOrder(std::vector<CpuInfo> topology);
+    int numaNodeOf(const int cpu);
+    int readTopologyValue(const int cpu, const char* name);
+
+    std::vector<int> cpusForThreads(const ThreadPoolOptions& options,
+                                    const int threadsCount) {
+        std::vector<int> order;
+
+        switch (options.affinity) {
+            case ThreadAffinity::Compact:
+                order = compactOrder(cpusTopology(thisThreadAllowedCpus()));
+                break;
+            case ThreadAffinity::Scatter:
+                order = scatterOrder(cpusTopology(thisThreadAllowedCpus()));
+                break;
+            case ThreadAffinity::ExplicitCores:
+                assert(!options.cores.empty());
+                order = options.cores;
+                break;
+            case ThreadAffinity::None:
+            default:
+                break;
+        }
+
+        if (order.empty()) {
+            return {};
+        }
+
+        std::vector<int> result(static_cast<std::size_t>(threadsCount));
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            result[i] = order[i % order.size()];
+        }
+
+        return result;
+    }
+
+    std::vector<int> compactOrder(std::vector<CpuInfo> topology) {
+        std::sort(topology.begin(),
+                  topology.end(),
+                  [](const CpuInfo& a, const CpuInfo& b) {
+                      return std::tie(a.numaNode, a.package, a.core, a.cpu) <
+                             std::tie(b.numaNode, b.package, b.core, b.cpu);
+                  });
+
+        std::vector<int> order;
+        order.reserve(topology.size());
+        for (const CpuInfo& info : topology) {
+            order.push_back(info.cpu);
+        }
+
+        return order;
+    }
+
+    std::vector<int> scatterOrder(std::vector<CpuInfo> topology) {
+        std::sort(topology.begin(),
+                  topology.end(),
+                  [](const CpuInfo& a, const CpuInfo& b) {
+                      return std::tie(a.numaNode, a.smtRank, a.package, a.core) <
+                             std::tie(b.numaNode, b.smtRank, b.package, b.core);
+                  });
+
+        // [first, last) ranges of the CPUs of each NUMA node
+        std::vector<std::pair<std::size_t, std::size_t>> nodes;
+        for (std::size_t i = 0; i < topology.size(); ++i) {
+            if (i == 0 || topology[i].numaNode != topology[i - 1].numaNode) {
+                nodes.emplace_back(i, i);
+            }
+            nodes.back().second = i + 1;
+        }
+
+        std::vector<int> order;
+        order.reserve(topology.size());
+        while (order.size() < topology.size()) {
+            for (auto& [first, last] : nodes) {
+                if (first < last) {
+                    order.push_back(topology[first++].cpu);
+                }
+            }
+        }
+
+        return order;
+    }
+
+    std::vector<CpuInfo> cpusTopology(const std::vector<int>& cpus) {
+        std::vector<CpuInfo> topology;
+        topology.reserve(cpus.size());
+        for (const int cpu : cpus) {
+            topology.push_back(
+                CpuInfo{.cpu = cpu,
+                        .numaNode = numaNodeOf(cpu),
+                        .package = readTopologyValue(cpu, "physical_package_id"),
+                        .core = readTopologyValue(cpu, "core_id")});
+        }
+
+        for (CpuInfo& info : topology) {
+            info.smtRank = static_cast<int>(std::count_if(
+                topology.begin(),
+                topology.end(),
+                [&info](const CpuInfo& other) {
+                    return other.package == info.package &&
+                           other.core == info.core && other.cpu < info.cpu;
+                }));
+        }
+
+        return topology;
+    }
+
+    int numaNodeOf(const int cpu) {
+        namespace fs = std::filesystem;
+
+        const auto cpuDir =
+            fs::path{"/sys/devices/system/cpu"} / ("cpu" + std::to_string(cpu));
+
+        std::error_code error;
+        for (auto it = fs::directory_iterator{cpuDir, error};
+             !error && it != fs::directory_iterator{};
+             it.increment(error)) {
+            const std::string name = it->path().filename().string();
+            if (name.size() > 4 && name.starts_with("node")) {
+                return std::atoi(name.c_str() + 4);
+            }
+        }
+
+        return 0;
+    }
+
+    int readTopologyValue(const int cpu, const char* name) {
+        const auto path = std::filesystem::path{"/sys/devices/system/cpu"} /
+                          ("cpu" + std::to_string(cpu)) / "topology" / name;
+
+        int value = 0;
+        if (std::ifstream file{path}; file >> value) {
+            return value;
+        }
+
+        return 0;
+    }
+
+#if defined(__linux__)
+    std::vector<int> thisThreadAllowedCpus() {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            return {};
+        }
+
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+
+        return cpus;
+    }
+
+    bool pinThisThread(const std::vector<int>& cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+
+        return CPU_COUNT(&set) > 0 &&
+               pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    int currentNumaNode() noexcept {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+            return static_cast<int>(node);
+        }
+
+        return 0;
+    }
+#else
+    std::vector<int> thisThreadAllowedCpus() { return {}; }
+
+    bool pinThisThread(const std::vector<int>&) { return false; }
+
+    int currentNumaNode() noexcept { return 0; }
+#endif
+} // namespace idragnev::pbrt::parallel
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <vector>
+
+namespace idragnev::pbrt::parallel {
+    // Returns the logical CPU each of the `threadsCount` threads of the pool
+    // should be pinned to, indexed by thread index.
+    // Returns an empty vector if the threads should not be pinned.
+    std::vector<int> cpusForThreads(const ThreadPoolOptions& options,
+                                    const int threadsCount);
+
+    // The logical CPUs the calling thread is allowed to run on.
+    std::vector<int> thisThreadAllowedCpus();
+
+    // Restricts the calling thread to the given logical CPUs.
+    // Returns false if the system rejects the request.
+    bool pinThisThread(const std::vector<int>& cpus);
+
+    // The NUMA node of the core the calling thread is running on, or 0.
+    int currentNumaNode() noexcept;
+} // namespace idragnev::pbrt::parallel
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+namespace idragnev::pbrt::parallel::detail {
+    std::uint64_t mortonKey(const Tile& t);
+    std::uint64_t hilbertKey(const Tile& t, const std::int64_t side);
+    std::uint64_t spreadBits(std::uint64_t x);
+    std::int64_t nextPowerOfTwo(const std::int64_t n);
+
+    std::vector<Tile> orderedTiles(const std::int64_t nX,
+                                   const std::int64_t nY,
+                                   const TileOrder order) {
+        assert(nX >= 0 && nY >= 0);
+
+        std::vector<Tile> tiles;
+        tiles.reserve(static_cast<std::size_t>(nX * nY));
+        for (std::int64_t y = 0; y < nY; ++y) {
+            for (std::int64_t x = 0; x < nX; ++x) {
+                tiles.push_back(Tile{x, y});
+            }
+        }
+
+        const auto sortBy = [&tiles](const auto key) {
+            std::stable_sort(tiles.begin(),
+                             tiles.end(),
+                             [&key](const Tile& a, const Tile& b) {
+                                 return key(a) < key(b);
+                             });
+        };
+
+        switch (order) {
+            case TileOrder::Morton: {
+                sortBy(mortonKey);
+            } break;
+            case TileOrder::Hilbert: {
+                const auto side = nextPowerOfTwo(std::max(nX, nY));
+                sortBy([side](const Tile& t) { return hilbertKey(t, side); });
+            } break;
+            case TileOrder::Spiral: {
+                // Tiles are sorted by the square ring around the centre
+                // they lie on and then by their angle on that ring.
+                const double cx = static_cast<double>(nX - 1) / 2.0;
+                const double cy = static_cast<double>(nY - 1) / 2.0;
+                sortBy([cx, cy](const Tile& t) {
+                    const double dx = static_cast<double>(t.x) - cx;
+                    const double dy = static_cast<double>(t.y) - cy;
+                    const double ring = std::max(std::abs(dx), std::abs(dy));
+                    return std::make_pair(ring, std::atan2(dy, dx));
+                });
+            } break;
+            case TileOrder::Scanline:
+            default:
+                break;
+        }
+
+        return tiles;
+    }
+
+    std::uint64_t mortonKey(const Tile& t) {
+        return (spreadBits(static_cast<std::uint64_t>(t.y)) << 1) |
+               spreadBits(static_cast<std::uint64_t>(t.x));
+    }
+
+    // Inserts a zero bit between each of the lower 32 bits of x
+    std::uint64_t spreadBits(std::uint64_t x) {
+        x &= 0x00000000FFFFFFFF;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFF;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FF;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0F;
+        x = (x | (x << 2)) & 0x3333333333333333;
+        x = (x | (x << 1)) & 0x5555555555555555;
+
+        return x;
+    }
+
+    // The distance of the tile along the Hilbert curve
+    // filling a `side` x `side` grid.
+    // `side` must be a power of two.
+    std::uint64_t hilbertKey(const Tile& t, const std::int64_t side) {
+        std::int64_t x = t.x;
+        std::int64_t y = t.y;
+        std::uint64_t d = 0;
+
+        for (std::int64_t s = side / 2; s > 0; s /= 2) {
+            const std::int64_t rx = (x & s) > 0 ? 1 : 0;
+            const std::int64_t ry = (y & s) > 0 ? 1 : 0;
+            d += static_cast<std::uint64_t>(s * s * ((3 * rx) ^ ry));
+
+            // rotate the quadrant so the curve stays continuous
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = side - 1 - x;
+                    y = side - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+
+        return d;
+    }
+
+    std::int64_t nextPowerOfTwo(const std::int64_t n) {
+        std::int64_t result = 1;
+        while (result < n) {
+            result *= 2;
+        }
+
+        return result;
+    }
+} // namespace idragnev::pbrt::parallel::detail
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "Schedulers.hpp"
+#include "SpinWait.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace idragnev::pbrt::parallel {
+    WorkListScheduler::WorkListScheduler(const int threadsCount)
+        : threadsCount(threadsCount) {
+        assert(threadsCount > 0);
+    }
+
+    void WorkListScheduler::run(ParallelForLoop& loop) {
+        auto lock = std::unique_lock(workListMutex);
+        loop.next = workListHead;
+        workListHead = &loop;
+        loop.isInWorkList = true;
+        workEpoch.fetch_add(1, std::memory_order_relaxed);
+
+        // wake only as many workers as there are chunks for them
+        const std::int64_t minChunkSize = loop.chunking.minSize();
+        const std::int64_t chunksCount =
+            (loop.lastIteration + minChunkSize - 1) / minChunkSize;
+        const std::int64_t workersToWake = std::min<std::int64_t>(
+            {chunksCount - 1, threadsCount - 1, sleepingWorkers});
+        for (std::int64_t i = 0; i < workersToWake; ++i) {
+            workListCondVar.notify_one();
+        }
+
+        while (!isFinished(loop)) {
+            const auto chunk = extractNextChunk(loop);
+
+            if (hasNoIterationsLeft(loop)) {
+                removeFromWorkList(loop);
+            }
+
+            executeChunk(lock, loop, chunk);
+        }
+
+        // a loop with no iterations is never executed
+        removeFromWorkList(loop);
+    }
+
+    bool WorkListScheduler::submit(detail::SpawnedTask* const task) {
+        const auto lock = std::lock_guard{workListMutex};
+        spawnedTasks.push_back(task);
+        workEpoch.fetch_add(1, std::memory_order_relaxed);
+
+        if (sleepingWorkers > 0) {
+            workListCondVar.notify_one();
+        }
+
+        return true;
+    }
+
+    void WorkListScheduler::waitFor(
+        const std::atomic<std::int64_t>& pendingTasks) {
+        auto lock = std::unique_lock{workListMutex};
+        while (pendingTasks.load(std::memory_order_acquire) > 0) {
+            if (!executeNextWork(lock)) {
+                // the remaining tasks are executing in other threads
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+            }
+        }
+    }
+
+    void WorkListScheduler::workerLoop(const int) {
+        auto lock = std::unique_lock{workListMutex};
+        while (!stopRequested) {
+            if (!executeNextWork(lock)) {
+                waitForWork(lock);
+            }
+        }
+    }
+
+    // Spins briefly before going to sleep, so that a worker idle between
+    // back-to-back loops picks up the next one without being woken up.
+    // The epoch changes (under the mutex) whenever work is added.
+    void WorkListScheduler::waitForWork(std::unique_lock<std::mutex>& lock) {
+        assert(lock.owns_lock());
+
+        const auto epoch = workEpoch.load(std::memory_order_relaxed);
+        const auto hasNewWork = [this, epoch] {
+            return workEpoch.load(std::memory_order_relaxed) != epoch;
+        };
+
+        lock.unlock();
+        const bool hasWork = spinUntil(hasNewWork);
+        lock.lock();
+
+        if (!hasWork) {
+            sleepingWorkers += 1;
+            workListCondVar.wait(lock, hasNewWork);
+            sleepingWorkers -= 1;
+        }
+    }
+
+    // Executes a spawned task or a chunk of the loop at the head of the
+    // work list. Returns false if there is no work to execute.
+    bool WorkListScheduler::executeNextWork(std::unique_lock<std::mutex>& lock) {
+        assert(lock.owns_lock());
+
+        if (!spawnedTasks.empty()) {
+            detail::SpawnedTask* const task = spawnedTasks.front();
+            spawnedTasks.pop_front();
+
+            lock.unlock();
+            task->execute();
+            lock.lock();
+
+            return true;
+        }
+
+        if (workListHead != nullptr) {
+            ParallelForLoop& loop = *workListHead;
+
+            const auto chunk = extractNextChunk(loop);
+
+            if (hasNoIterationsLeft(loop)) {
+                removeFromWorkList(loop);
+            }
+
+            executeChunk(lock, loop, chunk);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    // The loops of other threads, e.g. of sibling spawned tasks, may have
+    // been pushed after `loop` and may end before or after it, so `loop`
+    // is not necessarily the head of the list
+    void WorkListScheduler::removeFromWorkList(ParallelForLoop& loop) noexcept {
+        if (!loop.isInWorkList) {
+            return;
+        }
+
+        ParallelForLoop** link = &workListHead;
+        while (*link != &loop) {
+            assert(*link != nullptr);
+            link = &(*link)->next;
+        }
+        *link = loop.next;
+
+        loop.next = nullptr;
+        loop.isInWorkList = false;
+    }
+
+    void WorkListScheduler::requestStop() {
+        const auto lock = std::lock_guard{workListMutex};
+        stopRequested = true;
+        workEpoch.fetch_add(1, std::memory_order_relaxed);
+        workListCondVar.notify_all();
+    }
+
+    bool WorkListScheduler::isFinished(const ParallelForLoop& loop) noexcept {
+        return hasNoIterationsLeft(loop) && loop.activeWorkers == 0;
+    }
+
+    bool WorkListScheduler::hasNoIterationsLeft(
+        const ParallelForLoop& loop) noexcept {
+        return loop.nextIteration >= loop.lastIteration;
+    }
+
+    IterationsChunk WorkListScheduler::extractNextChunk(ParallelForLoop& loop) {
+        const auto first = loop.nextIteration;
+        const auto chunkSize =
+            loop.chunking.nextChunkSize(loop.lastIteration - first, threadsCount);
+        const auto last = std::min(first + chunkSize, loop.lastIteration);
+
+        loop.nextIteration = last;
+
+        return {first, last};
+    }
+
+    void WorkListScheduler::executeChunk(std::unique_lock<std::mutex>& lock,
+                                         ParallelForLoop& loop,
+                                         const IterationsChunk& chunk) {
+        assert(lock.owns_lock());
+
+        loop.activeWorkers += 1;
+
+        // let other threads access the worklist while
+        // executing iterations of the current loop
+        lock.unlock();
+        loop.execute(chunk);
+        lock.lock();
+
+        loop.activeWorkers -= 1;
+    }
+} // namespace idragnev::pbrt::parallel
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "Schedulers.hpp"
+#include "SpinWait.hpp"
+
+#include <thread>
+
+namespace idragnev::pbrt::parallel {
+    bool WorkStealingScheduler::TaskDeque::pushBottom(const Task& task) {
+        const auto lock = std::lock_guard{mutex};
+        if (bottom - top == CAPACITY) {
+            return false;
+        }
+
+        tasks[bottom % CAPACITY] = task;
+        ++bottom;
+        size.store(bottom - top, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    bool WorkStealingScheduler::TaskDeque::popBottom(Task& task) {
+        const auto lock = std::lock_guard{mutex};
+        if (bottom == top) {
+            return false;
+        }
+
+        --bottom;
+        task = tasks[bottom % CAPACITY];
+        size.store(bottom - top, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    bool WorkStealingScheduler::TaskDeque::stealTop(Task& task) {
+        const auto lock = std::lock_guard{mutex};
+        if (bottom == top) {
+            return false;
+        }
+
+        task = tasks[top % CAPACITY];
+        ++top;
+        size.store(bottom - top, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    bool WorkStealingScheduler::TaskDeque::looksEmpty() const noexcept {
+        return size.load(std::memory_order_relaxed) == 0;
+    }
+
+    WorkStealingScheduler::WorkStealingScheduler(const int threadsCount)
+        : threadsCount(threadsCount)
+        , deques(std::make_unique<TaskDeque[]>(
+              static_cast<std::size_t>(threadsCount))) {
+        assert(threadsCount > 0);
+    }
+
+    void WorkStealingScheduler::run(ParallelForLoop& loop) {
+        const int threadIndex = thisThreadIndex();
+        assert(threadIndex < threadsCount);
+
+        execute(Task::Iterations(&loop, {0, loop.lastIteration}), threadIndex);
+        helpWhilePositive(loop.iterationsLeft, threadIndex);
+    }
+
+    bool WorkStealingScheduler::submit(detail::SpawnedTask* const task) {
+        const int threadIndex = thisThreadIndex();
+        assert(threadIndex < threadsCount);
+
+        if (deques[static_cast<std::size_t>(threadIndex)].pushBottom(
+                Task::Spawned(task))) {
+            notifyWorkAvailable();
+            return true;
+        }
+
+        return false;
+    }
+
+    void WorkStealingScheduler::waitFor(
+        const std::atomic<std::int64_t>& pendingTasks) {
+        helpWhilePositive(pendingTasks, thisThreadIndex());
+    }
+
+    // Helps with whatever work is available until `counter` drops to zero.
+    // The work it is waiting for may be executing in other threads,
+    // so this thread can not go to sleep.
+    void WorkStealingScheduler::helpWhilePositive(
+        const std::atomic<std::int64_t>& counter,
+        const int threadIndex) {
+        while (counter.load(std::memory_order_acquire) > 0) {
+            if (Task task; findTask(task, threadIndex)) {
+                execute(task, threadIndex);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void WorkStealingScheduler::workerLoop(const int threadIndex) {
+        assert(threadIndex < threadsCount);
+
+        while (!stopRequested.load(std::memory_order_acquire)) {
+            if (Task task; findTask(task, threadIndex)) {
+                execute(task, threadIndex);
+            }
+            else {
+                waitForWork();
+            }
+        }
+    }
+
+    void WorkStealingScheduler::requestStop() {
+        stopRequested.store(true);
+
+        const auto lock = std::lock_guard{sleepMutex};
+        sleepCondVar.notify_all();
+    }
+
+    // Executes the task range chunk by chunk. Uses lazy binary splitting:
+    // whenever this thread's deque runs empty, the unexecuted part of the
+    // range is split in halves and the upper half is pushed to the deque,
+    // so there is always something to steal while the deque traffic stays
+    // proportional to the number of steals rather than to the number
+    // of chunks.
+    void WorkStealingScheduler::execute(Task task, const int threadIndex) {
+        if (task.spawned != nullptr) {
+            task.spawned->execute();
+            return;
+        }
+
+        ParallelForLoop& loop = *task.loop;
+        TaskDeque& deque = deques[static_cast<std::size_t>(threadIndex)];
+        const Chunking chunking = loop.chunking;
+        const std::int64_t minChunkSize = chunking.minSize();
+
+        std::int64_t executedIterations = 0;
+        while (task.chunk.size() > 0) {
+            // split at a multiple of the minimum chunk size,
+            // so that neither half is smaller than it
+            if (task.chunk.size() >= 2 * minChunkSize && deque.looksEmpty()) {
+                const auto halfChunksCount =
+                    task.chunk.size() / minChunkSize / 2;
+                const auto mid =
+                    task.chunk.first + halfChunksCount * minChunkSize;
+
+                if (deque.pushBottom(
+                        Task::Iterations(&loop, {mid, task.chunk.last}))) {
+                    task.chunk.last = mid;
+                    notifyWorkAvailable();
+                }
+            }
+
+            // Guided chunks shrink with the remaining part of this task's
+            // range - the splits above already balance the rest of the loop.
+            const auto chunkSize =
+                chunking.nextChunkSize(task.chunk.size(), threadsCount);
+            const IterationsChunk chunk = {
+                task.chunk.first,
+                std::min(task.chunk.first + chunkSize, task.chunk.last),
+            };
+            loop.execute(chunk);
+
+            executedIterations += chunk.size();
+            task.chunk.first = chunk.last;
+        }
+
+        // (!) This must be the last access to `loop` -
+        // it may be destroyed as soon as no iterations are left. (!)
+        loop.iterationsLeft.fetch_sub(executedIterations,
+                                      std::memory_order_acq_rel);
+    }
+
+    // Pops the most recently pushed task of this thread's deque.
+    // If there is none, tries to steal from the other threads' deques.
+    bool WorkStealingScheduler::findTask(Task& task, const int threadIndex) {
+        const auto n = static_cast<std::size_t>(threadsCount);
+        const auto self = static_cast<std::size_t>(threadIndex);
+
+        if (deques[self].popBottom(task)) {
+            return true;
+        }
+
+        for (std::size_t i = 1; i < n; ++i) {
+            if (deques[(self + i) % n].stealTop(task)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool WorkStealingScheduler::hasAnyTask() {
+        for (int i = 0; i < threadsCount; ++i) {
+            if (!deques[static_cast<std::size_t>(i)].looksEmpty()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void WorkStealingScheduler::notifyWorkAvailable() {
+        workEpoch.fetch_add(1);
+
+        if (sleepingThreads.load() > 0) {
+            {
+                const auto lock = std::lock_guard{sleepMutex};
+            }
+            sleepCondVar.notify_one();
+        }
+    }
+
+    // The epoch is read after announcing that this thread is going to sleep
+    // and before checking the deques, so a task pushed after the check
+    // changes the epoch and either prevents the wait or wakes this thread.
+    void WorkStealingScheduler::waitForWork() {
+        // Spin briefly first, so that a worker idle between back-to-back
+        // loops picks up the next one without the latency of a wakeup.
+        const bool hasWork = spinUntil([this] {
+            return hasAnyTask() || stopRequested.load(std::memory_order_relaxed);
+        });
+        if (hasWork) {
+            return;
+        }
+
+        auto lock = std::unique_lock{sleepMutex};
+
+        sleepingThreads.fetch_add(1);
+        const auto epoch = workEpoch.load();
+
+        if (!hasAnyTask()) {
+            sleepCondVar.wait(lock, [this, epoch] {
+                return workEpoch.load() != epoch || stopRequested.load();
+            });
+        }
+
+        sleepingThreads.fetch_sub(1);
+    }
+} // namespace idragnev::pbrt::parallel
\ No newline at end of file
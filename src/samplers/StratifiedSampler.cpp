@@ -22,7 +22,7 @@ namespace idragnev::pbrt::samplers {
 
     void StratifiedSampler::generatePrecomputedSamplesArrays()
     {
-        for (std::vector<Float>& samples : precomputed1DSamplesArray) {
+        for (SamplesArray<Float>& samples : precomputed1DSamplesArray) {
             const auto span = std::span<Float>(samples);
 
             sampling::generateStratified1DSamples(
@@ -33,7 +33,7 @@ namespace idragnev::pbrt::samplers {
             sampling::shuffle(span, 1, rng);
         }
 
-        for (std::vector<Point2f>& samples : precomputed2DSamplesArray) {
+        for (SamplesArray<Point2f>& samples : precomputed2DSamplesArray) {
             const auto span = std::span<Point2f>(samples);
 
             sampling::generateStratified2DSamples(
@@ -51,7 +51,7 @@ namespace idragnev::pbrt::samplers {
     {
         for (std::size_t i = 0; i < _1DSamplesArraysSizes.size(); ++i) {
             const std::size_t chunkSize = _1DSamplesArraysSizes[i];
-            std::vector<Float>& arrayedSamples = _1DSamplesArray[i];
+            SamplesArray<Float>& arrayedSamples = _1DSamplesArray[i];
 
             for (std::uint64_t sampleNum = 0; sampleNum < samplesPerPixel;
                  ++sampleNum) {
@@ -70,7 +70,7 @@ namespace idragnev::pbrt::samplers {
 
         for (std::size_t i = 0; i < _2DSamplesArraysSizes.size(); ++i) {
             const std::size_t chunkSize = _2DSamplesArraysSizes[i];
-            std::vector<Point2f>& arrayedSamples = _2DSamplesArray[i];
+            SamplesArray<Point2f>& arrayedSamples = _2DSamplesArray[i];
 
             for (std::uint64_t sampleNum = 0; sampleNum < samplesPerPixel;
                  ++sampleNum) {
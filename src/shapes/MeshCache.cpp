@@ -0,0 +1,371 @@
+#include "pbrt/shapes/MeshCache.hpp"
+#include "pbrt/core/math/Point3.hpp"
+#include "pbrt/core/math/Point2.hpp"
+#include "pbrt/core/math/Vector3.hpp"
+#include "pbrt/core/math/Normal3.hpp"
+#include "pbrt/memory/Memory.hpp"
+#include "pbrt/memory/MappedFile.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace idragnev::pbrt::shapes {
+    namespace {
+        constexpr char MAGIC[8] = {'P', 'B', 'R', 'T', 'M', 'E', 'S', 'H'};
+        // reads differently on a machine of the other byte order
+        constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        enum Section : std::uint32_t
+        {
+            Positions,
+            VertexIndices,
+            FaceIndices,
+            Normals,
+            Tangents,
+            UVs,
+            SectionsCount,
+        };
+
+        struct SectionRange
+        {
+            std::uint64_t offset = 0;
+            std::uint64_t bytes = 0;
+        };
+
+        struct MeshCacheHeader
+        {
+            char magic[8] = {};
+            std::uint32_t version = 0;
+            std::uint32_t byteOrderMark = 0;
+            std::uint32_t floatSize = 0;
+            std::uint32_t storage = 0;
+            std::uint32_t trianglesCount = 0;
+            std::uint32_t verticesCount = 0;
+            std::uint32_t vertexIndexBytes = 0;
+            std::uint32_t faceIndexBytes = 0;
+            SectionRange sections[SectionsCount] = {};
+        };
+
+        // The sections are written and mapped as raw bytes. The debug
+        // builds of the math types have copy operations with asserts,
+        // so only their layout is checked.
+        template <typename T>
+        constexpr bool IS_CACHEABLE = std::is_standard_layout_v<T> &&
+                                      std::is_trivially_destructible_v<T>;
+
+        static_assert(std::is_trivially_copyable_v<MeshCacheHeader>);
+        static_assert(IS_CACHEABLE<Point3f> && IS_CACHEABLE<Point2f>);
+        static_assert(IS_CACHEABLE<Vector3f> && IS_CACHEABLE<Normal3f>);
+        static_assert(IS_CACHEABLE<math::OctahedralVector>);
+        static_assert(IS_CACHEABLE<math::Half>);
+
+        constexpr auto COMPACT_STORAGE =
+            static_cast<std::uint32_t>(MeshStorage::Compact);
+
+        // Each section starts at a cache line boundary of the mapped file
+        constexpr std::uint64_t SECTION_ALIGNMENT =
+            memory::constants::L1_CACHE_LINE_SIZE;
+
+        std::uint64_t alignedOffset(const std::uint64_t offset) noexcept {
+            return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+        }
+
+        template <typename T, memory::MemoryTag Tag>
+        std::span<const std::byte>
+        bytesOf(const MeshArray<T, Tag>& array) noexcept {
+            return std::as_bytes(std::span{array.data(), array.size()});
+        }
+
+        std::span<const std::byte>
+        bytesOf(const MeshIndexBuffer& indices) noexcept {
+            return {static_cast<const std::byte*>(indices.data()),
+                    indices.size() * indices.bytesPerIndex()};
+        }
+
+        template <typename T>
+        std::span<const T> sectionView(const memory::MappedFile& file,
+                                       const SectionRange& section) noexcept {
+            return {reinterpret_cast<const T*>(file.data() + section.offset),
+                    static_cast<std::size_t>(section.bytes / sizeof(T))};
+        }
+
+        bool isValidIndexSize(const std::uint32_t bytesPerIndex) noexcept {
+            return bytesPerIndex == 2 || bytesPerIndex == 4 ||
+                   bytesPerIndex == 8;
+        }
+
+        // Checks the indices as well as their count, since a single
+        // index past the vertices would read past the mapped positions
+        template <typename T>
+        bool areIndicesBelow(const memory::MappedFile& file,
+                             const SectionRange& section,
+                             const std::uint32_t verticesCount) noexcept {
+            for (const T index : sectionView<T>(file, section)) {
+                if (index >= verticesCount) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool areIndicesBelow(const memory::MappedFile& file,
+                             const SectionRange& section,
+                             const std::uint32_t bytesPerIndex,
+                             const std::uint32_t verticesCount) noexcept {
+            switch (bytesPerIndex) {
+                case 2:
+                    return areIndicesBelow<std::uint16_t>(file,
+                                                          section,
+                                                          verticesCount);
+                case 4:
+                    return areIndicesBelow<std::uint32_t>(file,
+                                                          section,
+                                                          verticesCount);
+                default:
+                    return areIndicesBelow<std::uint64_t>(file,
+                                                          section,
+                                                          verticesCount);
+            }
+        }
+
+        // The attribute sections are either empty or have
+        // `perVertex` elements of type T per vertex
+        template <typename T>
+        bool hasAttributeSize(const SectionRange& section,
+                              const std::uint32_t verticesCount,
+                              const std::uint64_t perVertex = 1) noexcept {
+            return section.bytes == 0 ||
+                   section.bytes == verticesCount * perVertex * sizeof(T);
+        }
+    } // namespace
+
+    namespace detail {
+        struct MeshCacheIO
+        {
+            static bool write(const TriangleMesh& mesh,
+                              const std::filesystem::path& path);
+            static std::shared_ptr<const TriangleMesh>
+            load(const std::filesystem::path& path,
+                 std::shared_ptr<const Texture<Float>> alphaMask,
+                 std::shared_ptr<const Texture<Float>> shadowAlphaMask);
+
+        private:
+            static bool isValid(const MeshCacheHeader& header,
+                                const memory::MappedFile& file) noexcept;
+        };
+
+        bool MeshCacheIO::write(const TriangleMesh& mesh,
+                                const std::filesystem::path& path) {
+            const bool isCompact = mesh.storage == MeshStorage::Compact;
+
+            std::span<const std::byte> sectionsBytes[SectionsCount];
+            sectionsBytes[Positions] = bytesOf(mesh.vertexWorldCoordinates);
+            sectionsBytes[VertexIndices] = bytesOf(mesh.vertexIndices);
+            sectionsBytes[FaceIndices] = bytesOf(mesh.faceIndices);
+            sectionsBytes[Normals] = isCompact
+                                         ? bytesOf(mesh.compactNormalVectors)
+                                         : bytesOf(mesh.vertexNormalVectors);
+            sectionsBytes[Tangents] = isCompact
+                                          ? bytesOf(mesh.compactTangentVectors)
+                                          : bytesOf(mesh.vertexTangentVectors);
+            sectionsBytes[UVs] =
+                isCompact ? bytesOf(mesh.compactUVs) : bytesOf(mesh.vertexUVs);
+
+            MeshCacheHeader header;
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = constants::MESH_CACHE_VERSION;
+            header.byteOrderMark = BYTE_ORDER_MARK;
+            header.floatSize = sizeof(Float);
+            header.storage = static_cast<std::uint32_t>(mesh.storage);
+            header.trianglesCount = mesh.trianglesCount;
+            header.verticesCount = mesh.verticesCount;
+            header.vertexIndexBytes = mesh.vertexIndices.bytesPerIndex();
+            header.faceIndexBytes = mesh.faceIndices.bytesPerIndex();
+
+            std::uint64_t offset = sizeof(MeshCacheHeader);
+            for (std::uint32_t i = 0; i < SectionsCount; ++i) {
+                offset = alignedOffset(offset);
+                header.sections[i].offset = offset;
+                header.sections[i].bytes = sectionsBytes[i].size();
+                offset += sectionsBytes[i].size();
+            }
+
+            auto temporaryPath = path;
+            temporaryPath += ".tmp" + std::to_string(std::random_device{}());
+
+            {
+                std::ofstream file{temporaryPath, std::ios::binary};
+                file.write(reinterpret_cast<const char*>(&header),
+                           sizeof(header));
+
+                constexpr char padding[SECTION_ALIGNMENT] = {};
+                std::uint64_t written = sizeof(header);
+                for (std::uint32_t i = 0; i < SectionsCount; ++i) {
+                    const auto paddingBytes =
+                        header.sections[i].offset - written;
+                    file.write(padding,
+                               static_cast<std::streamsize>(paddingBytes));
+                    file.write(
+                        reinterpret_cast<const char*>(sectionsBytes[i].data()),
+                        static_cast<std::streamsize>(sectionsBytes[i].size()));
+                    written =
+                        header.sections[i].offset + header.sections[i].bytes;
+                }
+
+                if (!file.flush()) {
+                    file.close();
+                    std::error_code error;
+                    std::filesystem::remove(temporaryPath, error);
+                    return false;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temporaryPath, path, error);
+            if (error) {
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+
+            return true;
+        }
+
+        bool MeshCacheIO::isValid(const MeshCacheHeader& header,
+                                  const memory::MappedFile& file) noexcept {
+            const std::size_t fileSize = file.size();
+            if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+                header.version != constants::MESH_CACHE_VERSION ||
+                header.byteOrderMark != BYTE_ORDER_MARK ||
+                header.floatSize != sizeof(Float) ||
+                header.storage > COMPACT_STORAGE ||
+                !isValidIndexSize(header.vertexIndexBytes) ||
+                !isValidIndexSize(header.faceIndexBytes)) {
+                return false;
+            }
+
+            for (const SectionRange& section : header.sections) {
+                if (section.offset % SECTION_ALIGNMENT != 0 ||
+                    section.offset > fileSize ||
+                    section.bytes > fileSize - section.offset) {
+                    return false;
+                }
+            }
+
+            const SectionRange* const sections = header.sections;
+            const std::uint64_t trianglesCount = header.trianglesCount;
+            const std::uint32_t verticesCount = header.verticesCount;
+
+            const bool hasValidIndices =
+                sections[VertexIndices].bytes ==
+                    3 * trianglesCount * header.vertexIndexBytes &&
+                (sections[FaceIndices].bytes == 0 ||
+                 sections[FaceIndices].bytes ==
+                     trianglesCount * header.faceIndexBytes);
+
+            bool hasValidAttributes =
+                sections[Positions].bytes == verticesCount * sizeof(Point3f);
+            if (header.storage == COMPACT_STORAGE) {
+                using math::OctahedralVector;
+                hasValidAttributes =
+                    hasValidAttributes &&
+                    hasAttributeSize<OctahedralVector>(sections[Normals],
+                                                       verticesCount) &&
+                    hasAttributeSize<OctahedralVector>(sections[Tangents],
+                                                       verticesCount) &&
+                    hasAttributeSize<math::Half>(sections[UVs],
+                                                 verticesCount,
+                                                 2);
+            }
+            else {
+                hasValidAttributes =
+                    hasValidAttributes &&
+                    hasAttributeSize<Normal3f>(sections[Normals],
+                                               verticesCount) &&
+                    hasAttributeSize<Vector3f>(sections[Tangents],
+                                               verticesCount) &&
+                    hasAttributeSize<Point2f>(sections[UVs], verticesCount);
+            }
+
+            return hasValidIndices && hasValidAttributes &&
+                   areIndicesBelow(file,
+                                   sections[VertexIndices],
+                                   header.vertexIndexBytes,
+                                   verticesCount);
+        }
+
+        std::shared_ptr<const TriangleMesh> MeshCacheIO::load(
+            const std::filesystem::path& path,
+            std::shared_ptr<const Texture<Float>> alphaMask,
+            std::shared_ptr<const Texture<Float>> shadowAlphaMask) {
+            auto file = std::make_shared<const memory::MappedFile>(path);
+            if (!file->isOpen() || file->size() < sizeof(MeshCacheHeader)) {
+                return nullptr;
+            }
+
+            MeshCacheHeader header;
+            std::memcpy(&header, file->data(), sizeof(header));
+            if (!isValid(header, *file)) {
+                return nullptr;
+            }
+
+            const SectionRange* const sections = header.sections;
+
+            // TriangleMesh's default constructor is private
+            auto mesh = std::shared_ptr<TriangleMesh>(new TriangleMesh{});
+            mesh->trianglesCount = header.trianglesCount;
+            mesh->verticesCount = header.verticesCount;
+            mesh->storage = static_cast<MeshStorage>(header.storage);
+            mesh->vertexIndices =
+                MeshIndexBuffer(file->data() + sections[VertexIndices].offset,
+                                3 * std::size_t{header.trianglesCount},
+                                header.vertexIndexBytes);
+            mesh->vertexWorldCoordinates =
+                sectionView<Point3f>(*file, sections[Positions]);
+            mesh->alphaMask = std::move(alphaMask);
+            mesh->shadowAlphaMask = std::move(shadowAlphaMask);
+            if (sections[FaceIndices].bytes > 0) {
+                mesh->faceIndices =
+                    MeshIndexBuffer(file->data() + sections[FaceIndices].offset,
+                                    header.trianglesCount,
+                                    header.faceIndexBytes);
+            }
+
+            if (mesh->storage == MeshStorage::Compact) {
+                using math::OctahedralVector;
+                mesh->compactNormalVectors =
+                    sectionView<OctahedralVector>(*file, sections[Normals]);
+                mesh->compactTangentVectors =
+                    sectionView<OctahedralVector>(*file, sections[Tangents]);
+                mesh->compactUVs =
+                    sectionView<math::Half>(*file, sections[UVs]);
+            }
+            else {
+                mesh->vertexNormalVectors =
+                    sectionView<Normal3f>(*file, sections[Normals]);
+                mesh->vertexTangentVectors =
+                    sectionView<Vector3f>(*file, sections[Tangents]);
+                mesh->vertexUVs = sectionView<Point2f>(*file, sections[UVs]);
+            }
+            mesh->mappedFile = std::move(file);
+
+            return mesh;
+        }
+    } // namespace detail
+
+    bool writeMeshCache(const TriangleMesh& mesh,
+                        const std::filesystem::path& path) {
+        return detail::MeshCacheIO::write(mesh, path);
+    }
+
+    std::shared_ptr<const TriangleMesh>
+    loadMeshCache(const std::filesystem::path& path,
+                  std::shared_ptr<const Texture<Float>> alphaMask,
+                  std::shared_ptr<const Texture<Float>> shadowAlphaMask) {
+        return detail::MeshCacheIO::load(path,
+                                         std::move(alphaMask),
+                                         std::move(shadowAlphaMask));
+    }
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <array>
+#include <span>
+#include <tuple>
+
+namespace idragnev::pbrt::shapes::detail {
+    // The triangle `number` of `mesh`, intersected on behalf of `shape`
+    // which owns the mesh - a Triangle or a TriangleMeshShape.
+    // Holds only references, so it is created for each query.
+    class MeshTriangle
+    {
+    private:
+        struct PartialDerivatives
+        {
+            Vector3f dpdu;
+            Vector3f dpdv;
+        };
+
+        using VerticesCoordinates =
+            std::tuple<const Point3f&, const Point3f&, const Point3f&>;
+
+        struct RayCoordinateSpaceVertices
+        {
+            Point3f p0;
+            Point3f p1;
+            Point3f p2;
+            Float sz;
+        };
+
+    public:
+        MeshTriangle(const TriangleMesh& mesh,
+                     const unsigned number,
+                     const Shape& shape) noexcept
+            : mesh(mesh)
+            , number(number)
+            , shape(shape) {}
+
+        Bounds3f objectBound() const;
+        Bounds3f worldBound() const;
+
+        Optional<HitRecord> intersect(const Ray& ray,
+                                      const bool testAlphaTexture) const;
+        bool intersectP(const Ray& ray, const bool testAlphaTexture) const;
+
+        // The rays of a packet are intersected with the same vertices,
+        // fetched once, with the same test as the single-ray functions
+        void intersectPacket(const std::span<const Ray> rays,
+                             const std::uint32_t activeMask,
+                             const std::span<Optional<HitRecord>> hits,
+                             const bool testAlphaTexture) const;
+        std::uint32_t intersectPacketP(const std::span<const Ray> rays,
+                                       const std::uint32_t activeMask,
+                                       const bool testAlphaTexture) const;
+
+        Float area() const;
+
+    private:
+        template <typename R, typename S, typename F>
+        R intersectImpl(const Ray& ray,
+                        const VerticesCoordinates& vertices,
+                        const bool testAlphaTexture,
+                        F failure,
+                        S success) const;
+
+        Optional<PartialDerivatives> computePartialDerivatives() const;
+
+        HitRecord makeHitRecord(const Ray& ray,
+                                const Float t,
+                                const Point3f& hitPoint,
+                                const Vector3f& pError,
+                                const Point2f& hitPointUV,
+                                const PartialDerivatives& derivatives,
+                                const Float barycentric[3]) const;
+        void setShadingGeometry(SurfaceInteraction& interaction,
+                                const Float barycentric[3]) const;
+
+        VerticesCoordinates verticesCoordinates() const;
+        std::array<std::size_t, 3> verticesIndices() const;
+        std::array<Point2f, 3> verticesUVs() const;
+
+        // shears only the x and y dimensions
+        static RayCoordinateSpaceVertices
+        verticesInRayCoordinateSpace(const VerticesCoordinates& vertices,
+                                     const Ray& ray);
+
+        static std::array<Float, 3> edgeFunctionValues(const Point3f& p0,
+                                                       const Point3f& p1,
+                                                       const Point3f& p2);
+
+    private:
+        const TriangleMesh& mesh;
+        unsigned number = 0;
+        const Shape& shape;
+    };
+} // namespace idragnev::pbrt::shapes::detail
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "pbrt/shapes/TriangleMeshShape.hpp"
+#include "MeshTriangle.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/math/Point3.hpp"
+
+namespace idragnev::pbrt::shapes {
+    TriangleMeshShape::TriangleMeshShape(
+        const Transformation& objectToWorld,
+        const Transformation& worldToObject,
+        const bool reverseOrientation,
+        std::shared_ptr<const TriangleMesh> mesh)
+        : Shape(objectToWorld, worldToObject, reverseOrientation)
+        , _mesh(std::move(mesh)) {}
+
+    Bounds3f TriangleMeshShape::objectBound() const {
+        Bounds3f result;
+        for (const Point3f& p : _mesh->vertexWorldCoordinates) {
+            result = unionOf(result, (*worldToObjectTransform)(p));
+        }
+
+        return result;
+    }
+
+    Bounds3f TriangleMeshShape::worldBound() const {
+        Bounds3f result;
+        for (const Point3f& p : _mesh->vertexWorldCoordinates) {
+            result = unionOf(result, p);
+        }
+
+        return result;
+    }
+
+    Optional<HitRecord>
+    TriangleMeshShape::intersect(const Ray& ray,
+                                 const bool testAlphaTexture) const {
+        Optional<HitRecord> result = pbrt::nullopt;
+
+        // shrink the ray after each hit, so the closest one is kept
+        Ray closestHitRay = ray;
+        for (unsigned i = 0; i < _mesh->trianglesCount; ++i) {
+            auto hit = detail::MeshTriangle{*_mesh, i, *this}.intersect(
+                closestHitRay,
+                testAlphaTexture);
+            if (hit.has_value()) {
+                closestHitRay.tMax = hit->t;
+                result = std::move(hit);
+            }
+        }
+
+        return result;
+    }
+
+    bool TriangleMeshShape::intersectP(const Ray& ray,
+                                       const bool testAlphaTexture) const {
+        for (unsigned i = 0; i < _mesh->trianglesCount; ++i) {
+            if (detail::MeshTriangle{*_mesh, i, *this}.intersectP(
+                    ray,
+                    testAlphaTexture)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    Float TriangleMeshShape::area() const {
+        Float result = 0.f;
+        for (unsigned i = 0; i < _mesh->trianglesCount; ++i) {
+            result += detail::MeshTriangle{*_mesh, i, *this}.area();
+        }
+
+        return result;
+    }
+
+    std::uint32_t TriangleMeshShape::partsCount() const {
+        return _mesh->trianglesCount;
+    }
+
+    Bounds3f
+    TriangleMeshShape::partWorldBound(const std::uint32_t triangle) const {
+        return detail::MeshTriangle{*_mesh, triangle, *this}.worldBound();
+    }
+
+    Optional<HitRecord>
+    TriangleMeshShape::intersectPart(const Ray& ray,
+                                     const std::uint32_t triangle,
+                                     const bool testAlphaTexture) const {
+        return detail::MeshTriangle{*_mesh, triangle, *this}.intersect(
+            ray,
+            testAlphaTexture);
+    }
+
+    bool TriangleMeshShape::intersectPartP(const Ray& ray,
+                                           const std::uint32_t triangle,
+                                           const bool testAlphaTexture) const {
+        return detail::MeshTriangle{*_mesh, triangle, *this}.intersectP(
+            ray,
+            testAlphaTexture);
+    }
+
+    void TriangleMeshShape::intersectPartPacket(
+        const std::span<const Ray> rays,
+        const std::uint32_t triangle,
+        const std::uint32_t activeMask,
+        const std::span<Optional<HitRecord>> hits,
+        const bool testAlphaTexture) const {
+        detail::MeshTriangle{*_mesh, triangle, *this}.intersectPacket(
+            rays,
+            activeMask,
+            hits,
+            testAlphaTexture);
+    }
+
+    std::uint32_t TriangleMeshShape::intersectPartPacketP(
+        const std::span<const Ray> rays,
+        const std::uint32_t triangle,
+        const std::uint32_t activeMask,
+        const bool testAlphaTexture) const {
+        return detail::MeshTriangle{*_mesh, triangle, *this}.intersectPacketP(
+            rays,
+            activeMask,
+            testAlphaTexture);
+    }
+
+    std::shared_ptr<TriangleMeshShape> createTriangleMeshShape(
+        const Transformation& objectToWorld,
+        const Transformation& worldToObject,
+        const bool reverseOrientation,
+        const unsigned trianglesCount,
+        const std::vector<std::size_t>& vertexIndices,
+        const std::vector<Point3f>& vertexCoordinates,
+        const std::vector<Vector3f>& vertexTangentVectors,
+        const std::vector<Normal3f>& vertexNormalVectors,
+        const std::vector<Point2f>& vertexUVs,
+        std::shared_ptr<const Texture<Float>> alphaMask,
+        std::shared_ptr<const Texture<Float>> shadowAlphaMask,
+        const std::vector<std::size_t>& faceIndices,
+        const MeshStorage storage) {
+        auto mesh = std::make_shared<TriangleMesh>(objectToWorld,
+                                                   trianglesCount,
+                                                   vertexIndices,
+                                                   vertexCoordinates,
+                                                   vertexTangentVectors,
+                                                   vertexNormalVectors,
+                                                   vertexUVs,
+                                                   std::move(alphaMask),
+                                                   std::move(shadowAlphaMask),
+                                                   faceIndices,
+                                                   storage);
+
+        return std::make_shared<TriangleMeshShape>(objectToWorld,
+                                                   worldToObject,
+                                                   reverseOrientation,
+                                                   std::move(mesh));
+    }
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "doctest/doctest.h"
+
+#include "testScenes.hpp"
+
+namespace pbrt = idragnev::pbrt;
+
+using pbrt::accelerators::BVH;
+using pbrt::tests::NodeLayout;
+
+namespace {
+    void checkMatchesBruteForce(const pbrt::tests::Primitives& primitives,
+                                const std::vector<pbrt::Ray>& rays,
+                                const NodeLayout layout) {
+        for (const auto splitMethod : pbrt::tests::ALL_SPLIT_METHODS) {
+            for (const std::uint32_t maxPrimitivesInNode : {1u, 4u}) {
+                const BVH bvh(primitives,
+                              splitMethod,
+                              maxPrimitivesInNode,
+                              pbrt::memory::PageSize::Default,
+                              layout);
+
+                for (const pbrt::Ray& ray : rays) {
+                    const pbrt::tests::Hit expected =
+                        pbrt::tests::bruteForceIntersect(primitives, ray);
+                    CHECK(pbrt::tests::intersect(bvh, ray) == expected);
+                    CHECK(bvh.intersectP(ray) == expected.found);
+                }
+            }
+        }
+    }
+} // namespace
+
+TEST_CASE("bvh intersections match testing every primitive") {
+    const pbrt::tests::ParallelScope parallelScope;
+    pbrt::rng::RNG rng;
+    const auto primitives = pbrt::tests::triangleSoup(300, rng);
+    const auto rays = pbrt::tests::testRays(primitives, 800, rng);
+
+    SUBCASE("binary") {
+        checkMatchesBruteForce(primitives, rays, NodeLayout::Binary);
+    }
+    SUBCASE("wide4") {
+        checkMatchesBruteForce(primitives, rays, NodeLayout::Wide4);
+    }
+    SUBCASE("wide8") {
+        checkMatchesBruteForce(primitives, rays, NodeLayout::Wide8);
+    }
+}
+
+TEST_CASE("bvh with a single primitive") {
+    const pbrt::tests::ParallelScope parallelScope;
+    pbrt::rng::RNG rng;
+    const auto primitives = pbrt::tests::triangleSoup(1, rng);
+    const auto rays = pbrt::tests::testRays(primitives, 200, rng);
+
+    for (const auto layout : pbrt::tests::ALL_LAYOUTS) {
+        const BVH bvh(primitives,
+                      pbrt::tests::SplitMethod::SAH,
+                      1,
+                      pbrt::memory::PageSize::Default,
+                      layout);
+
+        CHECK(bvh.worldBound() == primitives[0]->worldBound());
+        for (const pbrt::Ray& ray : rays) {
+            const pbrt::tests::Hit expected =
+                pbrt::tests::bruteForceIntersect(primitives, ray);
+            CHECK(pbrt::tests::intersect(bvh, ray) == expected);
+            CHECK(bvh.intersectP(ray) == expected.found);
+        }
+    }
+}
+
+TEST_CASE("empty bvh is never hit") {
+    const pbrt::tests::ParallelScope parallelScope;
+    pbrt::rng::RNG rng;
+    const auto rays = pbrt::tests::randomRays(100, rng);
+
+    for (const auto layout : pbrt::tests::ALL_LAYOUTS) {
+        const BVH bvh({},
+                      pbrt::tests::SplitMethod::SAH,
+                      1,
+                      pbrt::memory::PageSize::Default,
+                      layout);
+
+        for (const pbrt::Ray& ray : rays) {
+            CHECK_FALSE(bvh.intersect(ray).has_value());
+            CHECK_FALSE(bvh.intersectP(ray));
+        }
+    }
+}
\ No newline at end of file
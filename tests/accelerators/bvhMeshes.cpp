@@ -0,0 +1,138 @@
+#include "doctest/doctest.h"
+
+#include "testScenes.hpp"
+#include "pbrt/shapes/TriangleMeshShape.hpp"
+
+#include <array>
+
+namespace pbrt = idragnev::pbrt;
+namespace shapes = idragnev::pbrt::shapes;
+
+using pbrt::accelerators::BVH;
+
+namespace {
+    // The hits of a mesh shape are those of its triangle shapes,
+    // only the primitive differs
+    void checkSameHits(const pbrt::tests::Hit& meshHit,
+                       const pbrt::tests::Hit& trianglesHit) {
+        REQUIRE(meshHit.found == trianglesHit.found);
+        CHECK(meshHit.t == trianglesHit.t);
+        CHECK(meshHit.p == trianglesHit.p);
+    }
+
+    void checkRays(const BVH& meshBVH,
+                   const pbrt::Primitive& mesh,
+                   const BVH& trianglesBVH,
+                   const std::vector<pbrt::Ray>& rays) {
+        for (const pbrt::Ray& ray : rays) {
+            const pbrt::tests::Hit meshHit =
+                pbrt::tests::intersect(meshBVH, ray);
+            checkSameHits(meshHit, pbrt::tests::intersect(trianglesBVH, ray));
+            CHECK(meshBVH.intersectP(ray) == meshHit.found);
+            if (meshHit.found) {
+                CHECK(meshHit.primitive == &mesh);
+            }
+        }
+    }
+
+    // Traced with Primitive::intersectPartPacket
+    void checkPackets(const BVH& meshBVH,
+                      const BVH& trianglesBVH,
+                      const std::vector<pbrt::Ray>& rays) {
+        using Hits = std::array<pbrt::Optional<pbrt::SurfaceInteraction>, 8>;
+
+        for (std::size_t first = 0; first + 8 <= rays.size(); first += 8) {
+            std::array<pbrt::Ray, 8> packet;
+            for (std::size_t i = 0; i < 8; ++i) {
+                packet[i] = rays[first + i];
+            }
+
+            Hits hits;
+            meshBVH.intersect8(packet, hits);
+            const std::uint32_t occluded = meshBVH.intersectP8(
+                std::span<const pbrt::Ray, 8>{rays.data() + first, 8});
+
+            for (std::size_t i = 0; i < 8; ++i) {
+                const pbrt::tests::Hit expected =
+                    pbrt::tests::intersect(trianglesBVH, rays[first + i]);
+                checkSameHits(pbrt::tests::toHit(hits[i], packet[i]),
+                              expected);
+                CHECK((((occluded >> i) & 1u) != 0) == expected.found);
+            }
+        }
+    }
+} // namespace
+
+TEST_CASE("bvhs of mesh shapes match bvhs of triangle shapes") {
+    const pbrt::tests::ParallelScope parallelScope;
+    pbrt::rng::RNG rng;
+    constexpr unsigned trianglesCount = 300;
+    const auto vertices =
+        pbrt::tests::triangleSoupVertices(trianglesCount, rng);
+    const auto indices = pbrt::tests::soupIndices(trianglesCount);
+
+    const pbrt::Transformation identity;
+    const auto triangleShapes = shapes::createTriangleMesh(identity,
+                                                           identity,
+                                                           false,
+                                                           trianglesCount,
+                                                           indices,
+                                                           vertices,
+                                                           {},
+                                                           {},
+                                                           {},
+                                                           nullptr,
+                                                           nullptr,
+                                                           {});
+    const auto meshShape = shapes::createTriangleMeshShape(identity,
+                                                           identity,
+                                                           false,
+                                                           trianglesCount,
+                                                           indices,
+                                                           vertices,
+                                                           {},
+                                                           {},
+                                                           {},
+                                                           nullptr,
+                                                           nullptr,
+                                                           {});
+
+    pbrt::tests::Primitives triangles;
+    for (const auto& triangle : triangleShapes) {
+        triangles.push_back(pbrt::tests::geometricPrimitive(triangle));
+    }
+    const pbrt::tests::Primitives mesh = {
+        pbrt::tests::geometricPrimitive(meshShape)};
+
+    SUBCASE("the triangles are the parts of the mesh") {
+        REQUIRE(meshShape->partsCount() == trianglesCount);
+        for (std::uint32_t i = 0; i < trianglesCount; ++i) {
+            CHECK(meshShape->partWorldBound(i) ==
+                  triangleShapes[i]->worldBound());
+        }
+    }
+
+    SUBCASE("the hits are those of the triangles") {
+        const auto rays = pbrt::tests::testRays(triangles, 512, rng);
+
+        for (const auto layout : pbrt::tests::ALL_LAYOUTS) {
+            for (const auto splitMethod : {pbrt::tests::SplitMethod::SAH,
+                                           pbrt::tests::SplitMethod::HLBVH}) {
+                const BVH trianglesBVH(triangles,
+                                       splitMethod,
+                                       4,
+                                       pbrt::memory::PageSize::Default,
+                                       layout);
+                const BVH meshBVH(mesh,
+                                  splitMethod,
+                                  4,
+                                  pbrt::memory::PageSize::Default,
+                                  layout);
+
+                CHECK(meshBVH.worldBound() == trianglesBVH.worldBound());
+                checkRays(meshBVH, *mesh[0], trianglesBVH, rays);
+                checkPackets(meshBVH, trianglesBVH, rays);
+            }
+        }
+    }
+}
\ No newline at end of file
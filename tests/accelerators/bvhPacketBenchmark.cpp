@@ -0,0 +1,238 @@
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/shapes/TriangleMeshShape.hpp"
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/math/Point3.hpp"
+#include "pbrt/core/math/Point2.hpp"
+#include "pbrt/core/math/Vector3.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// Traces the camera rays of an image of a triangulated height field
+// one by one and as packets of 2x2, 4x2 and 4x4 neighbouring pixels,
+// and compares the time per ray of intersect and intersectP.
+// usage: accelerators_bvh_packet_benchmark [gridSize] [imageSize]
+
+namespace pbrt = idragnev::pbrt;
+namespace memory = idragnev::pbrt::memory;
+namespace shapes = idragnev::pbrt::shapes;
+namespace parallel = idragnev::pbrt::parallel;
+
+using Clock = std::chrono::steady_clock;
+using NodeLayout = pbrt::accelerators::bvh::NodeLayout;
+
+std::shared_ptr<const pbrt::Primitive>
+heightField(const std::size_t gridSize,
+            const pbrt::Transformation& identity) {
+    std::vector<pbrt::Point3f> vertices;
+    std::vector<pbrt::Point2f> uvs;
+    for (std::size_t j = 0; j <= gridSize; ++j) {
+        for (std::size_t i = 0; i <= gridSize; ++i) {
+            const auto x = static_cast<pbrt::Float>(i) / gridSize;
+            const auto y = static_cast<pbrt::Float>(j) / gridSize;
+            vertices.emplace_back(x,
+                                  y,
+                                  0.05f * std::sin(20.f * x) *
+                                      std::cos(20.f * y));
+            uvs.emplace_back(x, y);
+        }
+    }
+
+    std::vector<std::size_t> indices;
+    const std::size_t rowSize = gridSize + 1;
+    for (std::size_t j = 0; j < gridSize; ++j) {
+        for (std::size_t i = 0; i < gridSize; ++i) {
+            const std::size_t v = j * rowSize + i;
+            indices.insert(indices.end(),
+                           {v, v + 1, v + rowSize, v + 1, v + rowSize + 1,
+                            v + rowSize});
+        }
+    }
+
+    auto mesh = shapes::createTriangleMeshShape(
+        identity,
+        identity,
+        false,
+        static_cast<unsigned>(2 * gridSize * gridSize),
+        indices,
+        vertices,
+        {},
+        {},
+        uvs,
+        nullptr,
+        nullptr,
+        {});
+
+    return std::make_shared<pbrt::GeometricPrimitive>(std::move(mesh),
+                                                      nullptr,
+                                                      nullptr,
+                                                      pbrt::MediumInterface{});
+}
+
+// The rays of a pinhole camera looking down at the height field
+pbrt::Ray cameraRay(const std::size_t x,
+                    const std::size_t y,
+                    const std::size_t imageSize) {
+    const pbrt::Point3f eye(0.5f, -0.4f, 0.8f);
+    const auto u = (static_cast<pbrt::Float>(x) + 0.5f) / imageSize;
+    const auto v = (static_cast<pbrt::Float>(y) + 0.5f) / imageSize;
+    const pbrt::Point3f target(u, v, 0.f);
+
+    return pbrt::Ray(eye, target - eye);
+}
+
+// Traces the image in tiles of `Width`x`Height` pixels with `trace`,
+// which is called with the rays of a tile
+template <std::size_t Width, std::size_t Height, typename F>
+double traceTiles(const std::size_t imageSize, F trace) {
+    std::array<pbrt::Ray, Width * Height> rays;
+
+    const auto start = Clock::now();
+    for (std::size_t y = 0; y < imageSize; y += Height) {
+        for (std::size_t x = 0; x < imageSize; x += Width) {
+            for (std::size_t i = 0; i < Width * Height; ++i) {
+                rays[i] = cameraRay(x + i % Width, y + i / Width, imageSize);
+            }
+            trace(rays);
+        }
+    }
+    const auto elapsed =
+        std::chrono::duration<double, std::nano>(Clock::now() - start);
+
+    return elapsed.count() / static_cast<double>(imageSize * imageSize);
+}
+
+template <std::size_t Width, std::size_t Height>
+void benchmarkPackets(const pbrt::accelerators::BVH& bvh,
+                      const std::size_t imageSize,
+                      const char* const name) {
+    constexpr std::size_t K = Width * Height;
+
+    std::size_t hitsCount = 0;
+    const double closest = traceTiles<Width, Height>(
+        imageSize,
+        [&bvh, &hitsCount](const std::array<pbrt::Ray, K>& rays) {
+            std::array<pbrt::Optional<pbrt::SurfaceInteraction>, K> hits;
+            if constexpr (K == 4) {
+                bvh.intersect4(rays, hits);
+            }
+            else if constexpr (K == 8) {
+                bvh.intersect8(rays, hits);
+            }
+            else {
+                bvh.intersect16(rays, hits);
+            }
+            for (const auto& hit : hits) {
+                hitsCount += hit.has_value() ? 1 : 0;
+            }
+        });
+
+    std::size_t occludedCount = 0;
+    const double any = traceTiles<Width, Height>(
+        imageSize,
+        [&bvh, &occludedCount](const std::array<pbrt::Ray, K>& rays) {
+            std::uint32_t occluded = 0;
+            if constexpr (K == 4) {
+                occluded = bvh.intersectP4(rays);
+            }
+            else if constexpr (K == 8) {
+                occluded = bvh.intersectP8(rays);
+            }
+            else {
+                occluded = bvh.intersectP16(rays);
+            }
+            occludedCount += static_cast<std::size_t>(std::popcount(occluded));
+        });
+
+    std::printf("  %-8s %10.1f ns/ray %10.1f ns/shadow ray %8zu hits %8zu "
+                "occluded\n",
+                name,
+                closest,
+                any,
+                hitsCount,
+                occludedCount);
+}
+
+void benchmarkSingleRays(const pbrt::accelerators::BVH& bvh,
+                         const std::size_t imageSize) {
+    std::size_t hitsCount = 0;
+    const double closest = traceTiles<1, 1>(
+        imageSize,
+        [&bvh, &hitsCount](const std::array<pbrt::Ray, 1>& rays) {
+            hitsCount += bvh.intersect(rays[0]).has_value() ? 1 : 0;
+        });
+
+    std::size_t occludedCount = 0;
+    const double any = traceTiles<1, 1>(
+        imageSize,
+        [&bvh, &occludedCount](const std::array<pbrt::Ray, 1>& rays) {
+            occludedCount += bvh.intersectP(rays[0]) ? 1 : 0;
+        });
+
+    std::printf("  %-8s %10.1f ns/ray %10.1f ns/shadow ray %8zu hits %8zu "
+                "occluded\n",
+                "single",
+                closest,
+                any,
+                hitsCount,
+                occludedCount);
+}
+
+const char* toString(const NodeLayout layout) {
+    switch (layout) {
+        case NodeLayout::Binary: return "binary";
+        case NodeLayout::Wide4: return "wide4";
+        case NodeLayout::Wide8: return "wide8";
+        case NodeLayout::QuantizedWide4: return "qwide4";
+        case NodeLayout::QuantizedWide8: return "qwide8";
+    }
+
+    return "unknown";
+}
+
+int main(int argc, char** argv) {
+    const std::size_t gridSize =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 700;
+    const std::size_t imageSize =
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024;
+
+    parallel::init();
+
+    const pbrt::Transformation identity;
+    const auto field = heightField(gridSize, identity);
+
+    std::printf("%zu triangles, %zux%zu rays\n",
+                2 * gridSize * gridSize,
+                imageSize,
+                imageSize);
+    for (const auto layout :
+         {NodeLayout::Binary, NodeLayout::Wide4, NodeLayout::Wide8}) {
+        const pbrt::accelerators::BVH bvh(
+            {field},
+            pbrt::accelerators::bvh::SplitMethod::SAH,
+            4,
+            memory::PageSize::Default,
+            layout);
+
+        std::printf("%s\n", toString(layout));
+        benchmarkSingleRays(bvh, imageSize);
+        benchmarkPackets<2, 2>(bvh, imageSize, "2x2");
+        benchmarkPackets<4, 2>(bvh, imageSize, "4x2");
+        benchmarkPackets<4, 4>(bvh, imageSize, "4x4");
+    }
+
+    parallel::cleanup();
+
+    return 0;
+}
\ No newline at end of file
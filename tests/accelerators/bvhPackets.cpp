@@ -0,0 +1,161 @@
+#include "doctest/doctest.h"
+
+#include "testScenes.hpp"
+
+#include <array>
+
+namespace pbrt = idragnev::pbrt;
+
+using pbrt::accelerators::BVH;
+using pbrt::tests::NodeLayout;
+using Hits4 = std::span<pbrt::Optional<pbrt::SurfaceInteraction>, 4>;
+using Hits8 = std::span<pbrt::Optional<pbrt::SurfaceInteraction>, 8>;
+using Hits16 = std::span<pbrt::Optional<pbrt::SurfaceInteraction>, 16>;
+
+namespace {
+    void intersectPacket(const BVH& bvh,
+                         const std::span<const pbrt::Ray, 4> rays,
+                         const Hits4 hits,
+                         const std::uint32_t activeMask) {
+        bvh.intersect4(rays, hits, activeMask);
+    }
+    void intersectPacket(const BVH& bvh,
+                         const std::span<const pbrt::Ray, 8> rays,
+                         const Hits8 hits,
+                         const std::uint32_t activeMask) {
+        bvh.intersect8(rays, hits, activeMask);
+    }
+    void intersectPacket(const BVH& bvh,
+                         const std::span<const pbrt::Ray, 16> rays,
+                         const Hits16 hits,
+                         const std::uint32_t activeMask) {
+        bvh.intersect16(rays, hits, activeMask);
+    }
+
+    std::uint32_t intersectPPacket(const BVH& bvh,
+                                   const std::span<const pbrt::Ray, 4> rays,
+                                   const std::uint32_t activeMask) {
+        return bvh.intersectP4(rays, activeMask);
+    }
+    std::uint32_t intersectPPacket(const BVH& bvh,
+                                   const std::span<const pbrt::Ray, 8> rays,
+                                   const std::uint32_t activeMask) {
+        return bvh.intersectP8(rays, activeMask);
+    }
+    std::uint32_t intersectPPacket(const BVH& bvh,
+                                   const std::span<const pbrt::Ray, 16> rays,
+                                   const std::uint32_t activeMask) {
+        return bvh.intersectP16(rays, activeMask);
+    }
+
+    // Packets of rays from a common origin towards a small patch,
+    // as those of neighbouring pixels
+    std::vector<pbrt::Ray> coherentRays(const std::size_t packetsCount,
+                                        const std::size_t packetSize,
+                                        pbrt::rng::RNG& rng) {
+        std::vector<pbrt::Ray> rays;
+        for (std::size_t i = 0; i < packetsCount; ++i) {
+            const pbrt::Point3f o =
+                3.f * pbrt::tests::randomPoint(rng) -
+                pbrt::Vector3f(1.f, 1.f, 1.f);
+            const pbrt::Point3f center = pbrt::tests::randomPoint(rng);
+            for (std::size_t j = 0; j < packetSize; ++j) {
+                const pbrt::Vector3f jitter =
+                    pbrt::tests::randomPoint(rng) -
+                    pbrt::Point3f(0.5f, 0.5f, 0.5f);
+                rays.emplace_back(o, center + 0.05f * jitter - o);
+            }
+        }
+
+        return rays;
+    }
+
+    // The packets of consecutive rays are traced with all rays active,
+    // with a random subset of them, with a single one and with none.
+    // The hits of the active rays must be those of intersect and the
+    // inactive rays and their hits must be left as they were.
+    template <std::size_t K>
+    void checkPackets(const BVH& bvh,
+                      const std::vector<pbrt::Ray>& rays,
+                      pbrt::rng::RNG& rng) {
+        constexpr std::uint32_t allRays = (1u << K) - 1u;
+
+        pbrt::SurfaceInteraction untouched;
+        untouched.p = pbrt::Point3f(-10.f, -10.f, -10.f);
+
+        for (std::size_t first = 0; first + K <= rays.size(); first += K) {
+            const std::uint32_t masks[] = {
+                allRays,
+                rng.uniformUInt32(allRays + 1u),
+                1u << rng.uniformUInt32(K),
+                0u,
+            };
+
+            for (const std::uint32_t activeMask : masks) {
+                std::array<pbrt::Ray, K> packet;
+                std::array<pbrt::Optional<pbrt::SurfaceInteraction>, K> hits;
+                for (std::size_t i = 0; i < K; ++i) {
+                    packet[i] = rays[first + i];
+                    hits[i] = untouched;
+                }
+
+                intersectPacket(bvh, packet, hits, activeMask);
+                const std::uint32_t occluded = intersectPPacket(
+                    bvh,
+                    std::span<const pbrt::Ray, K>{rays.data() + first, K},
+                    activeMask);
+
+                for (std::size_t i = 0; i < K; ++i) {
+                    const pbrt::Ray& ray = rays[first + i];
+                    if ((activeMask & (1u << i)) == 0) {
+                        REQUIRE(hits[i].has_value());
+                        CHECK(hits[i]->p == untouched.p);
+                        CHECK(packet[i].tMax == ray.tMax);
+                        CHECK((occluded & (1u << i)) == 0);
+                        continue;
+                    }
+
+                    const pbrt::tests::Hit expected =
+                        pbrt::tests::intersect(bvh, ray);
+                    CHECK(pbrt::tests::toHit(hits[i], packet[i]) ==
+                          expected);
+                    CHECK(((occluded & (1u << i)) != 0) == expected.found);
+                }
+            }
+        }
+    }
+
+    void checkAllPacketSizes(const pbrt::tests::Primitives& primitives,
+                             const std::vector<pbrt::Ray>& rays,
+                             const NodeLayout layout,
+                             pbrt::rng::RNG& rng) {
+        for (const auto splitMethod : {pbrt::tests::SplitMethod::SAH,
+                                       pbrt::tests::SplitMethod::HLBVH}) {
+            const BVH bvh(primitives,
+                          splitMethod,
+                          4,
+                          pbrt::memory::PageSize::Default,
+                          layout);
+
+            checkPackets<4>(bvh, rays, rng);
+            checkPackets<8>(bvh, rays, rng);
+            checkPackets<16>(bvh, rays, rng);
+        }
+    }
+} // namespace
+
+TEST_CASE("bvh packets match tracing their rays one by one") {
+    const pbrt::tests::ParallelScope parallelScope;
+    pbrt::rng::RNG rng;
+    const auto primitives = pbrt::tests::triangleSoup(300, rng);
+
+    // the random rays mix all directions in a packet
+    auto rays = pbrt::tests::testRays(primitives, 512, rng);
+    for (const pbrt::Ray& ray : coherentRays(32, 16, rng)) {
+        rays.push_back(ray);
+    }
+
+    for (const auto layout : pbrt::tests::ALL_LAYOUTS) {
+        checkAllPacketSizes(primitives, rays, layout, rng);
+    }
+}
\ No newline at end of file
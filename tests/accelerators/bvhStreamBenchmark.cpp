@@ -0,0 +1,215 @@
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/shapes/TriangleMeshShape.hpp"
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/math/Point3.hpp"
+#include "pbrt/core/math/Point2.hpp"
+#include "pbrt/core/math/Vector3.hpp"
+#include "pbrt/core/math/Normal3.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <span>
+#include <vector>
+
+// Traces the diffuse bounces of the camera rays of an image of
+// a rugged triangulated height field one by one and as streams of
+// several sizes, and compares the time per ray.
+// usage: accelerators_bvh_stream_benchmark [gridSize] [imageSize]
+
+namespace pbrt = idragnev::pbrt;
+namespace memory = idragnev::pbrt::memory;
+namespace shapes = idragnev::pbrt::shapes;
+namespace parallel = idragnev::pbrt::parallel;
+namespace math = idragnev::pbrt::math;
+
+using Clock = std::chrono::steady_clock;
+using NodeLayout = pbrt::accelerators::bvh::NodeLayout;
+
+namespace constants {
+    // Moves the origins of the bounces off the surface
+    inline constexpr pbrt::Float BOUNCE_OFFSET = 1e-4f;
+} // namespace constants
+
+std::shared_ptr<const pbrt::Primitive>
+heightField(const std::size_t gridSize,
+            const pbrt::Transformation& identity) {
+    std::vector<pbrt::Point3f> vertices;
+    for (std::size_t j = 0; j <= gridSize; ++j) {
+        for (std::size_t i = 0; i <= gridSize; ++i) {
+            const auto x = static_cast<pbrt::Float>(i) / gridSize;
+            const auto y = static_cast<pbrt::Float>(j) / gridSize;
+            // steep hills, so many bounces hit the field again
+            vertices.emplace_back(x,
+                                  y,
+                                  0.1f * std::sin(40.f * x) *
+                                      std::cos(40.f * y));
+        }
+    }
+
+    std::vector<std::size_t> indices;
+    const std::size_t rowSize = gridSize + 1;
+    for (std::size_t j = 0; j < gridSize; ++j) {
+        for (std::size_t i = 0; i < gridSize; ++i) {
+            const std::size_t v = j * rowSize + i;
+            indices.insert(indices.end(),
+                           {v, v + 1, v + rowSize, v + 1, v + rowSize + 1,
+                            v + rowSize});
+        }
+    }
+
+    auto mesh = shapes::createTriangleMeshShape(
+        identity,
+        identity,
+        false,
+        static_cast<unsigned>(2 * gridSize * gridSize),
+        indices,
+        vertices,
+        {},
+        {},
+        {},
+        nullptr,
+        nullptr,
+        {});
+
+    return std::make_shared<pbrt::GeometricPrimitive>(std::move(mesh),
+                                                      nullptr,
+                                                      nullptr,
+                                                      pbrt::MediumInterface{});
+}
+
+// The diffuse bounces of the camera rays which hit the height field,
+// in the order of their pixels
+std::vector<pbrt::Ray> diffuseBounces(const pbrt::accelerators::BVH& bvh,
+                                      const std::size_t imageSize) {
+    std::mt19937 rng(2020);
+    std::normal_distribution<pbrt::Float> gaussian;
+
+    std::vector<pbrt::Ray> result;
+    const pbrt::Point3f eye(0.5f, -0.4f, 0.8f);
+    for (std::size_t y = 0; y < imageSize; ++y) {
+        for (std::size_t x = 0; x < imageSize; ++x) {
+            const pbrt::Point3f target(
+                (static_cast<pbrt::Float>(x) + 0.5f) / imageSize,
+                (static_cast<pbrt::Float>(y) + 0.5f) / imageSize,
+                0.f);
+            const pbrt::Ray ray(eye, target - eye);
+            const auto hit = bvh.intersect(ray);
+            if (!hit.has_value()) {
+                continue;
+            }
+
+            // a cosine distributed direction around the normal facing
+            // the camera
+            const pbrt::Vector3f n = math::normalize(
+                math::faceforward(pbrt::Vector3f(hit->n), -ray.d));
+            const pbrt::Vector3f sphere = math::normalize(
+                pbrt::Vector3f(gaussian(rng), gaussian(rng), gaussian(rng)));
+            result.emplace_back(hit->p + constants::BOUNCE_OFFSET * n,
+                                n + sphere);
+        }
+    }
+
+    return result;
+}
+
+void benchmarkSingleRays(const pbrt::accelerators::BVH& bvh,
+                         std::vector<pbrt::Ray> rays) {
+    std::size_t hitsCount = 0;
+
+    const auto start = Clock::now();
+    for (const pbrt::Ray& ray : rays) {
+        hitsCount += bvh.intersect(ray).has_value() ? 1 : 0;
+    }
+    const auto elapsed =
+        std::chrono::duration<double, std::nano>(Clock::now() - start);
+
+    std::printf("  %-14s %10.1f ns/ray %8zu hits\n",
+                "single",
+                elapsed.count() / static_cast<double>(rays.size()),
+                hitsCount);
+}
+
+void benchmarkStreams(const pbrt::accelerators::BVH& bvh,
+                      std::vector<pbrt::Ray> rays,
+                      const std::size_t streamSize) {
+    std::vector<pbrt::Optional<pbrt::SurfaceInteraction>> hits(rays.size());
+
+    const auto start = Clock::now();
+    for (std::size_t first = 0; first < rays.size(); first += streamSize) {
+        const std::size_t count = std::min(streamSize, rays.size() - first);
+        bvh.intersect(std::span<const pbrt::Ray>{rays}.subspan(first, count),
+                      std::span{hits}.subspan(first, count));
+    }
+    const auto elapsed =
+        std::chrono::duration<double, std::nano>(Clock::now() - start);
+
+    const auto hitsCount = std::count_if(hits.begin(),
+                                         hits.end(),
+                                         [](const auto& hit) {
+                                             return hit.has_value();
+                                         });
+    char name[32];
+    std::snprintf(name, sizeof(name), "stream %zu", streamSize);
+    std::printf("  %-14s %10.1f ns/ray %8td hits\n",
+                name,
+                elapsed.count() / static_cast<double>(rays.size()),
+                hitsCount);
+}
+
+const char* toString(const NodeLayout layout) {
+    switch (layout) {
+        case NodeLayout::Binary: return "binary";
+        case NodeLayout::Wide4: return "wide4";
+        case NodeLayout::Wide8: return "wide8";
+        case NodeLayout::QuantizedWide4: return "qwide4";
+        case NodeLayout::QuantizedWide8: return "qwide8";
+    }
+
+    return "unknown";
+}
+
+int main(int argc, char** argv) {
+    const std::size_t gridSize =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 700;
+    const std::size_t imageSize =
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024;
+
+    parallel::init();
+
+    const pbrt::Transformation identity;
+    const auto field = heightField(gridSize, identity);
+
+    for (const auto layout :
+         {NodeLayout::Binary, NodeLayout::Wide4, NodeLayout::Wide8}) {
+        const pbrt::accelerators::BVH bvh(
+            {field},
+            pbrt::accelerators::bvh::SplitMethod::SAH,
+            4,
+            memory::PageSize::Default,
+            layout);
+        const std::vector<pbrt::Ray> bounces = diffuseBounces(bvh, imageSize);
+
+        std::printf("%s, %zu triangles, %zu bounces\n",
+                    toString(layout),
+                    2 * gridSize * gridSize,
+                    bounces.size());
+        benchmarkSingleRays(bvh, bounces);
+        for (const std::size_t streamSize : {1024, 16384, 262144}) {
+            benchmarkStreams(bvh, bounces, streamSize);
+        }
+    }
+
+    parallel::cleanup();
+
+    return 0;
+}
\ No newline at end of file
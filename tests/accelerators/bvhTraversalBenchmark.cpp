@@ -0,0 +1,193 @@
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+#include "pbrt/memory/MemoryAccounting.hpp"
+
+#include "perfEventCounter.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Traces incoherent rays through a big BVH with binary, wide and
+// quantized wide nodes, backed by default and by huge pages, and
+// compares the time per ray and the data TLB misses per ray (where
+// perf events are available), along with the memory taken by the nodes.
+// usage: accelerators_bvh_traversal_benchmark [boxesCount] [raysCount]
+
+namespace pbrt = idragnev::pbrt;
+namespace memory = idragnev::pbrt::memory;
+namespace parallel = idragnev::pbrt::parallel;
+namespace benchmarks = idragnev::pbrt::benchmarks;
+
+using Clock = std::chrono::steady_clock;
+using NodeLayout = pbrt::accelerators::bvh::NodeLayout;
+
+namespace constants {
+    // Keeps the rays short, as secondary rays in a dense scene,
+    // so each ray visits a random neighbourhood of the tree.
+    inline constexpr pbrt::Float RAY_EXTENT = 5.f;
+} // namespace constants
+
+// An axis-aligned box with cheap intersection tests, so the
+// benchmark measures the traversal of the nodes.
+class BoxPrimitive : public pbrt::Primitive
+{
+public:
+    explicit BoxPrimitive(const pbrt::Bounds3f& bounds) : bounds(bounds) {}
+
+    pbrt::Bounds3f worldBound() const override { return bounds; }
+
+    pbrt::Optional<pbrt::SurfaceInteraction>
+    intersect(const pbrt::Ray& ray) const override {
+        const auto hit = bounds.intersectP(ray);
+        if (!hit.has_value()) {
+            return pbrt::nullopt;
+        }
+
+        ray.tMax = hit->low();
+        pbrt::SurfaceInteraction interaction;
+        interaction.primitive = this;
+
+        return pbrt::make_optional(std::move(interaction));
+    }
+    bool intersectP(const pbrt::Ray& ray) const override {
+        return bounds.intersectP(ray).has_value();
+    }
+
+    const pbrt::AreaLight* areaLight() const override { return nullptr; }
+    const pbrt::Material* material() const override { return nullptr; }
+    void computeScatteringFunctions(pbrt::SurfaceInteraction&,
+                                    memory::MemoryArena&,
+                                    const pbrt::TransportMode,
+                                    const bool) const override {}
+
+private:
+    pbrt::Bounds3f bounds;
+};
+
+std::vector<std::shared_ptr<const pbrt::Primitive>>
+randomBoxes(const std::size_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<pbrt::Float> position(0.f, 100.f);
+    const pbrt::Vector3f halfExtent(0.05f, 0.05f, 0.05f);
+
+    std::vector<std::shared_ptr<const pbrt::Primitive>> boxes;
+    boxes.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const pbrt::Point3f center(position(rng), position(rng), position(rng));
+        boxes.push_back(std::make_shared<BoxPrimitive>(
+            pbrt::Bounds3f(center - halfExtent, center + halfExtent)));
+    }
+
+    return boxes;
+}
+
+std::vector<pbrt::Ray> randomRays(const std::size_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<pbrt::Float> position(0.f, 100.f);
+    std::uniform_real_distribution<pbrt::Float> direction(-1.f, 1.f);
+
+    std::vector<pbrt::Ray> rays;
+    rays.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        rays.emplace_back(
+            pbrt::Point3f(position(rng), position(rng), position(rng)),
+            pbrt::Vector3f(direction(rng), direction(rng), direction(rng)),
+            constants::RAY_EXTENT);
+    }
+
+    return rays;
+}
+
+const char* toString(const NodeLayout layout) {
+    switch (layout) {
+        case NodeLayout::Binary: return "binary";
+        case NodeLayout::Wide4: return "wide4";
+        case NodeLayout::Wide8: return "wide8";
+        case NodeLayout::QuantizedWide4: return "qwide4";
+        case NodeLayout::QuantizedWide8: return "qwide8";
+    }
+
+    return "unknown";
+}
+
+void benchmark(const std::vector<std::shared_ptr<const pbrt::Primitive>>& boxes,
+               const std::vector<pbrt::Ray>& rays,
+               const NodeLayout layout,
+               const memory::PageSize pageSize) {
+    const pbrt::accelerators::BVH bvh(boxes,
+                                      pbrt::accelerators::bvh::SplitMethod::HLBVH,
+                                      4,
+                                      pageSize,
+                                      layout);
+    // warm up, so both runs start with the nodes in memory
+    for (std::size_t i = 0; i < rays.size() / 10; ++i) {
+        [[maybe_unused]] const bool hit = bvh.intersectP(rays[i]);
+    }
+
+    benchmarks::PerfEventCounter tlbMisses(
+        benchmarks::CacheEvent::DataTLBReadMisses);
+    std::size_t hitsCount = 0;
+
+    const auto start = Clock::now();
+    tlbMisses.start();
+    for (pbrt::Ray ray : rays) {
+        if (bvh.intersect(ray).has_value()) {
+            ++hitsCount;
+        }
+    }
+    const auto misses = tlbMisses.stop();
+    const auto elapsed =
+        std::chrono::duration<double, std::nano>(Clock::now() - start);
+
+    const auto raysCount = static_cast<double>(rays.size());
+    const auto nodesBytes =
+        memory::memoryUsage(memory::MemoryTag::BVHNodes).liveBytes;
+    std::printf("%-8s %-8s %10.1f ns/ray %8.1f MiB nodes",
+                toString(layout),
+                pageSize == memory::PageSize::Huge ? "huge" : "default",
+                elapsed.count() / raysCount,
+                static_cast<double>(nodesBytes) / (1024. * 1024.));
+    if (tlbMisses.isAvailable()) {
+        std::printf(" %10.2f dTLB misses/ray",
+                    static_cast<double>(misses) / raysCount);
+    }
+    else {
+        std::printf("        (dTLB misses n/a)");
+    }
+    std::printf(" %8zu hits\n", hitsCount);
+}
+
+int main(int argc, char** argv) {
+    const std::size_t boxesCount =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    const std::size_t raysCount =
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    parallel::init();
+
+    std::mt19937 rng(2020);
+    const auto boxes = randomBoxes(boxesCount, rng);
+    const auto rays = randomRays(raysCount, rng);
+
+    std::printf("%zu boxes, %zu rays\n", boxesCount, raysCount);
+    for (const auto pageSize :
+         {memory::PageSize::Default, memory::PageSize::Huge}) {
+        for (const auto layout : {NodeLayout::Binary,
+                                  NodeLayout::Wide4,
+                                  NodeLayout::Wide8,
+                                  NodeLayout::QuantizedWide4,
+                                  NodeLayout::QuantizedWide8}) {
+            benchmark(boxes, rays, layout, pageSize);
+        }
+    }
+
+    parallel::cleanup();
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "doctest/doctest.h"
+
+#include "testScenes.hpp"
+#include "QuantizedBVHNode.hpp"
+
+#include <vector>
+
+namespace pbrt = idragnev::pbrt;
+namespace bvh = idragnev::pbrt::accelerators::bvh;
+
+using pbrt::accelerators::BVH;
+using pbrt::tests::NodeLayout;
+
+namespace {
+    template <std::size_t N>
+    bvh::WideBVHNode<N> wideNode(const std::vector<pbrt::Bounds3f>& children) {
+        bvh::WideBVHNode<N> node;
+        for (std::size_t child = 0; child < N; ++child) {
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                // the empty slots are inverted
+                node.bounds[0][axis][child] = pbrt::constants::Infinity;
+                node.bounds[1][axis][child] = -pbrt::constants::Infinity;
+            }
+            node.offsets[child] = 0;
+            node.primitivesCount[child] = 0;
+        }
+
+        for (std::size_t child = 0; child < children.size(); ++child) {
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                node.bounds[0][axis][child] = children[child].min[axis];
+                node.bounds[1][axis][child] = children[child].max[axis];
+            }
+            node.offsets[child] = static_cast<std::uint32_t>(1000 + child);
+            node.primitivesCount[child] =
+                static_cast<std::uint16_t>(child % 2 == 0 ? 0 : child);
+        }
+        node.childrenCount = static_cast<std::uint8_t>(children.size());
+
+        return node;
+    }
+
+    // The quantized bounds of each child contain its bounds and are at
+    // most a step bigger on each side. The empty slots stay inverted.
+    template <std::size_t N>
+    void checkQuantized(const std::vector<pbrt::Bounds3f>& children) {
+        const bvh::WideBVHNode<N> node = wideNode<N>(children);
+        bvh::QuantizedWideBVHNode<N> quantized;
+        bvh::WideBVHQuantizer<N>::quantize(node, quantized);
+
+        REQUIRE(quantized.childrenCount == node.childrenCount);
+        for (std::size_t child = 0; child < N; ++child) {
+            CHECK(quantized.offsets[child] == node.offsets[child]);
+            CHECK(quantized.primitivesCount[child] ==
+                  node.primitivesCount[child]);
+        }
+
+        for (std::size_t child = 0; child < children.size(); ++child) {
+            const pbrt::Bounds3f bounds = quantized.childBounds(child);
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                const pbrt::Float min = children[child].min[axis];
+                const pbrt::Float max = children[child].max[axis];
+                const pbrt::Float step = quantized.stepSize(axis);
+
+                CHECK(std::isfinite(bounds.min[axis]));
+                CHECK(std::isfinite(bounds.max[axis]));
+                CHECK(bounds.min[axis] <= min);
+                CHECK(bounds.max[axis] >= max);
+                CHECK(min - bounds.min[axis] <= step);
+                CHECK(bounds.max[axis] - max <= step);
+            }
+        }
+
+        for (std::size_t child = children.size(); child < N; ++child) {
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                CHECK(quantized.steps[0][axis][child] >
+                      quantized.steps[1][axis][child]);
+            }
+        }
+    }
+
+    template <std::size_t N>
+    void checkQuantizedCases() {
+        using pbrt::Bounds3f;
+        using pbrt::Point3f;
+
+        SUBCASE("random children") {
+            pbrt::rng::RNG rng;
+            for (std::size_t count = 1; count <= N; ++count) {
+                std::vector<Bounds3f> children;
+                for (std::size_t i = 0; i < count; ++i) {
+                    children.emplace_back(pbrt::tests::randomPoint(rng),
+                                          pbrt::tests::randomPoint(rng));
+                }
+                checkQuantized<N>(children);
+            }
+        }
+        SUBCASE("zero extent children") {
+            checkQuantized<N>({
+                Bounds3f(Point3f(0.5f, 0.5f, 0.5f)),
+                Bounds3f(Point3f(0.f, 0.f, 0.f), Point3f(1.f, 1.f, 0.f)),
+                Bounds3f(Point3f(0.3f, 0.f, 0.f), Point3f(0.3f, 1.f, 1.f)),
+            });
+            // the node has no extent along any axis
+            checkQuantized<N>({
+                Bounds3f(Point3f(0.25f, -3.f, 7.f)),
+                Bounds3f(Point3f(0.25f, -3.f, 7.f)),
+            });
+            // a single point
+            checkQuantized<N>({Bounds3f(Point3f(0.f, 0.f, 0.f))});
+        }
+        SUBCASE("huge coordinates") {
+            checkQuantized<N>({
+                Bounds3f(Point3f(-1e30f, -1e30f, -1e30f),
+                         Point3f(1e30f, 1e29f, -1e29f)),
+                Bounds3f(Point3f(1e30f, 1e30f, 1e30f)),
+                Bounds3f(Point3f(0.f, 0.f, 0.f), Point3f(1.f, 1.f, 1.f)),
+            });
+        }
+        SUBCASE("tiny coordinates") {
+            checkQuantized<N>({
+                Bounds3f(Point3f(0.f, 0.f, 0.f),
+                         Point3f(1e-30f, 2e-30f, 3e-30f)),
+                Bounds3f(Point3f(-1e-30f, 5e-31f, 1e-31f),
+                         Point3f(1e-31f, 1e-30f, 2e-31f)),
+            });
+        }
+        SUBCASE("children far from the origin") {
+            checkQuantized<N>({
+                Bounds3f(Point3f(1e6f, -1e6f, 3e4f),
+                         Point3f(1e6f + 0.5f, -1e6f + 0.125f, 3e4f + 1.f)),
+                Bounds3f(Point3f(1e6f + 0.25f, -1e6f, 3e4f),
+                         Point3f(1e6f + 1.f, -1e6f + 2.f, 3e4f + 0.5f)),
+            });
+        }
+    }
+
+    pbrt::tests::Primitives
+    scaledTriangleSoup(const unsigned count,
+                       const pbrt::Float scale,
+                       const pbrt::Vector3f& offset,
+                       pbrt::rng::RNG& rng) {
+        auto vertices = pbrt::tests::triangleSoupVertices(count, rng);
+        for (pbrt::Point3f& v : vertices) {
+            v = scale * v + offset;
+        }
+
+        const pbrt::Transformation identity;
+        const auto triangles =
+            pbrt::shapes::createTriangleMesh(identity,
+                                             identity,
+                                             false,
+                                             count,
+                                             pbrt::tests::soupIndices(count),
+                                             vertices,
+                                             {},
+                                             {},
+                                             {},
+                                             nullptr,
+                                             nullptr,
+                                             {});
+
+        pbrt::tests::Primitives result;
+        for (const auto& triangle : triangles) {
+            result.push_back(pbrt::tests::geometricPrimitive(triangle));
+        }
+
+        return result;
+    }
+
+    // The quantized children may only be bigger, so the same
+    // primitives are hit at the same distances
+    void checkMatchesBinary(const pbrt::tests::Primitives& primitives,
+                            const std::vector<pbrt::Ray>& rays) {
+        for (const auto splitMethod : pbrt::tests::ALL_SPLIT_METHODS) {
+            const BVH binary(primitives,
+                             splitMethod,
+                             1,
+                             pbrt::memory::PageSize::Default,
+                             NodeLayout::Binary);
+
+            for (const auto layout :
+                 {NodeLayout::QuantizedWide4, NodeLayout::QuantizedWide8}) {
+                const BVH quantized(primitives,
+                                    splitMethod,
+                                    1,
+                                    pbrt::memory::PageSize::Default,
+                                    layout);
+
+                CHECK(quantized.worldBound() == binary.worldBound());
+                for (const pbrt::Ray& ray : rays) {
+                    CHECK(pbrt::tests::intersect(quantized, ray) ==
+                          pbrt::tests::intersect(binary, ray));
+                    CHECK(quantized.intersectP(ray) == binary.intersectP(ray));
+                }
+            }
+        }
+    }
+} // namespace
+
+TEST_CASE("quantized 4 wide nodes contain their children") {
+    checkQuantizedCases<4>();
+}
+
+TEST_CASE("quantized 8 wide nodes contain their children") {
+    checkQuantizedCases<8>();
+}
+
+TEST_CASE("quantized bvhs match binary bvhs") {
+    const pbrt::tests::ParallelScope parallelScope;
+    pbrt::rng::RNG rng;
+
+    SUBCASE("unit scene") {
+        const auto primitives = pbrt::tests::triangleSoup(300, rng);
+        checkMatchesBinary(primitives,
+                           pbrt::tests::testRays(primitives, 800, rng));
+    }
+    SUBCASE("scaled and moved scenes") {
+        for (const auto& [scale, offset] :
+             {std::pair{1e-6f, pbrt::Vector3f(0.f, 0.f, 0.f)},
+              std::pair{1e6f, pbrt::Vector3f(0.f, 0.f, 0.f)},
+              std::pair{1.f, pbrt::Vector3f(1000.f, -500.f, 250.f)}}) {
+            const auto primitives =
+                scaledTriangleSoup(300, scale, offset, rng);
+
+            auto rays = pbrt::tests::testRays(
+                pbrt::tests::triangleSoup(300, rng), 400, rng);
+            for (pbrt::Ray& ray : rays) {
+                ray.o = scale * ray.o + offset;
+                ray.d = scale * ray.d;
+            }
+            checkMatchesBinary(primitives, rays);
+        }
+    }
+}
\ No newline at end of file
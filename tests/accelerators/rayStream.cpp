@@ -0,0 +1,202 @@
+#include "doctest/doctest.h"
+
+#include "testScenes.hpp"
+#include "RayStream.hpp"
+
+#include <algorithm>
+
+namespace pbrt = idragnev::pbrt;
+namespace bvh = idragnev::pbrt::accelerators::bvh;
+
+using pbrt::accelerators::BVH;
+
+namespace {
+    void checkStreamMatchesSingleRays(const BVH& bvh,
+                                      const std::vector<pbrt::Ray>& rays) {
+        std::vector<pbrt::Ray> stream = rays;
+        std::vector<pbrt::Optional<pbrt::SurfaceInteraction>> hits(
+            rays.size());
+        bvh.intersect(stream, hits);
+
+        for (std::size_t i = 0; i < rays.size(); ++i) {
+            CHECK(pbrt::tests::toHit(hits[i], stream[i]) ==
+                  pbrt::tests::intersect(bvh, rays[i]));
+        }
+    }
+
+    std::vector<std::uint32_t> allIds(const std::size_t count) {
+        std::vector<std::uint32_t> ids(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            ids[i] = static_cast<std::uint32_t>(i);
+        }
+
+        return ids;
+    }
+} // namespace
+
+TEST_CASE("ray streams match tracing their rays one by one") {
+    const pbrt::tests::ParallelScope parallelScope;
+    pbrt::rng::RNG rng;
+    const auto primitives = pbrt::tests::triangleSoup(300, rng);
+
+    // more than two batches, the last of them partial
+    const std::size_t raysCount =
+        2 * bvh::constants::RAY_STREAM_BATCH_SIZE + 1000;
+    const auto rays = pbrt::tests::testRays(primitives, raysCount, rng);
+
+    for (const auto layout : pbrt::tests::ALL_LAYOUTS) {
+        const BVH bvh(primitives,
+                      pbrt::tests::SplitMethod::SAH,
+                      4,
+                      pbrt::memory::PageSize::Default,
+                      layout);
+
+        checkStreamMatchesSingleRays(bvh, rays);
+        checkStreamMatchesSingleRays(bvh, {rays[0]});
+    }
+}
+
+TEST_CASE("empty ray streams") {
+    const pbrt::tests::ParallelScope parallelScope;
+    pbrt::rng::RNG rng;
+    const auto rays = pbrt::tests::randomRays(10, rng);
+    std::vector<pbrt::Optional<pbrt::SurfaceInteraction>> hits(rays.size());
+
+    SUBCASE("empty bvh clears the hits") {
+        const BVH bvh({}, pbrt::tests::SplitMethod::SAH);
+        hits[3] = pbrt::SurfaceInteraction{};
+
+        bvh.intersect(rays, hits);
+
+        for (const auto& hit : hits) {
+            CHECK_FALSE(hit.has_value());
+        }
+    }
+    SUBCASE("no rays") {
+        const BVH bvh(pbrt::tests::triangleSoup(10, rng),
+                      pbrt::tests::SplitMethod::SAH);
+        bvh.intersect(std::span<const pbrt::Ray>{},
+                      std::span<pbrt::Optional<pbrt::SurfaceInteraction>>{});
+    }
+}
+
+TEST_CASE("sortRayStream") {
+    pbrt::rng::RNG rng;
+    const pbrt::Bounds3f bounds(pbrt::Point3f(0.f, 0.f, 0.f),
+                                pbrt::Point3f(1.f, 1.f, 1.f));
+    auto rays = pbrt::tests::randomRays(1000, rng);
+    // rays of the same octant and cell keep their order
+    for (std::size_t i = 0; i < 10; ++i) {
+        rays.emplace_back(pbrt::Point3f(0.5f, 0.5f, 0.5f),
+                          pbrt::Vector3f(1.f, 1.f, 1.f + i));
+    }
+
+    const auto stream = bvh::sortRayStream(rays, bounds);
+
+    SUBCASE("each ray is kept once with its data") {
+        REQUIRE(stream.size() == rays.size());
+
+        std::vector<bool> seen(rays.size(), false);
+        for (const bvh::StreamRay& ray : stream) {
+            REQUIRE(ray.index < rays.size());
+            CHECK_FALSE(seen[ray.index]);
+            seen[ray.index] = true;
+
+            const pbrt::Ray& original = rays[ray.index];
+            CHECK(ray.tMax == original.tMax);
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                CHECK(ray.query.origin[axis] == original.o[axis]);
+                CHECK(ray.query.invDir[axis] == 1.f / original.d[axis]);
+            }
+        }
+    }
+    SUBCASE("the rays are grouped by the octant of their direction") {
+        const auto octantOf = [&rays](const bvh::StreamRay& ray) {
+            const pbrt::Vector3f& d = rays[ray.index].d;
+            return (d.x < 0.f ? 1 : 0) | (d.y < 0.f ? 2 : 0) |
+                   (d.z < 0.f ? 4 : 0);
+        };
+
+        for (std::size_t i = 1; i < stream.size(); ++i) {
+            CHECK(octantOf(stream[i - 1]) <= octantOf(stream[i]));
+        }
+    }
+    SUBCASE("rays with equal keys keep their order") {
+        const auto first = rays.size() - 10;
+        std::vector<std::uint32_t> indices;
+        for (const bvh::StreamRay& ray : stream) {
+            if (ray.index >= first) {
+                indices.push_back(ray.index);
+            }
+        }
+
+        REQUIRE(indices.size() == 10);
+        CHECK(std::is_sorted(indices.begin(), indices.end()));
+    }
+}
+
+TEST_CASE("filtering and compacting ray streams") {
+    pbrt::rng::RNG rng;
+    const pbrt::Bounds3f bounds(pbrt::Point3f(0.3f, 0.2f, 0.4f),
+                                pbrt::Point3f(0.6f, 0.7f, 0.5f));
+    const pbrt::Bounds3f streamBounds(pbrt::Point3f(0.f, 0.f, 0.f),
+                                      pbrt::Point3f(1.f, 1.f, 1.f));
+    const auto rays = pbrt::tests::randomRays(1000, rng);
+    const auto stream = bvh::sortRayStream(rays, streamBounds);
+
+    // the ids of the rays testing the bounds one by one, in order
+    std::vector<std::uint32_t> expected;
+    pbrt::Float expectedClosest = pbrt::constants::Infinity;
+    for (std::uint32_t id = 100; id < 900; ++id) {
+        pbrt::Float tNear = 0.f;
+        if (bvh::intersectBounds(bounds, stream[id], tNear)) {
+            expected.push_back(id);
+            expectedClosest = std::min(expectedClosest, tNear);
+        }
+    }
+    REQUIRE_FALSE(expected.empty());
+    REQUIRE(expected.size() < 800);
+
+    SUBCASE("filterRayStream appends the ids of the rays in order") {
+        std::vector<std::uint32_t> ids = allIds(stream.size());
+
+        const pbrt::Float closest =
+            bvh::filterRayStream(bounds, stream, ids, 100, 800);
+
+        REQUIRE(ids.size() == stream.size() + expected.size());
+        CHECK(closest == expectedClosest);
+        CHECK(std::equal(expected.begin(),
+                         expected.end(),
+                         ids.begin() + stream.size()));
+        // the filtered ids are left as they were
+        const auto filtered = allIds(stream.size());
+        CHECK(std::equal(filtered.begin(), filtered.end(), ids.begin()));
+    }
+    SUBCASE("compactRayStream moves the ids of the rays to the front") {
+        std::vector<std::uint32_t> ids;
+        for (std::uint32_t id = 100; id < 900; ++id) {
+            ids.push_back(id);
+        }
+
+        const std::size_t count = bvh::compactRayStream(bounds, stream, ids);
+
+        REQUIRE(count == expected.size());
+        CHECK(std::equal(expected.begin(), expected.end(), ids.begin()));
+    }
+    SUBCASE("rays done with shorter tMax are dropped") {
+        auto shortened = stream;
+        for (const std::uint32_t id : expected) {
+            shortened[id].tMax = 0.f;
+        }
+        std::vector<std::uint32_t> ids = expected;
+
+        const std::size_t count =
+            bvh::compactRayStream(bounds, shortened, ids);
+
+        // only the rays starting in the bounds still reach them
+        CHECK(count < expected.size());
+        for (std::size_t i = 0; i < count; ++i) {
+            CHECK(pbrt::inside(rays[shortened[ids[i]].index].o, bounds));
+        }
+    }
+}
\ No newline at end of file
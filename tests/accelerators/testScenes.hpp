@@ -0,0 +1,218 @@
+#pragma once
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <memory>
+#include <vector>
+
+// The scenes and rays shared by the accelerators tests. The hits of
+// the aggregates are compared with those found by testing each
+// primitive in turn.
+
+namespace idragnev::pbrt::tests {
+    using Primitives = std::vector<std::shared_ptr<const Primitive>>;
+    using accelerators::bvh::NodeLayout;
+    using accelerators::bvh::SplitMethod;
+
+    inline constexpr NodeLayout ALL_LAYOUTS[] = {
+        NodeLayout::Binary,
+        NodeLayout::Wide4,
+        NodeLayout::Wide8,
+        NodeLayout::QuantizedWide4,
+        NodeLayout::QuantizedWide8,
+    };
+
+    inline constexpr SplitMethod ALL_SPLIT_METHODS[] = {
+        SplitMethod::SAH,
+        SplitMethod::HLBVH,
+        SplitMethod::Middle,
+        SplitMethod::EqualCounts,
+    };
+
+    // The BVH builders run parallel loops
+    struct ParallelScope
+    {
+        ParallelScope() { parallel::init(); }
+        ~ParallelScope() { parallel::cleanup(); }
+    };
+
+    inline Point3f randomPoint(rng::RNG& rng) {
+        const Float x = rng.uniformFloat();
+        const Float y = rng.uniformFloat();
+        const Float z = rng.uniformFloat();
+        return Point3f(x, y, z);
+    }
+
+    // Small triangles scattered in the unit cube. Their vertices are
+    // random, so no two of them are hit by a ray at the same distance.
+    inline std::vector<Point3f> triangleSoupVertices(const unsigned count,
+                                                     rng::RNG& rng) {
+        std::vector<Point3f> vertices;
+        for (unsigned i = 0; i < count; ++i) {
+            const Point3f center = randomPoint(rng);
+            for (unsigned j = 0; j < 3; ++j) {
+                const Vector3f offset =
+                    randomPoint(rng) - Point3f(0.5f, 0.5f, 0.5f);
+                vertices.push_back(center + 0.25f * offset);
+            }
+        }
+
+        return vertices;
+    }
+
+    inline std::vector<std::size_t> soupIndices(const unsigned count) {
+        std::vector<std::size_t> indices(3 * count);
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            indices[i] = i;
+        }
+
+        return indices;
+    }
+
+    inline std::shared_ptr<const Primitive>
+    geometricPrimitive(std::shared_ptr<const Shape> shape) {
+        return std::make_shared<GeometricPrimitive>(std::move(shape),
+                                                    nullptr,
+                                                    nullptr,
+                                                    MediumInterface{});
+    }
+
+    // A primitive per triangle of the soup
+    inline Primitives triangleSoup(const unsigned count, rng::RNG& rng) {
+        const Transformation identity;
+        const auto triangles =
+            shapes::createTriangleMesh(identity,
+                                       identity,
+                                       false,
+                                       count,
+                                       soupIndices(count),
+                                       triangleSoupVertices(count, rng),
+                                       {},
+                                       {},
+                                       {},
+                                       nullptr,
+                                       nullptr,
+                                       {});
+
+        Primitives result;
+        for (const auto& triangle : triangles) {
+            result.push_back(geometricPrimitive(triangle));
+        }
+
+        return result;
+    }
+
+    // Rays from around the unit cube towards points in it, every third
+    // of them ending halfway
+    inline std::vector<Ray> randomRays(const std::size_t count,
+                                       rng::RNG& rng) {
+        std::vector<Ray> rays;
+        for (std::size_t i = 0; i < count; ++i) {
+            const Point3f o =
+                2.f * randomPoint(rng) - Vector3f(0.5f, 0.5f, 0.5f);
+            const Point3f target = randomPoint(rng);
+            const Float tMax = i % 3 == 0 ? 0.5f : constants::Infinity;
+            rays.emplace_back(o, target - o, tMax);
+        }
+
+        return rays;
+    }
+
+    // Rays with zero direction components. Those parallel to an axis start
+    // on the slabs of the bounds of the primitives, where the slab test
+    // computes 0 * infinity, and the others start on a single slab.
+    inline std::vector<Ray> slabRays(const Primitives& primitives,
+                                     const std::size_t count,
+                                     rng::RNG& rng) {
+        std::vector<Ray> rays;
+        for (std::size_t i = 0; i < count; ++i) {
+            const Bounds3f bounds =
+                primitives[rng.uniformUInt32(
+                               static_cast<std::uint32_t>(primitives.size()))]
+                    ->worldBound();
+            const std::size_t axis = i % 3;
+            const bool negative = i % 2 == 1;
+
+            Point3f o = randomPoint(rng);
+            Vector3f d;
+            if (i % 4 < 2) {
+                // along `axis`, through a corner of the bounds
+                o[(axis + 1) % 3] = bounds.min[(axis + 1) % 3];
+                o[(axis + 2) % 3] = bounds.max[(axis + 2) % 3];
+                o[axis] = negative ? 2.f : -1.f;
+                d[axis] = negative ? -1.f : 1.f;
+            }
+            else {
+                // parallel to the plane of two axes, from a face
+                // of the bounds
+                o[axis] = negative ? bounds.max[axis] : bounds.min[axis];
+                o[(axis + 1) % 3] = bounds.min[(axis + 1) % 3];
+                d[axis] = negative ? -rng.uniformFloat() : rng.uniformFloat();
+                d[(axis + 2) % 3] = rng.uniformFloat() - 0.5f;
+            }
+            rays.emplace_back(o, d);
+        }
+
+        return rays;
+    }
+
+    inline std::vector<Ray> testRays(const Primitives& primitives,
+                                     const std::size_t count,
+                                     rng::RNG& rng) {
+        std::vector<Ray> rays = randomRays(count - count / 4, rng);
+        for (const Ray& ray : slabRays(primitives, count / 4, rng)) {
+            rays.push_back(ray);
+        }
+
+        return rays;
+    }
+
+    struct Hit
+    {
+        bool operator==(const Hit&) const = default;
+
+        bool found = false;
+        Float t = 0.f;
+        const Primitive* primitive = nullptr;
+        Point3f p;
+    };
+
+    // `ray` is the one passed to intersect, whose tMax is the distance
+    // to the hit
+    inline Hit toHit(const Optional<SurfaceInteraction>& interaction,
+                     const Ray& ray) {
+        if (!interaction.has_value()) {
+            return Hit{};
+        }
+
+        return Hit{true, ray.tMax, interaction->primitive, interaction->p};
+    }
+
+    inline Hit bruteForceIntersect(const Primitives& primitives,
+                                   const Ray& ray) {
+        const Ray r = ray;
+        Optional<SurfaceInteraction> closest;
+        for (const auto& primitive : primitives) {
+            if (auto interaction = primitive->intersect(r);
+                interaction.has_value()) {
+                closest = std::move(interaction);
+            }
+        }
+
+        return toHit(closest, r);
+    }
+
+    inline Hit intersect(const Primitive& aggregate, const Ray& ray) {
+        const Ray r = ray;
+        const auto interaction = aggregate.intersect(r);
+        return toHit(interaction, r);
+    }
+} // namespace idragnev::pbrt::tests
\ No newline at end of file
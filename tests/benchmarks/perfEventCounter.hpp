@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define PBRT_HAS_PERF_EVENTS
+#endif
+
+// Hardware event counters shared by the benchmarks. They are read
+// through perf_event_open on Linux and are unavailable elsewhere, or
+// when the kernel does not allow it, e.g. in most containers.
+
+namespace idragnev::pbrt::benchmarks {
+    // The generic cache events of perf_event_open. It has no event for
+    // the L2 cache, the L1 misses are the reads which go to L2.
+    enum class CacheEvent
+    {
+        L1DataReadMisses,
+        LastLevelReadMisses,
+        DataTLBReadMisses,
+    };
+
+    inline const char* toString(const CacheEvent event) {
+        switch (event) {
+            case CacheEvent::L1DataReadMisses: return "L1d misses";
+            case CacheEvent::LastLevelReadMisses: return "LLC misses";
+            case CacheEvent::DataTLBReadMisses: return "dTLB misses";
+        }
+
+        return "unknown";
+    }
+
+    // Counts `event` on the calling thread. With `countNewThreads`
+    // the threads it starts afterwards, e.g. the workers started by
+    // parallel::init(), are counted as well.
+    class PerfEventCounter
+    {
+    public:
+        explicit PerfEventCounter(const CacheEvent event,
+                                  const bool countNewThreads = false) {
+#ifdef PBRT_HAS_PERF_EVENTS
+            perf_event_attr attributes{};
+            attributes.type = PERF_TYPE_HW_CACHE;
+            attributes.size = sizeof(attributes);
+            attributes.config = cacheId(event) |
+                                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attributes.disabled = 1;
+            attributes.inherit = countNewThreads ? 1 : 0;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            fd = static_cast<int>(
+                syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#else
+            static_cast<void>(event);
+            static_cast<void>(countNewThreads);
+#endif
+        }
+        ~PerfEventCounter() {
+#ifdef PBRT_HAS_PERF_EVENTS
+            if (fd >= 0) {
+                close(fd);
+            }
+#endif
+        }
+
+        PerfEventCounter(const PerfEventCounter&) = delete;
+        PerfEventCounter& operator=(const PerfEventCounter&) = delete;
+
+        bool isAvailable() const noexcept { return fd >= 0; }
+
+        void start() {
+#ifdef PBRT_HAS_PERF_EVENTS
+            if (isAvailable()) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        // The count since start(), summed over the counted threads
+        std::uint64_t stop() {
+            std::uint64_t count = 0;
+#ifdef PBRT_HAS_PERF_EVENTS
+            if (isAvailable()) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                    count = 0;
+                }
+            }
+#endif
+            return count;
+        }
+
+    private:
+#ifdef PBRT_HAS_PERF_EVENTS
+        static std::uint64_t cacheId(const CacheEvent event) noexcept {
+            switch (event) {
+                case CacheEvent::L1DataReadMisses:
+                    return PERF_COUNT_HW_CACHE_L1D;
+                case CacheEvent::LastLevelReadMisses:
+                    return PERF_COUNT_HW_CACHE_LL;
+                case CacheEvent::DataTLBReadMisses:
+                    return PERF_COUNT_HW_CACHE_DTLB;
+            }
+
+            return PERF_COUNT_HW_CACHE_L1D;
+        }
+#endif
+
+        int fd = -1;
+    };
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
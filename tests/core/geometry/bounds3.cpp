@@ -289,4 +289,18 @@ TEST_CASE("optimised intersection") {
 
         CHECK(bounds.intersectP(ray, inverse(ray.d), dirIsNegative));
     }
+
+    SUBCASE("axis parallel ray with origin on a bounds wall and passing "
+            "through the bounds intersects it") {
+        const auto bounds = pbrt::Bounds3f{
+            pbrt::Point3f{1.f, 1.f, 1.f},
+            pbrt::Point3f{3.f, 3.f, 3.f},
+        };
+        const auto ray = pbrt::Ray{
+            pbrt::Point3f{2.f, 1.f, 0.f},
+            pbrt::Vector3f{0.f, 0.f, 1.f},
+        };
+
+        CHECK(bounds.intersectP(ray, inverse(ray.d), dirIsNegative));
+    }
 }
\ No newline at end of file
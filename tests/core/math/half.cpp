@@ -0,0 +1,48 @@
+#include "doctest/doctest.h"
+#include "pbrt/core/math/Half.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace pbrt = idragnev::pbrt;
+
+using pbrt::math::Half;
+
+TEST_CASE("values representable as halves are converted exactly") {
+    for (const float f : {0.f, -0.f, 1.f, -2.f, 0.5f, 0.25f, 1024.f, 65504.f}) {
+        CHECK(static_cast<float>(Half(f)) == f);
+    }
+
+    CHECK(Half(1.f).bits() == 0x3c00);
+    CHECK(Half(-2.f).bits() == 0xc000);
+    CHECK(std::signbit(static_cast<float>(Half(-0.f))));
+}
+
+TEST_CASE("conversion rounds to the nearest even half") {
+    // halves in [1, 2) are 2^-10 apart
+    const float ulp = 1.f / 1024.f;
+
+    CHECK(static_cast<float>(Half(1.f + 0.4f * ulp)) == 1.f);
+    CHECK(static_cast<float>(Half(1.f + 0.6f * ulp)) == 1.f + ulp);
+    // ties go to the even mantissa
+    CHECK(static_cast<float>(Half(1.f + 0.5f * ulp)) == 1.f);
+    CHECK(static_cast<float>(Half(1.f + 1.5f * ulp)) == 1.f + 2.f * ulp);
+}
+
+TEST_CASE("denormals") {
+    const float smallestDenormal = std::ldexp(1.f, -24);
+
+    CHECK(static_cast<float>(Half(smallestDenormal)) == smallestDenormal);
+    CHECK(static_cast<float>(Half(3.f * smallestDenormal)) ==
+          3.f * smallestDenormal);
+    CHECK(static_cast<float>(Half(0.25f * smallestDenormal)) == 0.f);
+}
+
+TEST_CASE("overflow, infinities and NaNs") {
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    CHECK(static_cast<float>(Half(1e6f)) == infinity);
+    CHECK(static_cast<float>(Half(-infinity)) == -infinity);
+    CHECK(std::isnan(
+        static_cast<float>(Half(std::numeric_limits<float>::quiet_NaN()))));
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "doctest/doctest.h"
+#include "pbrt/core/math/OctahedralVector.hpp"
+#include "pbrt/core/math/Vector3.hpp"
+#include "pbrt/core/math/Normal3.hpp"
+#include "pbrt/core/RNG.hpp"
+
+namespace pbrt = idragnev::pbrt;
+
+using pbrt::Float;
+using pbrt::Normal3f;
+using pbrt::Vector3f;
+using pbrt::math::OctahedralVector;
+
+TEST_CASE("the axes are encoded precisely") {
+    // 0 falls between two quantization steps
+    for (const Vector3f& axis : {Vector3f(1, 0, 0),
+                                 Vector3f(0, -1, 0),
+                                 Vector3f(0, 0, 1),
+                                 Vector3f(0, 0, -1)}) {
+        const auto decoded = static_cast<Vector3f>(OctahedralVector(axis));
+
+        CHECK(decoded.x == doctest::Approx(axis.x).epsilon(1e-4));
+        CHECK(decoded.y == doctest::Approx(axis.y).epsilon(1e-4));
+        CHECK(decoded.z == doctest::Approx(axis.z).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("decoded vectors keep the direction of the encoded ones") {
+    pbrt::rng::RNG rng;
+
+    int imprecise = 0;
+    for (int i = 0; i < 10000; ++i) {
+        const Vector3f v(2 * rng.uniformFloat() - 1,
+                         2 * rng.uniformFloat() - 1,
+                         2 * rng.uniformFloat() - 1);
+        if (v.lengthSquared() == 0) {
+            continue;
+        }
+
+        const auto decoded = static_cast<Vector3f>(OctahedralVector(v));
+        const Float cosAngle = pbrt::math::dot(decoded, pbrt::math::normalize(v));
+
+        imprecise += decoded.length() < 0.9999f || cosAngle < 0.99999f;
+    }
+
+    CHECK(imprecise == 0);
+}
+
+TEST_CASE("normals are encoded like vectors") {
+    const Normal3f n(0.3f, -0.5f, -0.8f);
+
+    const auto decoded = static_cast<Normal3f>(OctahedralVector(n));
+    const auto expected = pbrt::math::normalize(n);
+
+    CHECK(decoded.x == doctest::Approx(expected.x).epsilon(1e-4));
+    CHECK(decoded.y == doctest::Approx(expected.y).epsilon(1e-4));
+    CHECK(decoded.z == doctest::Approx(expected.z).epsilon(1e-4));
+}
\ No newline at end of file
@@ -1,11 +1,27 @@
 #include "doctest/doctest.h"
 #include "pbrt/memory/BlockedUVArray.hpp"
+#include "pbrt/parallel/Parallel.hpp"
 
 #include <algorithm>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace mem = idragnev::pbrt::memory;
+namespace parallel = idragnev::pbrt::parallel;
+
+namespace {
+    // BlockedUVArray runs parallel loops
+    struct ParallelScope
+    {
+        ParallelScope() { parallel::init(); }
+        ~ParallelScope() { parallel::cleanup(); }
+    };
+} // namespace
 
 TEST_CASE("zero initialization is used by default") {
+    const ParallelScope parallelScope;
     const std::size_t uExtent = 2;
     const std::size_t vExtent = 2;
 
@@ -22,6 +38,7 @@ TEST_CASE("zero initialization is used by default") {
 }
 
 TEST_CASE("at") {
+    const ParallelScope parallelScope;
     const int data[] = {1, 2, 3, 4};
     const std::size_t uExtent = 2;
     const std::size_t vExtent = 2;
@@ -36,6 +53,7 @@ TEST_CASE("at") {
 }
 
 TEST_CASE("asLinearArray") {
+    const ParallelScope parallelScope;
     const int data[] = {1, 2, 3, 4};
     const std::size_t uExtent = 2;
     const std::size_t vExtent = 2;
@@ -47,4 +65,101 @@ TEST_CASE("asLinearArray") {
     arr.asLinearArray(dest);
 
     CHECK(std::equal(data, data + size, dest, dest + size));
+}
+
+TEST_CASE("huge pages") {
+    const ParallelScope parallelScope;
+    const std::size_t uExtent = 1000;
+    const std::size_t vExtent = 1000;
+    std::vector<int> data(uExtent * vExtent);
+    std::iota(data.begin(), data.end(), 0);
+
+    mem::BlockedUVArray<int, 3> arr(uExtent,
+                                    vExtent,
+                                    data.data(),
+                                    mem::PageSize::Huge);
+
+    std::vector<int> dest(data.size());
+    arr.asLinearArray(dest.data());
+
+    CHECK(dest == data);
+}
+
+TEST_CASE("extents which are not multiples of the block extent") {
+    const ParallelScope parallelScope;
+
+    const std::size_t uExtent = 37;
+    const std::size_t vExtent = 21;
+    std::vector<int> data(uExtent * vExtent);
+    std::iota(data.begin(), data.end(), 0);
+
+    mem::BlockedUVArray<int, 2> arr(uExtent, vExtent, data.data());
+
+    for (std::size_t v = 0; v < vExtent; ++v) {
+        for (std::size_t u = 0; u < uExtent; ++u) {
+            CHECK(arr.at(u, v) == data[uExtent * v + u]);
+        }
+    }
+
+    std::vector<int> dest(data.size());
+    arr.asLinearArray(dest.data());
+
+    CHECK(dest == data);
+}
+
+TEST_CASE("non trivially copyable elements") {
+    const ParallelScope parallelScope;
+
+    const std::size_t uExtent = 5;
+    const std::size_t vExtent = 3;
+    std::vector<std::string> data;
+    for (std::size_t i = 0; i < uExtent * vExtent; ++i) {
+        data.push_back(std::string(40, static_cast<char>('a' + i)));
+    }
+
+    mem::BlockedUVArray<std::string, 1> arr(uExtent, vExtent, data.data());
+
+    std::vector<std::string> dest(data.size());
+    arr.asLinearArray(dest.data());
+
+    CHECK(dest == data);
+}
+
+TEST_CASE("moving") {
+    const ParallelScope parallelScope;
+
+    const int data[] = {1, 2, 3, 4, 5, 6};
+    const std::size_t uExtent = 3;
+    const std::size_t vExtent = 2;
+
+    mem::BlockedUVArray<int, 1> arr(uExtent, vExtent, data);
+    const int* const firstAddress = &arr.at(0, 0);
+
+    SUBCASE("move construction") {
+        const mem::BlockedUVArray<int, 1> moved(std::move(arr));
+
+        CHECK(&moved.at(0, 0) == firstAddress);
+        CHECK(moved.uExtent() == uExtent);
+        CHECK(moved.vExtent() == vExtent);
+        CHECK(arr.uExtent() == 0);
+        CHECK(arr.vExtent() == 0);
+    }
+
+    SUBCASE("move assignment") {
+        mem::BlockedUVArray<int, 1> other(1, 1);
+        other = std::move(arr);
+
+        CHECK(&other.at(0, 0) == firstAddress);
+        CHECK(other.at(2, 1) == 6);
+        CHECK(arr.uExtent() == 0);
+    }
+
+    SUBCASE("in containers") {
+        std::vector<mem::BlockedUVArray<int, 1>> textures;
+        textures.push_back(std::move(arr));
+        textures.emplace_back(uExtent, vExtent, data);
+
+        CHECK(&textures[0].at(0, 0) == firstAddress);
+        CHECK(textures[1].at(1, 1) == 5);
+    }
 }
\ No newline at end of file
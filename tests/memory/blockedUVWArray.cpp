@@ -0,0 +1,142 @@
+#include "doctest/doctest.h"
+#include "pbrt/memory/BlockedUVWArray.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace mem = idragnev::pbrt::memory;
+namespace parallel = idragnev::pbrt::parallel;
+
+namespace {
+    // BlockedUVWArray runs parallel loops
+    struct ParallelScope
+    {
+        ParallelScope() { parallel::init(); }
+        ~ParallelScope() { parallel::cleanup(); }
+    };
+
+    std::vector<float> linearGrid(const std::size_t uExtent,
+                                  const std::size_t vExtent,
+                                  const std::size_t wExtent) {
+        std::vector<float> result;
+        for (std::size_t w = 0; w < wExtent; ++w) {
+            for (std::size_t v = 0; v < vExtent; ++v) {
+                for (std::size_t u = 0; u < uExtent; ++u) {
+                    result.push_back(float(u) + 2.f * float(v) + 3.f * float(w));
+                }
+            }
+        }
+
+        return result;
+    }
+} // namespace
+
+TEST_CASE("an array with no data allocates no bricks") {
+    const mem::BlockedUVWArray<float, 2> arr(10, 10, 10, 0.5f);
+
+    CHECK(arr.allocatedBricksCount() == 0);
+    CHECK(arr.at(3, 4, 5) == 0.5f);
+    CHECK(arr.lookup(3.5f, 4.5f, 5.5f) == 0.5f);
+}
+
+TEST_CASE("writing allocates only the brick of the element") {
+    mem::BlockedUVWArray<int, 2> arr(10, 10, 10);
+
+    arr.at(5, 6, 7) = 42;
+
+    CHECK(arr.allocatedBricksCount() == 1);
+    CHECK(arr.at(5, 6, 7) == 42);
+    CHECK(arr.at(4, 4, 4) == 0);
+    CHECK(std::as_const(arr).at(0, 0, 0) == 0);
+    CHECK(arr.allocatedBricksCount() == 1);
+}
+
+TEST_CASE("initialization allocates only the occupied bricks") {
+    const ParallelScope parallelScope;
+
+    const std::size_t uExtent = 13;
+    const std::size_t vExtent = 9;
+    const std::size_t wExtent = 7;
+    std::vector<int> data(uExtent * vExtent * wExtent, 0);
+    const auto indexOf = [&](std::size_t u, std::size_t v, std::size_t w) {
+        return (w * vExtent + v) * uExtent + u;
+    };
+    data[indexOf(0, 0, 0)] = 1;
+    data[indexOf(12, 8, 6)] = 2;
+
+    const mem::BlockedUVWArray<int, 2> arr(uExtent, vExtent, wExtent, data.data());
+
+    CHECK(arr.allocatedBricksCount() == 2);
+    for (std::size_t w = 0; w < wExtent; ++w) {
+        for (std::size_t v = 0; v < vExtent; ++v) {
+            for (std::size_t u = 0; u < uExtent; ++u) {
+                CHECK(arr.at(u, v, w) == data[indexOf(u, v, w)]);
+            }
+        }
+    }
+}
+
+TEST_CASE("trilinear lookup") {
+    const ParallelScope parallelScope;
+
+    const std::size_t uExtent = 11;
+    const std::size_t vExtent = 6;
+    const std::size_t wExtent = 9;
+    const std::vector<float> data = linearGrid(uExtent, vExtent, wExtent);
+
+    const mem::BlockedUVWArray<float, 2> arr(uExtent,
+                                             vExtent,
+                                             wExtent,
+                                             data.data(),
+                                             -1.f);
+
+    const auto expected = [](float u, float v, float w) {
+        return u + 2.f * v + 3.f * w;
+    };
+
+    SUBCASE("at the elements") {
+        CHECK(arr.lookup(2.f, 3.f, 4.f) == doctest::Approx(expected(2, 3, 4)));
+    }
+    SUBCASE("inside a brick") {
+        CHECK(arr.lookup(1.25f, 1.5f, 2.75f) ==
+              doctest::Approx(expected(1.25f, 1.5f, 2.75f)));
+    }
+    SUBCASE("across bricks") {
+        CHECK(arr.lookup(3.5f, 3.25f, 7.5f) ==
+              doctest::Approx(expected(3.5f, 3.25f, 7.5f)));
+    }
+    SUBCASE("outside the array") {
+        CHECK(arr.lookup(-2.f, 0.5f, 100.f) ==
+              doctest::Approx(expected(0.f, 0.5f, 8.f)));
+    }
+}
+
+TEST_CASE("moving") {
+    mem::BlockedUVWArray<int, 1> arr(4, 4, 4);
+    arr.at(1, 2, 3) = 7;
+
+    mem::BlockedUVWArray<int, 1> moved(std::move(arr));
+    CHECK(moved.at(1, 2, 3) == 7);
+    CHECK(moved.allocatedBricksCount() == 1);
+    CHECK(arr.uExtent() == 0);
+
+    mem::BlockedUVWArray<int, 1> other(2, 2, 2);
+    other = std::move(moved);
+    CHECK(other.at(1, 2, 3) == 7);
+    CHECK(other.wExtent() == 4);
+}
+
+TEST_CASE("bricks are accounted as volumes") {
+    const auto before = mem::memoryUsage(mem::MemoryTag::Volumes).liveBytes;
+    {
+        mem::BlockedUVWArray<float, 2> arr(8, 8, 8);
+        arr.at(0, 0, 0) = 1.f;
+        arr.at(7, 7, 7) = 1.f;
+
+        CHECK(mem::memoryUsage(mem::MemoryTag::Volumes).liveBytes ==
+              before + 2 * 64 * sizeof(float));
+    }
+
+    CHECK(mem::memoryUsage(mem::MemoryTag::Volumes).liveBytes == before);
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "doctest/doctest.h"
+#include "pbrt/memory/MappedFile.hpp"
+#include "pbrt/memory/Memory.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace mem = idragnev::pbrt::memory;
+namespace fs = std::filesystem;
+
+namespace {
+    struct TemporaryFile
+    {
+        explicit TemporaryFile(const std::string& contents)
+            : path(fs::temp_directory_path() / "pbrt_mapped_file_test.bin") {
+            std::ofstream file{path, std::ios::binary};
+            file.write(contents.data(),
+                       static_cast<std::streamsize>(contents.size()));
+        }
+        ~TemporaryFile() {
+            std::error_code error;
+            fs::remove(path, error);
+        }
+
+        fs::path path;
+    };
+} // namespace
+
+TEST_CASE("a mapped file views the contents of the file") {
+    const std::string contents = "mapped file contents";
+    const TemporaryFile temporary{contents};
+
+    const mem::MappedFile file{temporary.path};
+
+    REQUIRE(file.isOpen());
+    CHECK(file.size() == contents.size());
+    CHECK(std::memcmp(file.data(), contents.data(), contents.size()) == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>(file.data()) %
+              mem::constants::L1_CACHE_LINE_SIZE ==
+          0);
+}
+
+TEST_CASE("missing and empty files are not opened") {
+    const TemporaryFile empty{""};
+
+    CHECK_FALSE(mem::MappedFile{empty.path}.isOpen());
+    CHECK_FALSE(mem::MappedFile{empty.path / "missing"}.isOpen());
+}
+
+TEST_CASE("moving a mapped file moves the view") {
+    const std::string contents = "moved";
+    const TemporaryFile temporary{contents};
+
+    mem::MappedFile file{temporary.path};
+    const std::byte* const data = file.data();
+
+    mem::MappedFile moved{std::move(file)};
+    CHECK_FALSE(file.isOpen());
+    CHECK(moved.data() == data);
+    CHECK(moved.size() == contents.size());
+
+    file = std::move(moved);
+    CHECK(file.data() == data);
+    CHECK_FALSE(moved.isOpen());
+}
\ No newline at end of file
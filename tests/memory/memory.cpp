@@ -1,5 +1,8 @@
+#include "doctest/doctest.h"
 #include "pbrt/memory/Memory.hpp"
 
+#include <cstring>
+
 namespace mem = idragnev::pbrt::memory;
 
 static_assert(mem::isPowerOfTwo(1));
@@ -15,4 +18,25 @@ static_assert(mem::alignUp(2, 2) == 2);
 static_assert(mem::alignUp(4, 2) == 4);
 static_assert(mem::alignUp(7, 8) == 8);
 static_assert(mem::alignUp(9, 16) == 16);
-static_assert(mem::alignUp(21, 16) == 32);
\ No newline at end of file
+static_assert(mem::alignUp(21, 16) == 32);
+
+TEST_CASE("allocations backed by huge pages") {
+    using mem::constants::HUGE_PAGE_SIZE;
+    using mem::constants::L1_CACHE_LINE_SIZE;
+
+    for (const std::size_t size : {std::size_t(100),
+                                   HUGE_PAGE_SIZE,
+                                   2 * HUGE_PAGE_SIZE + 100}) {
+        auto* const memory = static_cast<std::uint8_t*>(
+            mem::allocCacheAligned(size, mem::PageSize::Huge));
+
+        REQUIRE(memory != nullptr);
+        CHECK(reinterpret_cast<std::uintptr_t>(memory) % L1_CACHE_LINE_SIZE ==
+              0);
+
+        std::memset(memory, 1, size);
+        CHECK(memory[size - 1] == 1);
+
+        mem::freeAligned(memory, size, mem::PageSize::Huge);
+    }
+}
\ No newline at end of file
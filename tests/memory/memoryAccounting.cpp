@@ -0,0 +1,82 @@
+#include "doctest/doctest.h"
+#include "pbrt/memory/MemoryAccounting.hpp"
+#include "pbrt/memory/Memory.hpp"
+#include "pbrt/memory/MemoryArena.hpp"
+
+#include <cstdio>
+#include <vector>
+
+namespace mem = idragnev::pbrt::memory;
+
+using mem::MemoryTag;
+
+TEST_CASE("recording allocations updates the live and peak bytes") {
+    const auto before = mem::memoryUsage(MemoryTag::Samplers);
+
+    mem::recordAllocation(MemoryTag::Samplers, 1000);
+    mem::recordAllocation(MemoryTag::Samplers, 500);
+    mem::recordDeallocation(MemoryTag::Samplers, 1000);
+
+    const auto after = mem::memoryUsage(MemoryTag::Samplers);
+    CHECK(after.liveBytes == before.liveBytes + 500);
+    CHECK(after.peakBytes >= before.liveBytes + 1500);
+
+    mem::recordDeallocation(MemoryTag::Samplers, 500);
+    CHECK(mem::memoryUsage(MemoryTag::Samplers).liveBytes == before.liveBytes);
+}
+
+TEST_CASE("TaggedAllocator accounts the memory of containers") {
+    using Allocator = mem::TaggedAllocator<int, MemoryTag::MeshIndices>;
+
+    const auto before = mem::memoryUsage(MemoryTag::MeshIndices);
+    {
+        std::vector<int, Allocator> indices(1000, 1);
+        CHECK(mem::memoryUsage(MemoryTag::MeshIndices).liveBytes ==
+              before.liveBytes + 1000 * sizeof(int));
+    }
+    const auto after = mem::memoryUsage(MemoryTag::MeshIndices);
+
+    CHECK(after.liveBytes == before.liveBytes);
+    CHECK(after.peakBytes >= before.liveBytes + 1000 * sizeof(int));
+}
+
+TEST_CASE("tagged aligned allocations are accounted") {
+    const auto before = mem::memoryUsage(MemoryTag::Textures);
+
+    void* const memory =
+        mem::allocCacheAligned(4096, mem::PageSize::Default, MemoryTag::Textures);
+    CHECK(mem::memoryUsage(MemoryTag::Textures).liveBytes ==
+          before.liveBytes + 4096);
+
+    mem::freeAligned(memory, 4096, mem::PageSize::Default, MemoryTag::Textures);
+    CHECK(mem::memoryUsage(MemoryTag::Textures).liveBytes == before.liveBytes);
+}
+
+TEST_CASE("arena blocks are accounted") {
+    const auto before = mem::memoryUsage(MemoryTag::Arenas);
+    {
+        mem::MemoryArena arena(4096);
+        [[maybe_unused]] void* const memory = arena.alloc(100);
+
+        CHECK(mem::memoryUsage(MemoryTag::Arenas).liveBytes ==
+              before.liveBytes + arena.totalAllocationSize());
+    }
+
+    CHECK(mem::memoryUsage(MemoryTag::Arenas).liveBytes == before.liveBytes);
+}
+
+TEST_CASE("printing the memory usage lists each tag") {
+    std::FILE* const out = std::tmpfile();
+    REQUIRE(out != nullptr);
+
+    mem::printMemoryUsage(out);
+
+    std::rewind(out);
+    int linesCount = 0;
+    for (int c = std::fgetc(out); c != EOF; c = std::fgetc(out)) {
+        linesCount += c == '\n';
+    }
+    std::fclose(out);
+
+    CHECK(linesCount == static_cast<int>(MemoryTag::Count) + 1);
+}
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include "pbrt/memory/MemoryArena.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
 
 namespace mem = idragnev::pbrt::memory;
 
@@ -52,5 +55,92 @@ TEST_CASE("reset does not free the allocated memory "
     const auto allocSize = arena.totalAllocationSize();
     arena.reset();
 
+    CHECK(arena.totalAllocationSize() == allocSize);
+}
+
+TEST_CASE("repeating the allocations after reset reuses the same memory") {
+    mem::MemoryArena arena(1024);
+    const std::size_t sizes[] = {100, 2000, 500, 3000, 10};
+
+    std::vector<void*> allocations;
+    for (const auto size : sizes) {
+        allocations.push_back(arena.alloc(size));
+    }
+    const auto allocSize = arena.totalAllocationSize();
+
+    arena.reset();
+    std::vector<void*> allocationsAfterReset;
+    for (const auto size : sizes) {
+        allocationsAfterReset.push_back(arena.alloc(size));
+    }
+
+    CHECK(allocationsAfterReset == allocations);
+    CHECK(arena.totalAllocationSize() == allocSize);
+}
+
+TEST_CASE("std::pmr containers") {
+    mem::MemoryArena arena;
+
+    SUBCASE("allocate their elements in the arena") {
+        std::pmr::vector<int> values(&arena);
+        for (int i = 0; i < 1000; ++i) {
+            values.push_back(i);
+        }
+
+        CHECK(values.size() == 1000);
+        CHECK(values.back() == 999);
+        CHECK(arena.totalAllocationSize() > 0);
+    }
+
+    SUBCASE("over-aligned allocations") {
+        for (const std::size_t alignment : {32u, 64u, 256u}) {
+            void* const memory = arena.allocate(10, alignment);
+
+            CHECK(reinterpret_cast<std::uintptr_t>(memory) % alignment == 0);
+        }
+    }
+}
+
+TEST_CASE("rollback releases only the allocations made after the checkpoint") {
+    mem::MemoryArena arena(1024);
+    int* const before = arena.alloc<int>(10);
+    before[0] = 42;
+
+    const auto checkpoint = arena.mark();
+    void* const first = arena.alloc(100);
+    for (int i = 0; i < 5; ++i) {
+        [[maybe_unused]] void* const memory = arena.alloc(900);
+    }
+    const auto allocSize = arena.totalAllocationSize();
+
+    arena.rollback(checkpoint);
+
+    CHECK(before[0] == 42);
+    CHECK(arena.alloc(100) == first);
+    for (int i = 0; i < 5; ++i) {
+        [[maybe_unused]] void* const memory = arena.alloc(900);
+    }
+    CHECK(arena.totalAllocationSize() == allocSize);
+}
+
+TEST_CASE("nested arena scopes keep the arena size flat") {
+    mem::MemoryArena arena(1024);
+    [[maybe_unused]] void* const sample = arena.alloc(500);
+
+    const auto tracePath = [&arena](const int depth) {
+        for (int bounce = 0; bounce < depth; ++bounce) {
+            mem::MemoryArenaScope bounceScope(arena);
+            [[maybe_unused]] void* const bsdf = arena.alloc(700);
+            {
+                mem::MemoryArenaScope lightScope(arena);
+                [[maybe_unused]] void* const light = arena.alloc(300);
+            }
+        }
+    };
+
+    tracePath(1);
+    const auto allocSize = arena.totalAllocationSize();
+    tracePath(100);
+
     CHECK(arena.totalAllocationSize() == allocSize);
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "doctest/doctest.h"
+#include "pbrt/memory/MemoryArena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace mem = idragnev::pbrt::memory;
+
+TEST_CASE("an arena returns its blocks to the pool when destroyed") {
+    const auto blockSize = 1024u;
+    mem::MemoryBlockPool pool(blockSize);
+
+    void* firstArenaMemory = nullptr;
+    {
+        mem::MemoryArena arena(pool);
+        firstArenaMemory = arena.alloc(10);
+    }
+
+    mem::MemoryArena arena(pool);
+
+    CHECK(arena.alloc(10) == firstArenaMemory);
+}
+
+TEST_CASE("allocations bigger than the pool block size are not pooled") {
+    const auto blockSize = 1024u;
+    mem::MemoryBlockPool pool(blockSize);
+
+    {
+        mem::MemoryArena arena(pool);
+        [[maybe_unused]] void* const memory = arena.alloc(2 * blockSize);
+    }
+
+    auto* const block = pool.acquire();
+    CHECK(block->allocationSize() == blockSize);
+
+    mem::detail::MemoryBlockList blocks;
+    blocks.pushBack(block);
+    pool.release(blocks);
+}
+
+TEST_CASE("reset reuses the blocks of the arena") {
+    const auto blockSize = 1024u;
+    mem::MemoryBlockPool pool(blockSize);
+    mem::MemoryArena arena(pool);
+
+    std::vector<void*> allocations;
+    for (int i = 0; i < 8; ++i) {
+        allocations.push_back(arena.alloc(blockSize / 2));
+    }
+    const auto allocSize = arena.totalAllocationSize();
+
+    arena.reset();
+    std::vector<void*> allocationsAfterReset;
+    for (int i = 0; i < 8; ++i) {
+        allocationsAfterReset.push_back(arena.alloc(blockSize / 2));
+    }
+
+    std::sort(allocations.begin(), allocations.end());
+    std::sort(allocationsAfterReset.begin(), allocationsAfterReset.end());
+
+    CHECK(allocations == allocationsAfterReset);
+    CHECK(arena.totalAllocationSize() == allocSize);
+}
+
+TEST_CASE("concurrent acquire and release") {
+    const auto blockSize = 256u;
+    const auto threadsCount = 4;
+    const auto iterations = 10000;
+    mem::MemoryBlockPool pool(blockSize);
+
+    std::atomic<int> corruptedBlocks = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadsCount; ++t) {
+        threads.emplace_back([&pool, &corruptedBlocks, t] {
+            for (int i = 0; i < iterations; ++i) {
+                mem::detail::MemoryBlockList blocks;
+                for (int j = 0; j < 3; ++j) {
+                    auto* const block = pool.acquire();
+                    // a block owned by two threads would be overwritten
+                    std::fill_n(block->memory(), block->size, std::uint8_t(t));
+                    blocks.pushBack(block);
+                }
+                for (auto* block = blocks.front(); block != nullptr;
+                     block = block->next.load()) {
+                    const auto* const memory = block->memory();
+                    if (!std::all_of(memory, memory + block->size, [t](auto b) {
+                            return b == std::uint8_t(t);
+                        })) {
+                        ++corruptedBlocks;
+                    }
+                }
+                pool.release(blocks);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(corruptedBlocks == 0);
+}
+
+TEST_CASE("MemoryArenaPool") {
+    const auto blockSize = 1024u;
+    mem::MemoryArenaPool arenas(4, blockSize);
+
+    REQUIRE(arenas.arenasCount() == 4);
+
+    std::vector<std::thread> threads;
+    std::atomic<int> failedChecks = 0;
+    for (std::size_t t = 0; t < arenas.arenasCount(); ++t) {
+        threads.emplace_back([&arenas, &failedChecks, t] {
+            auto& arena = arenas.arena(t);
+            for (int i = 0; i < 100; ++i) {
+                int* const values = arena.alloc<int>(100);
+                std::fill_n(values, 100, static_cast<int>(t));
+                if (std::any_of(values, values + 100, [t](int v) {
+                        return v != static_cast<int>(t);
+                    })) {
+                    ++failedChecks;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(failedChecks == 0);
+
+    const auto allocSize = arenas.arena(0).totalAllocationSize();
+    arenas.resetAll();
+    CHECK(arenas.arena(0).totalAllocationSize() == allocSize);
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+// Compares the parallel reduce, scan and stable partition
+// with their serial std counterparts for growing input sizes.
+// The speedup column shows how the parallel versions scale
+// with the number of hardware threads.
+
+namespace parallel = idragnev::pbrt::parallel;
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double millisecondsPerRun(F&& func, const int repetitions) {
+    const auto start = Clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        func();
+    }
+    const auto elapsed =
+        std::chrono::duration<double, std::milli>(Clock::now() - start);
+
+    return elapsed.count() / repetitions;
+}
+
+void printRow(const char* name,
+              const std::size_t size,
+              const double serialMs,
+              const double parallelMs) {
+    std::printf("%-18s %12zu %12.3f %12.3f %10.2f\n",
+                name,
+                size,
+                serialMs,
+                parallelMs,
+                serialMs / parallelMs);
+}
+
+void benchmark(const std::size_t size, const int repetitions) {
+    std::vector<std::uint64_t> input(size);
+    std::iota(input.begin(), input.end(), std::uint64_t(0));
+    std::vector<std::uint64_t> output(size);
+    std::uint64_t sink = 0;
+
+    printRow(
+        "reduce",
+        size,
+        millisecondsPerRun(
+            [&] { sink += std::accumulate(input.begin(), input.end(), std::uint64_t(0)); },
+            repetitions),
+        millisecondsPerRun(
+            [&] {
+                sink += parallel::parallelReduce(
+                    static_cast<std::int64_t>(size),
+                    std::uint64_t(0),
+                    [&input](std::uint64_t& acc, const std::int64_t i) {
+                        acc += input[static_cast<std::size_t>(i)];
+                    },
+                    std::plus<>{});
+            },
+            repetitions));
+
+    printRow(
+        "inclusive scan",
+        size,
+        millisecondsPerRun(
+            [&] { std::inclusive_scan(input.begin(), input.end(), output.begin()); },
+            repetitions),
+        millisecondsPerRun(
+            [&] {
+                parallel::parallelInclusiveScan(input.begin(),
+                                                input.end(),
+                                                output.begin());
+            },
+            repetitions));
+
+    const auto isEven = [](const std::uint64_t x) { return x % 2 == 0; };
+    printRow(
+        "stable partition",
+        size,
+        millisecondsPerRun(
+            [&] {
+                output = input;
+                std::stable_partition(output.begin(), output.end(), isEven);
+            },
+            repetitions),
+        millisecondsPerRun(
+            [&] {
+                output = input;
+                parallel::parallelStablePartition(output.begin(),
+                                                  output.end(),
+                                                  isEven);
+            },
+            repetitions));
+
+    if (sink == 0) {
+        std::printf("unexpected sum\n");
+    }
+}
+
+int main() {
+    parallel::init();
+
+    std::printf("%-18s %12s %12s %12s %10s\n",
+                "algorithm",
+                "size",
+                "serial ms",
+                "parallel ms",
+                "speedup");
+
+    benchmark(1 << 14, 256);
+    benchmark(1 << 18, 32);
+    benchmark(1 << 22, 4);
+
+    parallel::cleanup();
+
+    return 0;
+}
\ No newline at end of file
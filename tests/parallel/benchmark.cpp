@@ -0,0 +1,221 @@
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Measures the scheduling overhead of parallelFor with
+// cheap loop bodies and small chunks, where the cost of
+// claiming a chunk dominates the cost of executing it.
+// Then compares fixed and guided chunking on workloads
+// where the cost of the iterations is skewed.
+
+namespace parallel = idragnev::pbrt::parallel;
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkCase
+{
+    std::int64_t iterationsCount = 0;
+    std::int64_t chunkSize = 1;
+    int repetitions = 1;
+};
+
+double nanosecondsPerIteration(const BenchmarkCase& c) {
+    std::vector<std::uint64_t> data(static_cast<std::size_t>(c.iterationsCount));
+
+    const auto start = Clock::now();
+    for (int r = 0; r < c.repetitions; ++r) {
+        parallel::parallelFor(
+            [&data](const std::int64_t i) {
+                data[static_cast<std::size_t>(i)] += static_cast<std::uint64_t>(i);
+            },
+            c.iterationsCount,
+            c.chunkSize);
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+
+    return elapsed.count() /
+           static_cast<double>(c.iterationsCount * c.repetitions);
+}
+
+double nanosecondsPerRangeIteration(const BenchmarkCase& c) {
+    std::vector<std::uint64_t> data(static_cast<std::size_t>(c.iterationsCount));
+
+    const auto start = Clock::now();
+    for (int r = 0; r < c.repetitions; ++r) {
+        parallel::parallelFor(
+            [&data](const std::int64_t first, const std::int64_t last) {
+                for (auto i = first; i < last; ++i) {
+                    data[static_cast<std::size_t>(i)] += static_cast<std::uint64_t>(i);
+                }
+            },
+            c.iterationsCount,
+            c.chunkSize);
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+
+    return elapsed.count() /
+           static_cast<double>(c.iterationsCount * c.repetitions);
+}
+
+double nanosecondsPerNestedIteration(const std::int64_t n) {
+    std::atomic<std::int64_t> sum = 0;
+
+    const auto start = Clock::now();
+    parallel::parallelFor(
+        [&sum, n](const std::int64_t i) {
+            parallel::parallelFor([&sum, i](const std::int64_t j) { sum += i * j; },
+                                  n);
+        },
+        n);
+    const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+
+    return elapsed.count() / static_cast<double>(n * n);
+}
+
+// Spins for about `work` units of work, so the optimizer can not remove it.
+std::uint64_t spin(const std::uint64_t work) {
+    std::uint64_t x = work;
+    for (std::uint64_t i = 0; i < work; ++i) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return x;
+}
+
+struct SkewedWorkload
+{
+    const char* name;
+    std::uint64_t (*workOf)(std::int64_t i, std::int64_t n);
+};
+
+double millisecondsPerSkewedLoop(const SkewedWorkload& w,
+                                 const std::int64_t n,
+                                 const parallel::Chunking chunking) {
+    std::atomic<std::uint64_t> sink = 0;
+
+    const auto start = Clock::now();
+    parallel::parallelFor(
+        [&sink, &w, n](const std::int64_t first, const std::int64_t last) {
+            std::uint64_t local = 0;
+            for (auto i = first; i < last; ++i) {
+                local += spin(w.workOf(i, n));
+            }
+            sink += local;
+        },
+        n,
+        chunking);
+    const auto elapsed =
+        std::chrono::duration<double, std::milli>(Clock::now() - start);
+
+    return elapsed.count();
+}
+
+void benchmarkSkewedWorkloads() {
+    const SkewedWorkload workloads[] = {
+        {"uniform", [](std::int64_t, std::int64_t) -> std::uint64_t { return 64; }},
+        // cost grows linearly with the iteration index
+        {"ramp",
+         [](const std::int64_t i, const std::int64_t n) -> std::uint64_t {
+             return static_cast<std::uint64_t>(1 + 128 * i / n);
+         }},
+        // a few hot spots, like tiles full of hair
+        {"hot spots",
+         [](const std::int64_t i, std::int64_t) -> std::uint64_t {
+             return i % 4096 < 64 ? 2048 : 8;
+         }},
+        // all the work at the end of the loop
+        {"heavy tail",
+         [](const std::int64_t i, const std::int64_t n) -> std::uint64_t {
+             return i >= n - n / 64 ? 4096 : 4;
+         }},
+    };
+
+    const struct
+    {
+        parallel::Chunking chunking;
+        const char* name;
+    } chunkings[] = {
+        {1, "fixed 1"},
+        {64, "fixed 64"},
+        {4096, "fixed 4096"},
+        {parallel::Chunking::guided(1), "guided 1"},
+        {parallel::Chunking::guided(64), "guided 64"},
+    };
+
+    const std::int64_t n = 1 << 18;
+
+    std::printf("\n%-14s", "ms/loop");
+    for (const auto& c : chunkings) {
+        std::printf(" %12s", c.name);
+    }
+    std::printf("\n");
+
+    parallel::init();
+    for (const SkewedWorkload& w : workloads) {
+        std::printf("%-14s", w.name);
+        for (const auto& c : chunkings) {
+            std::printf(" %12.2f", millisecondsPerSkewedLoop(w, n, c.chunking));
+        }
+        std::printf("\n");
+    }
+    parallel::cleanup();
+}
+
+int main() {
+    using parallel::Scheduler;
+
+    const BenchmarkCase cases[] = {
+        {.iterationsCount = 1 << 20, .chunkSize = 1, .repetitions = 4},
+        {.iterationsCount = 1 << 20, .chunkSize = 16, .repetitions = 16},
+        {.iterationsCount = 1 << 20, .chunkSize = 256, .repetitions = 64},
+        {.iterationsCount = 1 << 10, .chunkSize = 1, .repetitions = 4096},
+    };
+
+    const struct
+    {
+        Scheduler scheduler;
+        const char* name;
+    } schedulers[] = {
+        {Scheduler::WorkList, "work list"},
+        {Scheduler::WorkStealing, "work stealing"},
+    };
+
+    std::printf("%-14s %12s %10s %14s %14s\n",
+                "scheduler",
+                "iterations",
+                "chunk",
+                "ns/iteration",
+                "ns/iteration");
+    std::printf("%-14s %12s %10s %14s %14s\n",
+                "",
+                "",
+                "",
+                "(function)",
+                "(range)");
+
+    for (const auto& s : schedulers) {
+        parallel::init(s.scheduler);
+
+        for (const BenchmarkCase& c : cases) {
+            std::printf("%-14s %12lld %10lld %14.2f %14.2f\n",
+                        s.name,
+                        static_cast<long long>(c.iterationsCount),
+                        static_cast<long long>(c.chunkSize),
+                        nanosecondsPerIteration(c),
+                        nanosecondsPerRangeIteration(c));
+        }
+        std::printf("%-14s %12s %10d %14.2f\n",
+                    s.name,
+                    "nested 512^2",
+                    1,
+                    nanosecondsPerNestedIteration(512));
+
+        parallel::cleanup();
+    }
+
+    benchmarkSkewedWorkloads();
+
+    return 0;
+}
\ No newline at end of file
@@ -2,6 +2,17 @@
 #include "doctest/doctest.h"
 
 #include "pbrt/parallel/Parallel.hpp"
+#include "pbrt/parallel/ThreadLocal.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace parallel = idragnev::pbrt::parallel;
 
@@ -15,6 +26,41 @@ TEST_CASE("double cleanup is safe") {
     parallel::cleanup();
 }
 
+TEST_CASE("loops and algorithms run serially without init") {
+    std::vector<int> visits(10'000, 0);
+    parallel::parallelFor(
+        [&visits](const std::int64_t first, const std::int64_t last) {
+            CHECK(parallel::thisThreadIndex() == 0);
+            for (std::int64_t i = first; i < last; ++i) {
+                ++visits[static_cast<std::size_t>(i)];
+            }
+        },
+        static_cast<std::int64_t>(visits.size()),
+        1);
+    CHECK(std::all_of(visits.begin(), visits.end(), [](const int count) {
+        return count == 1;
+    }));
+
+    const auto sum = parallel::parallelReduce(
+        10'000,
+        std::int64_t(0),
+        [](std::int64_t& acc, const std::int64_t i) { acc += i; },
+        std::plus<>{},
+        7);
+    CHECK(sum == 10'000ll * 9'999 / 2);
+
+    std::vector<std::int64_t> values(10'000);
+    std::iota(values.begin(), values.end(), std::int64_t(0));
+    const auto pos = parallel::parallelStablePartition(
+        values.begin(),
+        values.end(),
+        [](const std::int64_t i) { return i % 3 == 0; },
+        7);
+    CHECK(pos - values.begin() == 3'334);
+    CHECK(std::is_sorted(values.begin(), pos));
+    CHECK(std::is_sorted(pos, values.end()));
+}
+
 TEST_CASE("parallelFor basics") {
     parallel::init();
 
@@ -101,4 +147,754 @@ TEST_CASE("parallelFor2D") {
     }
 
     parallel::cleanup();
+}
+
+TEST_CASE("parallelFor over ranges") {
+    parallel::init();
+
+    SUBCASE("chunks cover the iterations without overlapping") {
+        const std::int64_t iterationsCount = 1'000;
+        const std::int64_t chunkSize = 64;
+        std::vector<std::atomic<int>> visits(iterationsCount);
+        std::atomic<bool> chunksAreBounded = true;
+
+        parallel::parallelFor(
+            [&](const std::int64_t first, const std::int64_t last) {
+                if (last - first > chunkSize || first >= last) {
+                    chunksAreBounded = false;
+                }
+                for (auto i = first; i < last; ++i) {
+                    ++visits[static_cast<std::size_t>(i)];
+                }
+            },
+            iterationsCount,
+            chunkSize);
+
+        CHECK(chunksAreBounded);
+        for (const auto& v : visits) {
+            REQUIRE(v == 1);
+        }
+    }
+
+    SUBCASE("with a const callable") {
+        std::atomic<int> n = 0;
+        const auto func = [&n](const std::int64_t first,
+                               const std::int64_t last) {
+            n += static_cast<int>(last - first);
+        };
+
+        parallel::parallelFor(func, 100, 3);
+
+        CHECK(n == 100);
+    }
+
+    parallel::cleanup();
+}
+
+parallel::ThreadPoolOptions
+poolOptions(const parallel::Scheduler scheduler,
+            const int threadsCount = 0,
+            const parallel::ThreadAffinity affinity = parallel::ThreadAffinity::None,
+            std::vector<int> cores = {}) {
+    parallel::ThreadPoolOptions options;
+    options.scheduler = scheduler;
+    options.threadsCount = threadsCount;
+    options.affinity = affinity;
+    options.cores = std::move(cores);
+
+    return options;
+}
+
+void checkEachIterationIsExecutedOnce(const parallel::ThreadPoolOptions& options) {
+    parallel::init(options);
+
+    const std::int64_t iterationsCount = 10'000;
+    std::vector<std::atomic<int>> visits(iterationsCount);
+
+    parallel::parallelFor(
+        [&visits](const auto i) { ++visits[static_cast<std::size_t>(i)]; },
+        iterationsCount,
+        7);
+
+    for (const auto& v : visits) {
+        REQUIRE(v == 1);
+    }
+
+    parallel::cleanup();
+}
+
+void checkNestedParallelFor2D(const parallel::Scheduler s) {
+    parallel::init(s);
+
+    const std::int64_t n = 16;
+    std::atomic<int> count = 0;
+
+    parallel::parallelFor(
+        [&count, n](auto) {
+            parallel::parallelFor2D([&count](auto...) { ++count; }, n, n);
+        },
+        n);
+
+    CHECK(count == n * n * n);
+
+    parallel::cleanup();
+}
+
+TEST_CASE("work list scheduler") {
+    checkEachIterationIsExecutedOnce(poolOptions(parallel::Scheduler::WorkList));
+    checkNestedParallelFor2D(parallel::Scheduler::WorkList);
+}
+
+TEST_CASE("work stealing scheduler") {
+    checkEachIterationIsExecutedOnce(poolOptions(parallel::Scheduler::WorkStealing));
+    checkNestedParallelFor2D(parallel::Scheduler::WorkStealing);
+}
+
+std::vector<int> threadIndicesOfIterations(const std::int64_t iterationsCount) {
+    std::vector<int> indices(static_cast<std::size_t>(iterationsCount));
+    parallel::parallelFor(
+        [&indices](const std::int64_t i) {
+            indices[static_cast<std::size_t>(i)] = parallel::thisThreadIndex();
+        },
+        iterationsCount);
+
+    return indices;
+}
+
+TEST_CASE("thread pool options") {
+    using parallel::ThreadAffinity;
+    constexpr auto WorkStealing = parallel::Scheduler::WorkStealing;
+
+    SUBCASE("the thread count includes the calling thread") {
+        parallel::init(poolOptions(WorkStealing, 3));
+
+        CHECK(parallel::threadsCount() == 3);
+        CHECK(parallel::thisThreadIndex() == 0);
+        for (const int i : threadIndicesOfIterations(10'000)) {
+            REQUIRE((0 <= i && i < 3));
+        }
+
+        parallel::cleanup();
+        CHECK(parallel::threadsCount() == 1);
+    }
+
+    SUBCASE("a single thread executes the loops serially") {
+        parallel::init(poolOptions(WorkStealing, 1));
+
+        for (const int i : threadIndicesOfIterations(1'000)) {
+            REQUIRE(i == 0);
+        }
+
+        parallel::cleanup();
+    }
+
+    SUBCASE("pinned threads execute each iteration once") {
+        checkEachIterationIsExecutedOnce(
+            poolOptions(WorkStealing, 4, ThreadAffinity::Compact));
+        checkEachIterationIsExecutedOnce(
+            poolOptions(WorkStealing, 4, ThreadAffinity::Scatter));
+        checkEachIterationIsExecutedOnce(
+            poolOptions(WorkStealing, 4, ThreadAffinity::ExplicitCores, {0}));
+    }
+
+    SUBCASE("the NUMA node of a thread is never negative") {
+        parallel::init(poolOptions(WorkStealing, 0, ThreadAffinity::Compact));
+
+        std::atomic<int> negativeNodes = 0;
+        parallel::parallelFor(
+            [&negativeNodes](std::int64_t) {
+                if (parallel::thisThreadNumaNode() < 0) {
+                    ++negativeNodes;
+                }
+            },
+            1'000);
+        CHECK(negativeNodes == 0);
+
+        parallel::cleanup();
+    }
+}
+
+std::int64_t fibonacci(const std::int64_t n) {
+    if (n < 2) {
+        return n;
+    }
+
+    std::int64_t a = 0;
+    parallel::TaskGroup group;
+    group.spawn([&a, n] { a = fibonacci(n - 1); });
+    const std::int64_t b = fibonacci(n - 2);
+    group.wait();
+
+    return a + b;
+}
+
+void checkTaskGroups(const parallel::ThreadPoolOptions& options) {
+    parallel::init(options);
+
+    CHECK(fibonacci(20) == 6765);
+
+    std::atomic<int> count = 0;
+    parallel::parallelFor(
+        [&count](std::int64_t) {
+            parallel::TaskGroup group;
+            for (int i = 0; i < 8; ++i) {
+                group.spawn([&count] {
+                    parallel::parallelFor([&count](std::int64_t) { ++count; },
+                                          16);
+                });
+            }
+        },
+        64);
+    CHECK(count == 64 * 8 * 16);
+
+    parallel::cleanup();
+}
+
+// Sibling tasks run unrelated loops, so a loop may end while
+// a loop started after it is still running and the other way around
+void checkSiblingLoopsOfDifferentLengths(
+    const parallel::ThreadPoolOptions& options) {
+    parallel::init(options);
+
+    const auto slowIteration = [](std::atomic<int>& count) {
+        std::this_thread::sleep_for(std::chrono::microseconds{100});
+        ++count;
+    };
+
+    for (int round = 0; round < 20; ++round) {
+        std::atomic<int> shortCount = 0;
+        std::atomic<int> longCount = 0;
+        {
+            parallel::TaskGroup group;
+            group.spawn([&] {
+                parallel::parallelFor(
+                    [&](std::int64_t) { slowIteration(shortCount); },
+                    8);
+            });
+            group.spawn([&] {
+                parallel::parallelFor(
+                    [&](std::int64_t) { slowIteration(longCount); },
+                    128);
+            });
+        }
+        REQUIRE(shortCount == 8);
+        REQUIRE(longCount == 128);
+    }
+
+    // the work list is left empty
+    std::atomic<int> count = 0;
+    parallel::parallelFor([&count](std::int64_t) { ++count; }, 1'000);
+    CHECK(count == 1'000);
+
+    parallel::cleanup();
+}
+
+TEST_CASE("task groups") {
+    using parallel::Scheduler;
+
+    SUBCASE("waiting with no spawned tasks returns immediately") {
+        parallel::TaskGroup group;
+        group.wait();
+    }
+
+    SUBCASE("tasks run inline without init") {
+        int value = 0;
+        parallel::TaskGroup group;
+        group.spawn([&value] { value = 42; });
+        CHECK(value == 42);
+    }
+
+    SUBCASE("nested fork-join with the work stealing scheduler") {
+        checkTaskGroups(poolOptions(Scheduler::WorkStealing));
+    }
+
+    SUBCASE("nested fork-join with the work list scheduler") {
+        checkTaskGroups(poolOptions(Scheduler::WorkList));
+    }
+
+    SUBCASE("sibling loops of different lengths with the work list "
+            "scheduler") {
+        checkSiblingLoopsOfDifferentLengths(
+            poolOptions(Scheduler::WorkList, 4));
+    }
+
+    SUBCASE("sibling loops of different lengths with the work stealing "
+            "scheduler") {
+        checkSiblingLoopsOfDifferentLengths(
+            poolOptions(Scheduler::WorkStealing, 4));
+    }
+
+    SUBCASE("nested fork-join with a single thread") {
+        checkTaskGroups(poolOptions(Scheduler::WorkStealing, 1));
+    }
+
+    SUBCASE("more threads than cores") {
+        checkTaskGroups(poolOptions(Scheduler::WorkStealing, 8));
+    }
+}
+
+TEST_CASE("orderedTiles") {
+    using parallel::TileOrder;
+    using parallel::detail::orderedTiles;
+    using parallel::detail::Tile;
+
+    const auto isPermutationOfGrid = [](const std::vector<Tile>& tiles,
+                                        const std::int64_t nX,
+                                        const std::int64_t nY) {
+        std::vector<int> visits(static_cast<std::size_t>(nX * nY));
+        for (const Tile& t : tiles) {
+            if (t.x < 0 || t.x >= nX || t.y < 0 || t.y >= nY) {
+                return false;
+            }
+            ++visits[static_cast<std::size_t>(t.y * nX + t.x)];
+        }
+
+        return std::all_of(visits.begin(), visits.end(), [](const int v) {
+            return v == 1;
+        });
+    };
+
+    SUBCASE("each order visits every tile exactly once") {
+        const std::int64_t nX = 13;
+        const std::int64_t nY = 7;
+
+        for (const auto order : {TileOrder::Scanline,
+                                 TileOrder::Morton,
+                                 TileOrder::Hilbert,
+                                 TileOrder::Spiral}) {
+            const auto tiles = orderedTiles(nX, nY, order);
+
+            CHECK(tiles.size() == static_cast<std::size_t>(nX * nY));
+            CHECK(isPermutationOfGrid(tiles, nX, nY));
+        }
+    }
+
+    SUBCASE("consecutive Hilbert tiles are neighbours") {
+        const auto tiles = orderedTiles(16, 16, TileOrder::Hilbert);
+
+        for (std::size_t i = 1; i < tiles.size(); ++i) {
+            const auto distance = std::abs(tiles[i].x - tiles[i - 1].x) +
+                                  std::abs(tiles[i].y - tiles[i - 1].y);
+            REQUIRE(distance == 1);
+        }
+    }
+
+    SUBCASE("Morton order groups 2x2 blocks") {
+        const auto tiles = orderedTiles(4, 4, TileOrder::Morton);
+
+        for (std::size_t i = 0; i < 4; ++i) {
+            CHECK(tiles[i].x < 2);
+            CHECK(tiles[i].y < 2);
+        }
+    }
+
+    SUBCASE("spiral order starts at the centre") {
+        const auto tiles = orderedTiles(5, 5, TileOrder::Spiral);
+
+        CHECK(tiles[0].x == 2);
+        CHECK(tiles[0].y == 2);
+        for (std::size_t i = 1; i < 9; ++i) {
+            CHECK(std::abs(tiles[i].x - 2) <= 1);
+            CHECK(std::abs(tiles[i].y - 2) <= 1);
+        }
+    }
+}
+
+TEST_CASE("parallelFor2D with tile scheduling") {
+    parallel::init();
+
+    const std::int64_t nX = 9;
+    const std::int64_t nY = 11;
+
+    for (const auto order : {parallel::TileOrder::Morton,
+                             parallel::TileOrder::Hilbert,
+                             parallel::TileOrder::Spiral}) {
+        std::vector<std::atomic<int>> visits(nX * nY);
+
+        parallel::parallelFor2D(
+            [&visits, nX](const std::int64_t x, const std::int64_t y) {
+                ++visits[static_cast<std::size_t>(y * nX + x)];
+            },
+            nX,
+            nY,
+            parallel::TileScheduling{.order = order, .tilesPerChunk = 4});
+
+        for (const auto& v : visits) {
+            REQUIRE(v == 1);
+        }
+    }
+
+    parallel::cleanup();
+}
+
+TEST_CASE("parallel algorithms") {
+    parallel::init();
+
+    // small blocks so even short inputs are split among many tasks
+    const std::int64_t blockSize = 7;
+
+    std::vector<std::int64_t> input(1'000);
+    std::iota(input.begin(), input.end(), std::int64_t(-300));
+
+    SUBCASE("parallelReduce") {
+        SUBCASE("with no iterations returns the identity") {
+            const auto result = parallel::parallelReduce(
+                0,
+                42,
+                [](int& acc, auto) { ++acc; },
+                std::plus<>{},
+                blockSize);
+
+            CHECK(result == 42);
+        }
+
+        SUBCASE("matches the serial reduction") {
+            const auto count = static_cast<std::int64_t>(input.size());
+            const auto result = parallel::parallelReduce(
+                count,
+                std::int64_t(0),
+                [&input](std::int64_t& acc, const std::int64_t i) {
+                    acc += input[static_cast<std::size_t>(i)];
+                },
+                std::plus<>{},
+                blockSize);
+
+            CHECK(result == std::accumulate(input.begin(), input.end(), 0ll));
+        }
+
+        SUBCASE("combines the blocks in order") {
+            const auto result = parallel::parallelReduce(
+                20,
+                std::string{},
+                [](std::string& acc, const std::int64_t i) {
+                    acc += static_cast<char>('a' + i);
+                },
+                std::plus<>{},
+                3);
+
+            CHECK(result == "abcdefghijklmnopqrst");
+        }
+    }
+
+    SUBCASE("parallelInclusiveScan matches std::inclusive_scan") {
+        std::vector<std::int64_t> expected(input.size());
+        std::inclusive_scan(input.begin(), input.end(), expected.begin());
+
+        SUBCASE("out of place") {
+            std::vector<std::int64_t> result(input.size());
+            parallel::parallelInclusiveScan(input.begin(),
+                                            input.end(),
+                                            result.begin(),
+                                            std::plus<>{},
+                                            blockSize);
+
+            CHECK(result == expected);
+        }
+
+        SUBCASE("in place") {
+            parallel::parallelInclusiveScan(input.begin(),
+                                            input.end(),
+                                            input.begin(),
+                                            std::plus<>{},
+                                            blockSize);
+
+            CHECK(input == expected);
+        }
+    }
+
+    SUBCASE("parallelExclusiveScan matches std::exclusive_scan") {
+        std::vector<std::int64_t> expected(input.size());
+        std::exclusive_scan(input.begin(),
+                            input.end(),
+                            expected.begin(),
+                            std::int64_t(5));
+
+        SUBCASE("out of place") {
+            std::vector<std::int64_t> result(input.size());
+            parallel::parallelExclusiveScan(input.begin(),
+                                            input.end(),
+                                            result.begin(),
+                                            std::int64_t(5),
+                                            std::plus<>{},
+                                            blockSize);
+
+            CHECK(result == expected);
+        }
+
+        SUBCASE("in place") {
+            parallel::parallelExclusiveScan(input.begin(),
+                                            input.end(),
+                                            input.begin(),
+                                            std::int64_t(5),
+                                            std::plus<>{},
+                                            blockSize);
+
+            CHECK(input == expected);
+        }
+    }
+
+    SUBCASE("parallelStablePartition matches std::stable_partition") {
+        const auto isEven = [](const std::int64_t i) { return i % 2 == 0; };
+        const auto isSmall = [](const std::int64_t i) { return i < 10; };
+
+        for (const auto& pred : {std::function<bool(std::int64_t)>{isEven},
+                                 std::function<bool(std::int64_t)>{isSmall}}) {
+            std::vector<std::int64_t> expected = input;
+            const auto expectedPos =
+                std::stable_partition(expected.begin(), expected.end(), pred);
+
+            std::vector<std::int64_t> result = input;
+            const auto pos = parallel::parallelStablePartition(result.begin(),
+                                                               result.end(),
+                                                               pred,
+                                                               blockSize);
+
+            CHECK(result == expected);
+            CHECK(pos - result.begin() == expectedPos - expected.begin());
+        }
+    }
+
+    SUBCASE("parallelStablePartition moves non-copyable elements") {
+        std::vector<std::unique_ptr<int>> ptrs;
+        for (int i = 0; i < 100; ++i) {
+            ptrs.push_back(std::make_unique<int>(i));
+        }
+
+        const auto pos = parallel::parallelStablePartition(
+            ptrs.begin(),
+            ptrs.end(),
+            [](const auto& p) { return *p >= 50; },
+            blockSize);
+
+        REQUIRE(pos - ptrs.begin() == 50);
+        for (std::size_t i = 0; i < ptrs.size(); ++i) {
+            REQUIRE(ptrs[i] != nullptr);
+            CHECK(*ptrs[i] == static_cast<int>((i + 50) % 100));
+        }
+    }
+
+    parallel::cleanup();
+}
+
+TEST_CASE("ThreadLocal") {
+    parallel::init(poolOptions(parallel::Scheduler::WorkStealing, 4));
+
+    SUBCASE("each thread gets its own value") {
+        parallel::ThreadLocal<int> threadIndices(
+            [](const int threadIndex) { return threadIndex; });
+
+        std::atomic<int> mismatches = 0;
+        parallel::parallelFor(
+            [&threadIndices, &mismatches](std::int64_t) {
+                if (threadIndices.get() != parallel::thisThreadIndex()) {
+                    ++mismatches;
+                }
+            },
+            1'000);
+        CHECK(mismatches == 0);
+    }
+
+    SUBCASE("combining per-thread counters") {
+        parallel::ThreadLocal<std::int64_t> sums;
+
+        parallel::parallelFor([&sums](const std::int64_t i) { sums.get() += i; },
+                              10'000);
+
+        CHECK(sums.combine(std::int64_t(0), std::plus<>{}) == 49'995'000);
+    }
+
+    SUBCASE("forEach visits only the created values") {
+        parallel::ThreadLocal<std::vector<int>> values;
+        values.get().push_back(1);
+
+        int visited = 0;
+        values.forEach([&visited](std::vector<int>& v) {
+            CHECK(v.size() == 1);
+            ++visited;
+        });
+        CHECK(visited == 1);
+    }
+
+    SUBCASE("values are in separate cache lines") {
+        parallel::ThreadLocal<char> values;
+        parallel::parallelFor([&values](std::int64_t) { values.get() = 1; }, 1'000);
+
+        std::vector<const char*> addresses;
+        values.forEach([&addresses](char& c) { addresses.push_back(&c); });
+        for (std::size_t i = 1; i < addresses.size(); ++i) {
+            CHECK(addresses[i] - addresses[i - 1] >= 64);
+        }
+    }
+
+    parallel::cleanup();
+}
+
+TEST_CASE("loop control") {
+    parallel::init();
+
+    SUBCASE("a cancelled loop skips all chunks") {
+        parallel::CancellationToken token;
+        token.cancel();
+
+        parallel::LoopControl control;
+        control.cancellation = &token;
+
+        std::atomic<int> executed = 0;
+        parallel::parallelFor([&executed](std::int64_t) { ++executed; },
+                              1'000,
+                              1,
+                              control);
+        CHECK(executed == 0);
+    }
+
+    SUBCASE("cancelling a running loop stops it") {
+        parallel::CancellationToken token;
+        parallel::LoopControl control;
+        control.cancellation = &token;
+
+        const std::int64_t iterationsCount = 100'000;
+        std::atomic<std::int64_t> executed = 0;
+        parallel::parallelFor(
+            [&executed, &token](std::int64_t) {
+                if (++executed == 100) {
+                    token.cancel();
+                }
+            },
+            iterationsCount,
+            1,
+            control);
+        CHECK(executed < iterationsCount);
+    }
+
+    SUBCASE("progress is reported until the loop ends") {
+        std::vector<parallel::LoopProgress> reports;
+        parallel::LoopControl control;
+        control.progressInterval = std::chrono::milliseconds{0};
+        control.onProgress = [&reports](const parallel::LoopProgress& p) {
+            reports.push_back(p);
+        };
+
+        parallel::parallelFor2D([](std::int64_t, std::int64_t) {},
+                                16,
+                                16,
+                                {},
+                                control);
+
+        REQUIRE(reports.size() > 1);
+        for (std::size_t i = 1; i < reports.size(); ++i) {
+            CHECK(reports[i - 1].completedIterations <=
+                  reports[i].completedIterations);
+        }
+        CHECK(reports.back().completedIterations == 256);
+        CHECK(reports.back().totalIterations == 256);
+        CHECK(reports.back().estimatedTimeLeft.count() == 0.0);
+    }
+
+    parallel::cleanup();
+}
+
+void checkGuidedChunking(const parallel::Scheduler s) {
+    parallel::init(poolOptions(s, 8));
+
+    const std::int64_t iterationsCount = 100'000;
+    const std::int64_t minChunkSize = 8;
+
+    std::vector<std::atomic<int>> visits(iterationsCount);
+    std::atomic<std::int64_t> largestChunk = 0;
+    std::atomic<int> chunksBelowMinSize = 0;
+
+    parallel::parallelFor(
+        [&](const std::int64_t first, const std::int64_t last) {
+            for (auto i = first; i < last; ++i) {
+                ++visits[static_cast<std::size_t>(i)];
+            }
+
+            // only the last chunk of the loop may be smaller
+            if (last - first < minChunkSize && last != iterationsCount) {
+                ++chunksBelowMinSize;
+            }
+
+            auto largest = largestChunk.load();
+            while (last - first > largest &&
+                   !largestChunk.compare_exchange_weak(largest, last - first)) {
+            }
+        },
+        iterationsCount,
+        parallel::Chunking::guided(minChunkSize));
+
+    for (const auto& v : visits) {
+        REQUIRE(v == 1);
+    }
+    CHECK(largestChunk > minChunkSize);
+    CHECK(chunksBelowMinSize == 0);
+
+    parallel::cleanup();
+}
+
+TEST_CASE("guided chunking") {
+    SUBCASE("chunk sizes") {
+        const parallel::Chunking fixed = 16;
+        CHECK(!fixed.isGuided());
+        CHECK(fixed.nextChunkSize(1'000'000, 8) == 16);
+
+        const auto guided = parallel::Chunking::guided(4);
+        CHECK(guided.isGuided());
+        CHECK(guided.nextChunkSize(1'600, 8) == 100);
+        CHECK(guided.nextChunkSize(100, 8) == 6);
+        CHECK(guided.nextChunkSize(10, 8) == 4);
+        CHECK(guided.nextChunkSize(6, 8) == 6);
+    }
+
+    SUBCASE("work stealing scheduler") {
+        checkGuidedChunking(parallel::Scheduler::WorkStealing);
+    }
+
+    SUBCASE("work list scheduler") {
+        checkGuidedChunking(parallel::Scheduler::WorkList);
+    }
+}
+
+TEST_CASE("Barrier") {
+    SUBCASE("no thread passes before all arrive") {
+        const int threadsCount = 4;
+        std::atomic<int> arrived = 0;
+        std::atomic<int> passedEarly = 0;
+
+        auto barrier = std::make_unique<parallel::Barrier>(threadsCount);
+        const auto body = [&] {
+            ++arrived;
+            barrier->wait();
+            if (arrived != threadsCount) {
+                ++passedEarly;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadsCount; ++i) {
+            threads.emplace_back(body);
+        }
+        body();
+        // the barrier may be destroyed as soon as this thread passes it
+        barrier.reset();
+
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        CHECK(passedEarly == 0);
+    }
+
+    SUBCASE("back-to-back loops with few chunks") {
+        parallel::init(poolOptions(parallel::Scheduler::WorkList, 4));
+
+        std::int64_t sum = 0;
+        for (int i = 0; i < 1'000; ++i) {
+            std::atomic<std::int64_t> loopSum = 0;
+            parallel::parallelFor([&loopSum](const std::int64_t j) { loopSum += j; },
+                                  2);
+            sum += loopSum;
+        }
+        CHECK(sum == 1'000);
+
+        parallel::cleanup();
+    }
 }
\ No newline at end of file
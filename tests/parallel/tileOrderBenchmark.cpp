@@ -0,0 +1,195 @@
+#include "pbrt/parallel/Parallel.hpp"
+
+#include "perfEventCounter.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Emulates the memory access pattern of rendering image tiles against a BVH:
+// the image plane is covered by an implicit quadtree whose nodes are stored
+// level by level in one array, each level in Morton order, like a flattened
+// BVH built over Morton codes. Each pixel reads the
+// nodes on the path from the root to the leaf containing it, so neighbouring
+// tiles share their upper subtrees and the tile visit order decides how many
+// of those nodes are still cached when the next tile starts.
+//
+// Along with the time per frame, the L1 data and last level cache read
+// misses of all threads are counted where perf events are available.
+// The L1 misses are the reads which go to L2.
+
+namespace parallel = idragnev::pbrt::parallel;
+namespace benchmarks = idragnev::pbrt::benchmarks;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    struct alignas(64) Node
+    {
+        float data[16] = {};
+    };
+
+    constexpr int TREE_DEPTH = 10;
+    constexpr std::int64_t IMAGE_EXTENT = 1 << TREE_DEPTH;
+    constexpr std::int64_t TILE_EXTENT = 16;
+    constexpr std::int64_t TILES_PER_AXIS = IMAGE_EXTENT / TILE_EXTENT;
+
+    std::size_t nodesCount() {
+        std::size_t count = 0;
+        for (std::size_t level = 0, n = 1; level <= TREE_DEPTH; ++level, n *= 4) {
+            count += n;
+        }
+        return count;
+    }
+
+    std::size_t interleaveBits(std::size_t x, std::size_t y) {
+        std::size_t result = 0;
+        for (int bit = 0; bit < TREE_DEPTH; ++bit) {
+            result |= ((x >> bit) & 1) << (2 * bit);
+            result |= ((y >> bit) & 1) << (2 * bit + 1);
+        }
+        return result;
+    }
+
+    float traverse(const std::vector<Node>& nodes,
+                   const std::int64_t x,
+                   const std::int64_t y) {
+        const std::size_t leafCode = interleaveBits(static_cast<std::size_t>(x),
+                                                    static_cast<std::size_t>(y));
+        float sum = 0.f;
+        std::size_t levelStart = 0;
+        std::size_t levelNodes = 1;
+        for (int level = 0; level <= TREE_DEPTH; ++level) {
+            const auto code = leafCode >> (2 * (TREE_DEPTH - level));
+            const Node& node = nodes[levelStart + code];
+
+            sum += node.data[static_cast<std::size_t>(x + y) & 15];
+
+            levelStart += levelNodes;
+            levelNodes *= 4;
+        }
+        return sum;
+    }
+
+    struct FrameStats
+    {
+        double milliseconds = 0.;
+        // per frame, for each counter
+        double misses[2] = {};
+    };
+
+    FrameStats measureFrames(const std::vector<Node>& nodes,
+                             std::vector<float>& image,
+                             const parallel::TileScheduling& scheduling,
+                             const int frames,
+                             benchmarks::PerfEventCounter (&counters)[2]) {
+        for (auto& counter : counters) {
+            counter.start();
+        }
+        const auto start = Clock::now();
+        for (int f = 0; f < frames; ++f) {
+            parallel::parallelFor2D(
+                [&nodes, &image](const std::int64_t tileX,
+                                 const std::int64_t tileY) {
+                    for (std::int64_t y = tileY * TILE_EXTENT;
+                         y < (tileY + 1) * TILE_EXTENT;
+                         ++y) {
+                        for (std::int64_t x = tileX * TILE_EXTENT;
+                             x < (tileX + 1) * TILE_EXTENT;
+                             ++x) {
+                            image[static_cast<std::size_t>(y * IMAGE_EXTENT + x)] +=
+                                traverse(nodes, x, y);
+                        }
+                    }
+                },
+                TILES_PER_AXIS,
+                TILES_PER_AXIS,
+                scheduling);
+        }
+        const auto elapsed =
+            std::chrono::duration<double, std::milli>(Clock::now() - start);
+
+        FrameStats result;
+        result.milliseconds = elapsed.count() / frames;
+        for (std::size_t i = 0; i < 2; ++i) {
+            result.misses[i] =
+                static_cast<double>(counters[i].stop()) / frames;
+        }
+        return result;
+    }
+
+    void printMisses(const benchmarks::PerfEventCounter& counter,
+                     const double misses) {
+        if (counter.isAvailable()) {
+            std::printf(" %14.0f", misses);
+        }
+        else {
+            std::printf(" %14s", "n/a");
+        }
+    }
+} // namespace
+
+int main() {
+    using parallel::TileOrder;
+
+    const std::vector<Node> nodes(nodesCount());
+    std::vector<float> image(IMAGE_EXTENT * IMAGE_EXTENT);
+
+    const struct
+    {
+        TileOrder order;
+        const char* name;
+    } orders[] = {
+        {TileOrder::Scanline, "scanline"},
+        {TileOrder::Morton, "morton"},
+        {TileOrder::Hilbert, "hilbert"},
+        {TileOrder::Spiral, "spiral"},
+    };
+
+    // opened before the workers are started, so they are counted too
+    benchmarks::PerfEventCounter counters[2] = {
+        benchmarks::PerfEventCounter{benchmarks::CacheEvent::L1DataReadMisses,
+                                     true},
+        benchmarks::PerfEventCounter{
+            benchmarks::CacheEvent::LastLevelReadMisses,
+            true},
+    };
+
+    parallel::init();
+
+    std::printf("%zu nodes (%zu MB), %lldx%lld tiles\n",
+                nodes.size(),
+                nodes.size() * sizeof(Node) / (1024 * 1024),
+                static_cast<long long>(TILES_PER_AXIS),
+                static_cast<long long>(TILES_PER_AXIS));
+    std::printf("%-10s %16s %14s %14s %14s\n",
+                "order",
+                "tiles per chunk",
+                "ms/frame",
+                "L1d miss/frame",
+                "LLC miss/frame");
+
+    for (const auto& o : orders) {
+        for (const std::int64_t tilesPerChunk : {1, 4, 16}) {
+            const auto scheduling = parallel::TileScheduling{
+                .order = o.order,
+                .tilesPerChunk = tilesPerChunk,
+            };
+
+            const FrameStats stats =
+                measureFrames(nodes, image, scheduling, 4, counters);
+            std::printf("%-10s %16lld %14.2f",
+                        o.name,
+                        static_cast<long long>(tilesPerChunk),
+                        stats.milliseconds);
+            for (std::size_t i = 0; i < 2; ++i) {
+                printMisses(counters[i], stats.misses[i]);
+            }
+            std::printf("\n");
+        }
+    }
+
+    parallel::cleanup();
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "doctest/doctest.h"
+
+#include "testMeshes.hpp"
+#include "pbrt/shapes/MeshCache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace pbrt = idragnev::pbrt;
+namespace shapes = idragnev::pbrt::shapes;
+namespace fs = std::filesystem;
+
+using shapes::MeshStorage;
+
+namespace {
+    // The offsets of the header fields as written by writeMeshCache
+    constexpr std::size_t VERSION_OFFSET = 8;
+    constexpr std::size_t FLOAT_SIZE_OFFSET = 16;
+    constexpr std::size_t STORAGE_OFFSET = 20;
+    constexpr std::size_t TRIANGLES_COUNT_OFFSET = 24;
+    constexpr std::size_t VERTEX_INDEX_BYTES_OFFSET = 32;
+    // of the offset of the vertex indices section
+    constexpr std::size_t VERTEX_INDICES_OFFSET = 56;
+
+    struct TemporaryPath
+    {
+        explicit TemporaryPath(const std::string& name)
+            : path(fs::temp_directory_path() / name) {}
+        ~TemporaryPath() {
+            std::error_code error;
+            fs::remove(path, error);
+        }
+
+        fs::path path;
+    };
+
+    std::string readFile(const fs::path& path) {
+        std::ifstream file{path, std::ios::binary};
+        return std::string(std::istreambuf_iterator<char>{file}, {});
+    }
+
+    void writeFile(const fs::path& path, const std::string& contents) {
+        std::ofstream file{path, std::ios::binary};
+        file.write(contents.data(),
+                   static_cast<std::streamsize>(contents.size()));
+    }
+
+    template <typename T>
+    T readAt(const std::string& bytes, const std::size_t offset) {
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void writeAt(std::string& bytes, const std::size_t offset, const T value) {
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    void checkSameMeshes(const shapes::TriangleMesh& loaded,
+                         const shapes::TriangleMesh& mesh) {
+        REQUIRE(loaded.trianglesCount == mesh.trianglesCount);
+        REQUIRE(loaded.verticesCount == mesh.verticesCount);
+        CHECK(loaded.storage == mesh.storage);
+
+        REQUIRE(loaded.vertexIndices.size() == mesh.vertexIndices.size());
+        CHECK(loaded.vertexIndices.bytesPerIndex() ==
+              mesh.vertexIndices.bytesPerIndex());
+        for (std::size_t i = 0; i < mesh.vertexIndices.size(); ++i) {
+            CHECK(loaded.vertexIndices[i] == mesh.vertexIndices[i]);
+        }
+        for (unsigned i = 0; i < mesh.trianglesCount; ++i) {
+            CHECK(loaded.faceIndex(i) == mesh.faceIndex(i));
+        }
+
+        REQUIRE(loaded.hasNormals() == mesh.hasNormals());
+        REQUIRE(loaded.hasTangents() == mesh.hasTangents());
+        REQUIRE(loaded.hasUVs() == mesh.hasUVs());
+        for (std::size_t v = 0; v < mesh.verticesCount; ++v) {
+            CHECK(loaded.vertexWorldCoordinates[v] ==
+                  mesh.vertexWorldCoordinates[v]);
+            if (mesh.hasNormals()) {
+                CHECK(loaded.normal(v) == mesh.normal(v));
+            }
+            if (mesh.hasTangents()) {
+                CHECK(loaded.tangent(v) == mesh.tangent(v));
+            }
+            if (mesh.hasUVs()) {
+                CHECK(loaded.uv(v) == mesh.uv(v));
+            }
+        }
+    }
+
+    // The cache of a mesh written and read back as bytes
+    std::string cacheOf(const shapes::TriangleMesh& mesh) {
+        const TemporaryPath cache{"pbrt_mesh_cache_test_source.bin"};
+        REQUIRE(shapes::writeMeshCache(mesh, cache.path));
+        return readFile(cache.path);
+    }
+
+    bool loads(const std::string& contents) {
+        const TemporaryPath cache{"pbrt_mesh_cache_test_modified.bin"};
+        writeFile(cache.path, contents);
+        return shapes::loadMeshCache(cache.path) != nullptr;
+    }
+
+    void checkMalformedCaches(const MeshStorage storage) {
+        pbrt::rng::RNG rng;
+        const auto data = pbrt::tests::randomMeshData(100, rng);
+
+        const std::string contents =
+            cacheOf(*pbrt::tests::createMesh(data, storage));
+        REQUIRE(loads(contents));
+
+        SUBCASE("truncated") {
+            for (const std::size_t size : {std::size_t{0},
+                                           std::size_t{8},
+                                           std::size_t{64},
+                                           contents.size() / 2,
+                                           contents.size() - 1}) {
+                CHECK_FALSE(loads(contents.substr(0, size)));
+            }
+        }
+        SUBCASE("corrupted header") {
+            std::string modified = contents;
+            SUBCASE("magic") { modified[0] = 'X'; }
+            SUBCASE("version") {
+                writeAt<std::uint32_t>(modified, VERSION_OFFSET, 1000);
+            }
+            SUBCASE("Float size") {
+                writeAt<std::uint32_t>(modified, FLOAT_SIZE_OFFSET, 3);
+            }
+            SUBCASE("storage") {
+                writeAt<std::uint32_t>(modified, STORAGE_OFFSET, 7);
+            }
+            SUBCASE("triangles count") {
+                writeAt<std::uint32_t>(modified,
+                                       TRIANGLES_COUNT_OFFSET,
+                                       data.trianglesCount + 1);
+            }
+            SUBCASE("index size") {
+                writeAt<std::uint32_t>(modified, VERTEX_INDEX_BYTES_OFFSET, 3);
+            }
+            SUBCASE("section offset") {
+                writeAt<std::uint64_t>(modified,
+                                       VERTEX_INDICES_OFFSET,
+                                       contents.size());
+            }
+
+            CHECK_FALSE(loads(modified));
+        }
+        SUBCASE("index past the vertices") {
+            const auto indices =
+                readAt<std::uint64_t>(contents, VERTEX_INDICES_OFFSET);
+            const unsigned bytesPerIndex =
+                storage == MeshStorage::Compact ? 2 : 8;
+            const std::size_t lastIndex =
+                indices + (data.vertexIndices.size() - 1) * bytesPerIndex;
+
+            std::string modified = contents;
+            const auto setLastIndex = [&](const std::uint64_t index) {
+                if (bytesPerIndex == 2) {
+                    writeAt(modified,
+                            lastIndex,
+                            static_cast<std::uint16_t>(index));
+                }
+                else {
+                    writeAt(modified, lastIndex, index);
+                }
+            };
+
+            // the last vertex is still a valid index
+            setLastIndex(data.vertices.size() - 1);
+            CHECK(loads(modified));
+
+            setLastIndex(data.vertices.size());
+            CHECK_FALSE(loads(modified));
+        }
+    }
+} // namespace
+
+TEST_CASE("mesh caches round trip") {
+    pbrt::rng::RNG rng;
+    auto data = pbrt::tests::randomMeshData(100, rng);
+
+    SUBCASE("with all attributes") {}
+    SUBCASE("with positions only") {
+        data.normals.clear();
+        data.tangents.clear();
+        data.uvs.clear();
+        data.faceIndices.clear();
+    }
+
+    for (const auto storage : {MeshStorage::Full, MeshStorage::Compact}) {
+        const TemporaryPath cache{"pbrt_mesh_cache_test.bin"};
+        const auto mesh = pbrt::tests::createMesh(data, storage);
+        REQUIRE(shapes::writeMeshCache(*mesh, cache.path));
+
+        const auto loaded = shapes::loadMeshCache(cache.path);
+        REQUIRE(loaded != nullptr);
+        checkSameMeshes(*loaded, *mesh);
+    }
+}
+
+TEST_CASE("missing mesh caches are not loaded") {
+    const TemporaryPath cache{"pbrt_mesh_cache_test_missing.bin"};
+    CHECK(shapes::loadMeshCache(cache.path) == nullptr);
+}
+
+TEST_CASE("malformed mesh caches are not loaded") {
+    SUBCASE("full") { checkMalformedCaches(MeshStorage::Full); }
+    SUBCASE("compact") { checkMalformedCaches(MeshStorage::Compact); }
+}
\ No newline at end of file
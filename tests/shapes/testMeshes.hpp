@@ -0,0 +1,96 @@
+#pragma once
+
+#include "pbrt/shapes/Triangle.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/math/Point3.hpp"
+#include "pbrt/core/math/Point2.hpp"
+#include "pbrt/core/math/Vector3.hpp"
+#include "pbrt/core/math/Normal3.hpp"
+#include "pbrt/core/RNG.hpp"
+
+#include <memory>
+#include <vector>
+
+// The meshes and rays shared by the shapes tests
+
+namespace idragnev::pbrt::tests {
+    inline Point3f randomPoint(rng::RNG& rng) {
+        const Float x = rng.uniformFloat();
+        const Float y = rng.uniformFloat();
+        const Float z = rng.uniformFloat();
+        return Point3f(x, y, z);
+    }
+
+    inline Vector3f randomDirection(rng::RNG& rng) {
+        return 2.f * (randomPoint(rng) - Point3f(0.5f, 0.5f, 0.5f));
+    }
+
+    // The arguments of the TriangleMesh constructor
+    struct MeshData
+    {
+        unsigned trianglesCount = 0;
+        std::vector<std::size_t> vertexIndices;
+        std::vector<Point3f> vertices;
+        std::vector<Vector3f> tangents;
+        std::vector<Normal3f> normals;
+        std::vector<Point2f> uvs;
+        std::vector<std::size_t> faceIndices;
+    };
+
+    // Separate small triangles scattered in the unit cube, with all
+    // vertex attributes and a face for each two of them. The indices
+    // list the vertices in reverse.
+    inline MeshData randomMeshData(const unsigned trianglesCount,
+                                   rng::RNG& rng) {
+        MeshData data;
+        data.trianglesCount = trianglesCount;
+        for (unsigned i = 0; i < trianglesCount; ++i) {
+            const Point3f center = randomPoint(rng);
+            for (unsigned j = 0; j < 3; ++j) {
+                data.vertices.push_back(center +
+                                        0.125f * randomDirection(rng));
+                data.normals.emplace_back(randomDirection(rng));
+                data.tangents.push_back(randomDirection(rng));
+                data.uvs.emplace_back(rng.uniformFloat(), rng.uniformFloat());
+            }
+            data.faceIndices.push_back(i / 2);
+        }
+
+        const std::size_t verticesCount = data.vertices.size();
+        for (std::size_t i = 0; i < verticesCount; ++i) {
+            data.vertexIndices.push_back(verticesCount - 1 - i);
+        }
+
+        return data;
+    }
+
+    inline std::shared_ptr<const shapes::TriangleMesh>
+    createMesh(const MeshData& data, const shapes::MeshStorage storage) {
+        return std::make_shared<const shapes::TriangleMesh>(
+            Transformation{},
+            data.trianglesCount,
+            data.vertexIndices,
+            data.vertices,
+            data.tangents,
+            data.normals,
+            data.uvs,
+            nullptr,
+            nullptr,
+            data.faceIndices,
+            storage);
+    }
+
+    // Rays from around the unit cube towards points in it
+    inline std::vector<Ray> randomRays(const std::size_t count,
+                                       rng::RNG& rng) {
+        std::vector<Ray> rays;
+        for (std::size_t i = 0; i < count; ++i) {
+            const Point3f o =
+                2.f * randomPoint(rng) - Vector3f(0.5f, 0.5f, 0.5f);
+            rays.emplace_back(o, randomPoint(rng) - o);
+        }
+
+        return rays;
+    }
+} // namespace idragnev::pbrt::tests
\ No newline at end of file
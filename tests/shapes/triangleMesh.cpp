@@ -0,0 +1,134 @@
+#include "doctest/doctest.h"
+
+#include "testMeshes.hpp"
+#include "pbrt/shapes/TriangleMeshShape.hpp"
+
+#include <cstdint>
+#include <limits>
+
+namespace pbrt = idragnev::pbrt;
+namespace shapes = idragnev::pbrt::shapes;
+
+using shapes::MeshStorage;
+
+namespace {
+    shapes::TriangleMeshShape meshShape(
+        std::shared_ptr<const shapes::TriangleMesh> mesh) {
+        const pbrt::Transformation identity;
+        return shapes::TriangleMeshShape(identity,
+                                         identity,
+                                         false,
+                                         std::move(mesh));
+    }
+} // namespace
+
+TEST_CASE("compact meshes are hit exactly as full meshes") {
+    pbrt::rng::RNG rng;
+    const auto data = pbrt::tests::randomMeshData(200, rng);
+    const auto full =
+        meshShape(pbrt::tests::createMesh(data, MeshStorage::Full));
+    const auto compact =
+        meshShape(pbrt::tests::createMesh(data, MeshStorage::Compact));
+
+    std::size_t hitsCount = 0;
+    for (const pbrt::Ray& ray : pbrt::tests::randomRays(500, rng)) {
+        for (std::uint32_t triangle = 0; triangle < data.trianglesCount;
+             ++triangle) {
+            const auto fullHit = full.intersectPart(ray, triangle, false);
+            const auto compactHit = compact.intersectPart(ray, triangle, false);
+
+            REQUIRE(fullHit.has_value() == compactHit.has_value());
+            CHECK(full.intersectPartP(ray, triangle, false) ==
+                  fullHit.has_value());
+            CHECK(compact.intersectPartP(ray, triangle, false) ==
+                  fullHit.has_value());
+            if (!fullHit.has_value()) {
+                continue;
+            }
+
+            ++hitsCount;
+            const pbrt::SurfaceInteraction& a = fullHit->interaction;
+            const pbrt::SurfaceInteraction& b = compactHit->interaction;
+            CHECK(fullHit->t == compactHit->t);
+            CHECK(a.p == b.p);
+            CHECK(a.pError == b.pError);
+            CHECK(a.faceIndex == b.faceIndex);
+            // the UVs are rounded to half precision
+            CHECK(b.uv.x == doctest::Approx(a.uv.x).epsilon(1e-3));
+            CHECK(b.uv.y == doctest::Approx(a.uv.y).epsilon(1e-3));
+        }
+    }
+    CHECK(hitsCount > 100);
+}
+
+TEST_CASE("compact meshes decode their vertex attributes") {
+    pbrt::rng::RNG rng;
+    const auto data = pbrt::tests::randomMeshData(100, rng);
+    const auto mesh = pbrt::tests::createMesh(data, MeshStorage::Compact);
+
+    REQUIRE(mesh->hasNormals());
+    REQUIRE(mesh->hasTangents());
+    REQUIRE(mesh->hasUVs());
+    for (std::size_t v = 0; v < data.vertices.size(); ++v) {
+        CHECK(mesh->vertexWorldCoordinates[v] == data.vertices[v]);
+
+        // the directions are kept, not the lengths
+        const pbrt::Normal3f n = mesh->normal(v);
+        const pbrt::Normal3f expectedN = pbrt::math::normalize(data.normals[v]);
+        const pbrt::Vector3f t = mesh->tangent(v);
+        const pbrt::Vector3f expectedT =
+            pbrt::math::normalize(data.tangents[v]);
+        CHECK(n.x == doctest::Approx(expectedN.x).epsilon(1e-3));
+        CHECK(n.y == doctest::Approx(expectedN.y).epsilon(1e-3));
+        CHECK(n.z == doctest::Approx(expectedN.z).epsilon(1e-3));
+        CHECK(t.x == doctest::Approx(expectedT.x).epsilon(1e-3));
+        CHECK(t.y == doctest::Approx(expectedT.y).epsilon(1e-3));
+        CHECK(t.z == doctest::Approx(expectedT.z).epsilon(1e-3));
+
+        const pbrt::Point2f uv = mesh->uv(v);
+        CHECK(uv.x == doctest::Approx(data.uvs[v].x).epsilon(1e-3));
+        CHECK(uv.y == doctest::Approx(data.uvs[v].y).epsilon(1e-3));
+    }
+}
+
+TEST_CASE("mesh index widths") {
+    pbrt::rng::RNG rng;
+
+    const auto checkIndices = [](const shapes::TriangleMesh& mesh,
+                                 const pbrt::tests::MeshData& data) {
+        REQUIRE(mesh.vertexIndices.size() == data.vertexIndices.size());
+        for (std::size_t i = 0; i < data.vertexIndices.size(); ++i) {
+            REQUIRE(mesh.vertexIndices[i] == data.vertexIndices[i]);
+        }
+        for (unsigned i = 0; i < data.trianglesCount; ++i) {
+            REQUIRE(mesh.faceIndex(i) == data.faceIndices[i]);
+        }
+    };
+
+    // the largest index of 21845 triangles is 65534
+    // and that of 21846 triangles is 65537
+    const auto small = pbrt::tests::randomMeshData(21845, rng);
+    const auto large = pbrt::tests::randomMeshData(21846, rng);
+    REQUIRE(small.vertices.size() <= 65536);
+    REQUIRE(large.vertices.size() > 65536);
+
+    SUBCASE("full meshes use 64-bit indices") {
+        const auto mesh = pbrt::tests::createMesh(small, MeshStorage::Full);
+        CHECK(mesh->vertexIndices.bytesPerIndex() == 8);
+        CHECK(mesh->faceIndices.bytesPerIndex() == 8);
+        checkIndices(*mesh, small);
+    }
+    SUBCASE("compact meshes of up to 65536 vertices use 16-bit indices") {
+        const auto mesh = pbrt::tests::createMesh(small, MeshStorage::Compact);
+        CHECK(mesh->vertexIndices.bytesPerIndex() == 2);
+        CHECK(mesh->faceIndices.bytesPerIndex() == 2);
+        checkIndices(*mesh, small);
+    }
+    SUBCASE("bigger compact meshes use 32-bit indices") {
+        const auto mesh = pbrt::tests::createMesh(large, MeshStorage::Compact);
+        CHECK(mesh->vertexIndices.bytesPerIndex() == 4);
+        // the faces are still few enough
+        CHECK(mesh->faceIndices.bytesPerIndex() == 2);
+        checkIndices(*mesh, large);
+    }
+}
\ No newline at end of file